@@ -0,0 +1,4 @@
+#!/usr/bin/env sh
+
+# usage: ./run_noodler_benchmarks.sh <benchmark dirs or files> [options of scripts/noodler_benchmarks.py]
+cd build/ && cmake ../ && make -j 4 shell && cd .. && python3 scripts/noodler_benchmarks.py --z3 build/z3 "$@"
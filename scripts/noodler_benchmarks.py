@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+"""
+Runs .smt2 benchmarks (e.g., local copies of the Kaluza, PyEx or Woorpje
+suites) through z3 with the Noodler string theory and records the result,
+time, number of noodles and peak memory of each benchmark to CSV or JSON.
+The results can be compared against a stored baseline (a previous output
+of this script); the script then exits with 1 if some benchmark got slower,
+stopped being solved or got a wrong answer.
+
+Example:
+    scripts/noodler_benchmarks.py benchmarks/kaluza --timeout 10 -o new.csv --baseline old.csv
+"""
+import argparse
+import csv
+import json
+import os
+import re
+import subprocess
+import sys
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+FIELDS = ["file", "result", "expected", "time", "noodles", "solving_states", "final_checks", "peak_rss_kb"]
+
+# statistics of z3 (printed by -st) stored in the results, see collect_statistics() of the Noodler theory
+STATS = {
+    "noodles": "noodler-noodles",
+    "solving_states": "noodler-solving-states",
+    "final_checks": "noodler-final-checks",
+}
+
+STATUS_RE = re.compile(r"\(\s*set-info\s+:status\s+(sat|unsat|unknown)\s*\)")
+STAT_RE = re.compile(r":([\w\-.]+)\s+([0-9.]+)")
+
+
+def find_benchmarks(paths):
+    files = []
+    for path in paths:
+        if os.path.isdir(path):
+            for root, _, names in os.walk(path):
+                files.extend(os.path.join(root, name) for name in names if name.endswith(".smt2"))
+        else:
+            files.append(path)
+    return sorted(files)
+
+
+def get_expected_status(path):
+    with open(path, errors="replace") as f:
+        match = STATUS_RE.search(f.read())
+    return match.group(1) if match else "unknown"
+
+
+def run_benchmark(z3, path, timeout, z3_args):
+    """Run z3 on one benchmark, return its record (see FIELDS)."""
+    cmd = [z3, "smt.string_solver=noodler", "-st", "-T:{}".format(timeout)] + z3_args + [path]
+    start = time.monotonic()
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    # -T is a soft limit, the process is killed if it does not stop shortly after it
+    killer = threading.Timer(timeout + 5, proc.kill)
+    killer.start()
+    output = proc.stdout.read()
+    # wait4 gives the peak memory of this process only (unlike getrusage(RUSAGE_CHILDREN))
+    _, status, usage = os.wait4(proc.pid, 0)
+    proc.returncode = status
+    killer.cancel()
+    elapsed = time.monotonic() - start
+
+    lines = output.split("\n")
+    first = lines[0].strip() if lines else ""
+    if elapsed >= timeout or first == "timeout":
+        result = "timeout"
+    elif first in ("sat", "unsat", "unknown"):
+        result = first
+    else:
+        result = "error"
+
+    record = {
+        "file": path,
+        "result": result,
+        "expected": get_expected_status(path),
+        "time": round(elapsed, 3),
+        # ru_maxrss is in kilobytes on Linux (in bytes on macOS)
+        "peak_rss_kb": usage.ru_maxrss // 1024 if sys.platform == "darwin" else usage.ru_maxrss,
+    }
+    stats = dict(STAT_RE.findall(output))
+    for field, key in STATS.items():
+        record[field] = int(float(stats.get(key, 0)))
+    return record
+
+
+def is_wrong(record):
+    return record["result"] in ("sat", "unsat") and record["expected"] in ("sat", "unsat") \
+        and record["result"] != record["expected"]
+
+
+def is_solved(record):
+    return record["result"] in ("sat", "unsat") and not is_wrong(record)
+
+
+def write_results(records, path):
+    if path.endswith(".json"):
+        with open(path, "w") as f:
+            json.dump(records, f, indent=2)
+    else:
+        with open(path, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=FIELDS)
+            writer.writeheader()
+            writer.writerows(records)
+
+
+def read_results(path):
+    if path.endswith(".json"):
+        with open(path) as f:
+            records = json.load(f)
+    else:
+        with open(path, newline="") as f:
+            records = list(csv.DictReader(f))
+    for record in records:
+        record["time"] = float(record["time"])
+        for field in list(STATS) + ["peak_rss_kb"]:
+            record[field] = int(record.get(field) or 0)
+    return {record["file"]: record for record in records}
+
+
+def compare(records, baseline, time_factor, min_time):
+    """Print the differences against the baseline, return the number of regressions."""
+    regressions = 0
+    improvements = 0
+    for record in records:
+        old = baseline.get(record["file"])
+        if is_wrong(record):
+            print("WRONG     {}: {} (expected {})".format(record["file"], record["result"], record["expected"]))
+            regressions += 1
+        if old is None:
+            continue
+        if is_solved(old) and not is_solved(record):
+            print("UNSOLVED  {}: {} -> {}".format(record["file"], old["result"], record["result"]))
+            regressions += 1
+        elif not is_solved(old) and is_solved(record):
+            print("SOLVED    {}: {} -> {}".format(record["file"], old["result"], record["result"]))
+            improvements += 1
+        elif is_solved(old) and record["time"] > max(old["time"] * time_factor, min_time):
+            print("SLOWER    {}: {:.2f}s -> {:.2f}s".format(record["file"], old["time"], record["time"]))
+            regressions += 1
+
+    common = [r for r in records if r["file"] in baseline and is_solved(r) and is_solved(baseline[r["file"]])]
+    old_time = sum(baseline[r["file"]]["time"] for r in common)
+    new_time = sum(r["time"] for r in common)
+    print("solved: {} -> {}".format(sum(is_solved(r) for r in baseline.values()), sum(is_solved(r) for r in records)))
+    print("time of commonly solved ({}): {:.2f}s -> {:.2f}s".format(len(common), old_time, new_time))
+    print("{} regressions, {} improvements".format(regressions, improvements))
+    return regressions
+
+
+def main(args):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("benchmarks", nargs="+", help="benchmark files or directories (searched for .smt2 files)")
+    parser.add_argument("--z3", default="build/z3", help="z3 binary (default: %(default)s)")
+    parser.add_argument("-t", "--timeout", type=int, default=60, help="timeout per benchmark in seconds (default: %(default)s)")
+    parser.add_argument("-j", "--jobs", type=int, default=1, help="number of benchmarks run in parallel (default: %(default)s)")
+    parser.add_argument("-o", "--output", help="output file, JSON if it ends with .json, CSV otherwise")
+    parser.add_argument("--baseline", help="results of a previous run (CSV or JSON) to compare against")
+    parser.add_argument("--time-factor", type=float, default=1.5,
+                        help="a solved benchmark is a regression if it is this many times slower than in the baseline (default: %(default)s)")
+    parser.add_argument("--min-time", type=float, default=1.0,
+                        help="benchmarks faster than this (in seconds) are never slower regressions (default: %(default)s)")
+    parser.add_argument("--z3-arg", dest="z3_args", action="append", default=[],
+                        help="additional argument of z3, e.g. --z3-arg smt.str.underapprox=true (can be repeated)")
+    pargs = parser.parse_args(args)
+
+    files = find_benchmarks(pargs.benchmarks)
+    if not files:
+        print("no benchmarks found", file=sys.stderr)
+        return 1
+
+    def run(path):
+        record = run_benchmark(pargs.z3, path, pargs.timeout, pargs.z3_args)
+        print("{:8} {:8.2f}s {:>8} noodles {:>8} kB  {}".format(
+            record["result"], record["time"], record["noodles"], record["peak_rss_kb"], path), flush=True)
+        return record
+
+    with ThreadPoolExecutor(max_workers=max(1, pargs.jobs)) as executor:
+        records = list(executor.map(run, files))
+
+    if pargs.output:
+        write_results(records, pargs.output)
+
+    if pargs.baseline:
+        return 1 if compare(records, read_results(pargs.baseline), pargs.time_factor, pargs.min_time) > 0 else 0
+    wrong = [r for r in records if is_wrong(r)]
+    for record in wrong:
+        print("WRONG     {}: {} (expected {})".format(record["file"], record["result"], record["expected"]))
+    print("solved: {} of {}".format(sum(is_solved(r) for r in records), len(records)))
+    return 1 if wrong else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
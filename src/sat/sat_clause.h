@@ -37,6 +37,13 @@ namespace sat {
 
     std::ostream & operator<<(std::ostream & out, clause const & c);
 
+    // tiers of learned clauses, see solver::gc_tiered
+    enum clause_tier {
+        CORE_TIER,
+        TIER2,
+        LOCAL_TIER
+    };
+
     class clause {
         friend class clause_allocator;
         friend class tmp_clause;
@@ -50,6 +57,7 @@ namespace sat {
         unsigned           m_used:1;
         unsigned           m_frozen:1;
         unsigned           m_reinit_stack:1;
+        unsigned           m_tier:2;
         unsigned           m_inact_rounds:8;
         unsigned           m_glue:8;
         unsigned           m_psm:8;  // transient field used during gc
@@ -98,6 +106,8 @@ namespace sat {
         unsigned glue() const { return m_glue; }
         void set_psm(unsigned psm) { m_psm = psm > 255 ? 255 : psm; }
         unsigned psm() const { return m_psm; }
+        clause_tier tier() const { return static_cast<clause_tier>(m_tier); }
+        void set_tier(clause_tier t) { m_tier = t; }
         clause_offset get_new_offset() const;
         void set_new_offset(clause_offset off); 
 
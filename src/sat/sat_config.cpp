@@ -94,6 +94,10 @@ namespace sat {
         
         m_max_conflicts   = p.max_conflicts();
         m_num_threads     = p.threads();
+        m_par_export_glue = p.threads_export_glue();
+        m_par_export_size = p.threads_export_size();
+        m_cube_and_conquer = p.cube_and_conquer();
+        m_cube_and_conquer_conflicts = p.cube_and_conquer_conflicts();
         m_ddfw_search     = p.ddfw_search();
         m_ddfw_threads    = p.ddfw_threads();
         m_prob_search     = p.prob_search();
@@ -106,6 +110,8 @@ namespace sat {
         m_local_search_dbg_flips = p.local_search_dbg_flips();
         //m_binspr            = p.binspr();
         m_binspr            = false;     // prevent adventurous users from trying feature that isn't ready
+        m_vivify            = p.vivify();
+        m_vivify_limit      = p.vivify_limit();
         m_anf_simplify      = p.anf();
         m_anf_delay         = p.anf_delay();
         m_anf_exlin         = p.anf_exlin();
@@ -177,12 +183,17 @@ namespace sat {
             m_gc_strategy = GC_PSM;
         else if (s == symbol("psm_glue"))
             m_gc_strategy = GC_PSM_GLUE;
+        else if (s == symbol("tiered"))
+            m_gc_strategy = GC_TIERED;
         else 
             throw sat_param_exception("invalid gc strategy");
         m_gc_initial      = p.gc_initial();
         m_gc_increment    = p.gc_increment();
         m_gc_small_lbd    = p.gc_small_lbd();
         m_gc_k            = std::min(255u, p.gc_k());
+        m_gc_tier1        = p.gc_tier1();
+        m_gc_tier2        = std::max(m_gc_tier1, p.gc_tier2());
+        m_gc_tier1_max    = p.gc_tier1_max();
         m_gc_burst        = p.gc_burst();
         m_gc_defrag       = p.gc_defrag();
 
@@ -259,7 +270,8 @@ namespace sat {
             throw sat_param_exception("invalid PB lemma format: 'cardinality' or 'pb' expected");
         
         m_card_solver = p.cardinality_solver();
-        m_xor_solver = false; // prevent users from playing with this option
+        m_xor_solver = p.xor_solver();
+        m_xor_max_vars = p.xor_max_vars();
 
         sat_simplifier_params ssp(_p);
         m_elim_vars = ssp.elim_vars();
@@ -44,7 +44,8 @@ namespace sat {
         GC_PSM,
         GC_GLUE,
         GC_GLUE_PSM,
-        GC_PSM_GLUE
+        GC_PSM_GLUE,
+        GC_TIERED
     };
 
     enum branching_heuristic {
@@ -111,6 +112,10 @@ namespace sat {
         bool               m_enable_pre_simplify;
         unsigned           m_max_conflicts;
         unsigned           m_num_threads;
+        unsigned           m_par_export_glue;
+        unsigned           m_par_export_size;
+        bool               m_cube_and_conquer;
+        unsigned           m_cube_and_conquer_conflicts;
         bool               m_ddfw_search;
         unsigned           m_ddfw_threads;
         bool               m_prob_search;
@@ -119,6 +124,8 @@ namespace sat {
         local_search_mode  m_local_search_mode;
         bool               m_local_search_dbg_flips;
         bool               m_binspr;
+        bool               m_vivify;
+        unsigned           m_vivify_limit;
         bool               m_cut_simplify;
         unsigned           m_cut_delay;
         bool               m_cut_aig;
@@ -159,6 +166,9 @@ namespace sat {
         unsigned           m_gc_increment;
         unsigned           m_gc_small_lbd;
         unsigned           m_gc_k;
+        unsigned           m_gc_tier1;
+        unsigned           m_gc_tier2;
+        unsigned           m_gc_tier1_max;
         bool               m_gc_burst;
         bool               m_gc_defrag;
 
@@ -187,6 +197,7 @@ namespace sat {
         
         bool               m_card_solver;
         bool               m_xor_solver;
+        unsigned           m_xor_max_vars;
         pb_resolve         m_pb_resolve;
         pb_lemma_format    m_pb_lemma_format;
         
@@ -0,0 +1,284 @@
+/*++
+Copyright (c) 2017 Microsoft Corporation
+
+Module Name:
+
+    sat_cube_and_conquer.cpp
+
+Abstract:
+
+    Cube and conquer with parallel CDCL workers.
+
+--*/
+#include <chrono>
+#include <thread>
+#include "sat/sat_cube_and_conquer.h"
+#include "sat/sat_solver.h"
+#include "sat/sat_lookahead.h"
+
+namespace sat {
+
+    cube_and_conquer::cube_and_conquer(solver& s):
+        m_s(s),
+        m_par(s),
+        m_pending(0),
+        m_done(false) {}
+
+    solver& cube_and_conquer::get_worker(unsigned i) {
+        return i + 1 < num_workers() ? m_par.get_solver(i) : m_s;
+    }
+
+    /**
+       \brief enumerate the cubes of the lookahead solver.
+       The cubes are replaced by the empty cube if the lookahead
+       finds a model or gives up before the cubes cover the search space.
+    */
+    lbool cube_and_conquer::mk_cubes(vector<literal_vector>& cubes) {
+        lookahead lh(m_s);
+        bool_var_vector vars;
+        literal_vector cube;
+        while (m_s.rlimit().inc()) {
+            vars.reset();
+            lbool r = lh.cube(vars, cube, UINT_MAX);
+            if (r == l_false)
+                return cubes.empty() ? l_false : l_true;
+            if (r == l_true || cube.empty()) {
+                cubes.reset();
+                cubes.push_back(literal_vector());
+                return l_true;
+            }
+            cubes.push_back(cube);
+        }
+        return l_undef;
+    }
+
+    void cube_and_conquer::add_cube(unsigned i, literal_vector const& cube) {
+        work_queue& q = *m_queues[i];
+        lock_guard lock(q.m_mux);
+        q.m_cubes.push_back(cube);
+    }
+
+    bool cube_and_conquer::get_cube(unsigned i, literal_vector& cube) {
+        {
+            work_queue& q = *m_queues[i];
+            lock_guard lock(q.m_mux);
+            if (q.m_head < q.m_cubes.size()) {
+                cube = q.m_cubes.back();
+                q.m_cubes.pop_back();
+                return true;
+            }
+        }
+        unsigned n = num_workers();
+        for (unsigned k = 1; k < n; ++k) {
+            work_queue& q = *m_queues[(i + k) % n];
+            lock_guard lock(q.m_mux);
+            if (q.m_head < q.m_cubes.size()) {
+                cube = q.m_cubes[q.m_head++];
+                if (q.m_head == q.m_cubes.size()) {
+                    q.m_cubes.reset();
+                    q.m_head = 0;
+                }
+                ++m_stats.m_steals;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool_var cube_and_conquer::select_split_var(solver& w, literal_vector const& cube) {
+        w.pop_to_base_level();
+        bool_var best = null_bool_var;
+        for (bool_var v = 0; v < w.m_par_num_vars; ++v) {
+            if (w.value(v) != l_undef || w.was_eliminated(v))
+                continue;
+            if (best != null_bool_var && w.m_activity[v] <= w.m_activity[best])
+                continue;
+            if (cube.contains(literal(v, false)) || cube.contains(literal(v, true)))
+                continue;
+            best = v;
+        }
+        return best;
+    }
+
+    /**
+       \brief the literals of the core that are not in the cube are a core of the assumptions.
+       The refutation is global if it does not use the cube.
+    */
+    void cube_and_conquer::add_core(literal_vector const& core, literal_vector const& cube, bool& is_global) {
+        lock_guard lock(m_mux);
+        is_global = true;
+        for (literal lit : core)
+            if (cube.contains(lit) && !m_asms.contains(lit))
+                is_global = false;
+        if (is_global)
+            m_core.reset();
+        for (literal lit : core)
+            if ((!cube.contains(lit) || m_asms.contains(lit)) && !m_core.contains(lit))
+                m_core.push_back(lit);
+    }
+
+    void cube_and_conquer::solve_cube(unsigned i, literal_vector const& cube) {
+        solver& w = get_worker(i);
+        unsigned budget = m_s.m_config.m_cube_and_conquer_conflicts;
+        bool user_limit = w.m_config.m_max_conflicts <= budget;
+        literal_vector asms(m_asms);
+        asms.append(cube);
+        lbool r;
+        {
+            flet<unsigned> _max_conflicts(w.m_config.m_max_conflicts, std::min(w.m_config.m_max_conflicts, budget));
+            r = w.check(asms.size(), asms.data());
+        }
+        switch (r) {
+        case l_true:
+            finish(i, l_true);
+            break;
+        case l_false: {
+            bool is_global = false;
+            add_core(w.get_core(), cube, is_global);
+            ++m_stats.m_refuted;
+            if (is_global)
+                finish(i, l_false);
+            else
+                --m_pending;
+            break;
+        }
+        case l_undef: {
+            if (m_done)
+                break;
+            if (user_limit || strcmp(w.get_reason_unknown(), "sat.max.conflicts") != 0) {
+                finish(i, l_undef);
+                break;
+            }
+            bool_var v = select_split_var(w, cube);
+            if (v == null_bool_var) {
+                // the cube cannot be split and solving it again with the same budget would not progress.
+                finish(i, l_undef);
+                break;
+            }
+            IF_VERBOSE(2, verbose_stream() << "(sat.cube-and-conquer :split " << cube.size() << " :var " << v << ")\n";);
+            // the owner pops the last cube, so it continues with the cube of the saved phase.
+            literal lit(v, !w.get_phase(v));
+            literal_vector c(cube);
+            c.push_back(~lit);
+            add_cube(i, c);
+            c.back() = lit;
+            add_cube(i, c);
+            ++m_pending;
+            ++m_stats.m_splits;
+            m_stats.m_cubes += 2;
+            break;
+        }
+        }
+    }
+
+    void cube_and_conquer::finish(unsigned i, lbool r) {
+        {
+            lock_guard lock(m_mux);
+            if (m_finished_id != -1)
+                return;
+            m_finished_id = i;
+            m_result = r;
+            m_done = true;
+        }
+        for (unsigned j = 0; j + 1 < num_workers(); ++j)
+            if (j != i)
+                m_par.cancel_solver(j);
+        if (i + 1 != num_workers()) {
+            m_canceled = !m_s.rlimit().inc();
+            if (!m_canceled)
+                m_s.rlimit().cancel();
+        }
+    }
+
+    void cube_and_conquer::worker(unsigned i) {
+        literal_vector cube;
+        while (!m_done) {
+            if (get_cube(i, cube)) {
+                solve_cube(i, cube);
+                continue;
+            }
+            if (m_pending == 0) {
+                finish(i, l_false);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    lbool cube_and_conquer::operator()(unsigned num_lits, literal const* lits) {
+        m_asms.append(num_lits, lits);
+        vector<literal_vector> cubes;
+        lbool r = mk_cubes(cubes);
+        if (r == l_false) {
+            // the lookahead refutes the clauses without the assumptions.
+            m_s.pop_to_base_level();
+            m_s.m_core.reset();
+            m_s.set_conflict();
+            return l_false;
+        }
+        if (r == l_undef)
+            return l_undef;
+
+        unsigned n = std::max(1u, m_s.m_config.m_num_threads);
+        m_par.reserve(n, m_s.num_vars(), 1 << 12);
+        m_par.init_solvers(m_s, n - 1);
+        for (unsigned i = 0; i < n; ++i)
+            m_queues.push_back(alloc(work_queue));
+        for (unsigned i = 0; i < cubes.size(); ++i)
+            add_cube(i % n, cubes[i]);
+        m_pending = cubes.size();
+        m_stats.m_cubes += cubes.size();
+        IF_VERBOSE(1, verbose_stream() << "(sat.cube-and-conquer :cubes " << cubes.size() << " :workers " << n << ")\n";);
+
+        std::string ex_msg;
+        bool has_error = false, has_exception = false;
+        unsigned error_code = 0;
+        auto worker_thread = [&](unsigned i) {
+            try {
+                worker(i);
+            }
+            catch (z3_error & err) {
+                error_code = err.error_code();
+                has_error = true;
+                finish(i, l_undef);
+            }
+            catch (z3_exception & ex) {
+                ex_msg = ex.msg();
+                has_exception = true;
+                finish(i, l_undef);
+            }
+        };
+        vector<std::thread> threads(n);
+        for (unsigned i = 0; i < n; ++i) {
+            threads[i] = std::thread([&, i]() { worker_thread(i); });
+        }
+        for (auto & th : threads) {
+            th.join();
+        }
+
+        m_par.collect_statistics(m_s.m_aux_stats);
+        collect_statistics(m_s.m_aux_stats);
+        if (m_result == l_true && m_finished_id + 1 != static_cast<int>(n))
+            m_s.set_model(get_worker(m_finished_id).get_model(), true);
+        if (m_result == l_false) {
+            m_s.m_core.reset();
+            m_s.m_core.append(m_core);
+        }
+        if (!m_canceled)
+            m_s.rlimit().reset_cancel();
+        m_s.set_par(nullptr, 0);
+        if (m_result == l_undef && has_error)
+            throw z3_error(error_code);
+        if (m_result == l_undef && has_exception)
+            throw default_exception(std::move(ex_msg));
+        return m_result;
+    }
+
+    void cube_and_conquer::collect_statistics(statistics& st) const {
+        st.update("sat cnc cubes", m_stats.m_cubes.load());
+        st.update("sat cnc refuted", m_stats.m_refuted.load());
+        st.update("sat cnc splits", m_stats.m_splits.load());
+        st.update("sat cnc steals", m_stats.m_steals.load());
+    }
+
+};
@@ -0,0 +1,90 @@
+/*++
+Copyright (c) 2017 Microsoft Corporation
+
+Module Name:
+
+    sat_cube_and_conquer.h
+
+Abstract:
+
+    Cube and conquer with parallel CDCL workers.
+
+    The lookahead solver splits the problem into cubes that are
+    distributed over the queues of the workers. A worker solves the
+    cubes of its own queue under assumptions, most recent cube first,
+    and steals the oldest cube of another queue when its own is empty.
+    A cube that is not solved within the conflict budget is split on
+    the most active unassigned variable of the worker, which continues
+    with the half of the saved phase of the variable. The result is
+    unknown if the cube has no variable left to split on.
+    Units and short learned clauses are exchanged through sat::parallel.
+
+    The problem is satisfiable as soon as one cube is satisfiable, it
+    is unsatisfiable when every cube is refuted or a refutation does not
+    depend on the literals of the cube.
+
+--*/
+#pragma once
+
+#include "sat/sat_types.h"
+#include "sat/sat_parallel.h"
+#include "util/mutex.h"
+#include "util/scoped_ptr_vector.h"
+#include "util/statistics.h"
+#include <atomic>
+
+namespace sat {
+
+    class cube_and_conquer {
+
+        struct stats {
+            std::atomic<unsigned> m_cubes;
+            std::atomic<unsigned> m_refuted;
+            std::atomic<unsigned> m_splits;
+            std::atomic<unsigned> m_steals;
+            stats(): m_cubes(0), m_refuted(0), m_splits(0), m_steals(0) {}
+        };
+
+        // the owner pops from the back, thieves take from the front.
+        struct work_queue {
+            mutex                  m_mux;
+            vector<literal_vector> m_cubes;
+            unsigned               m_head = 0;
+        };
+
+        solver&                       m_s;
+        parallel                      m_par;
+        scoped_ptr_vector<work_queue> m_queues;
+        std::atomic<unsigned>         m_pending;    // cubes that are queued or being solved
+        std::atomic<bool>             m_done;
+        literal_vector                m_asms;
+        stats                         m_stats;
+
+        // result, protected by m_mux
+        mutex                         m_mux;
+        int                           m_finished_id = -1;
+        lbool                         m_result = l_undef;
+        literal_vector                m_core;
+        bool                          m_canceled = false;
+
+        unsigned num_workers() const { return m_queues.size(); }
+        solver& get_worker(unsigned i);
+        lbool mk_cubes(vector<literal_vector>& cubes);
+        void add_cube(unsigned i, literal_vector const& cube);
+        bool get_cube(unsigned i, literal_vector& cube);
+        bool_var select_split_var(solver& w, literal_vector const& cube);
+        void solve_cube(unsigned i, literal_vector const& cube);
+        void add_core(literal_vector const& core, literal_vector const& cube, bool& is_global);
+        void finish(unsigned i, lbool r);
+        void worker(unsigned i);
+
+    public:
+
+        cube_and_conquer(solver& s);
+
+        lbool operator()(unsigned num_lits, literal const* lits);
+
+        void collect_statistics(statistics& st) const;
+    };
+
+};
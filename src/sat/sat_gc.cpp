@@ -55,6 +55,9 @@ namespace sat {
         case GC_PSM_GLUE:
             gc_psm_glue();
             break;
+        case GC_TIERED:
+            gc_tiered();
+            break;
         case GC_DYN_PSM:
             if (!m_assumptions.empty()) {
                 gc_glue_psm();
@@ -178,6 +181,94 @@ namespace sat {
         IF_VERBOSE(SAT_VB_LVL, verbose_stream() << "(sat-gc :strategy " << st_name << " :deleted " << (sz - new_sz) << ")\n";);
     }
 
+    /**
+       \brief GC learned clauses by tiers.
+       Clauses enter the tier of their glue and are promoted when their glue decreases.
+       Core clauses are kept, unless the core tier has more than gc.tier1_max
+       clauses; then the core clauses that were not used since the last round
+       are demoted to tier2. Tier2 clauses that were not used since the
+       last round are demoted to the local tier. Half of the local clauses
+       that were not used since the last round are deleted, those with the
+       largest glue first. The threshold glue is found by counting, so the
+       clauses are not sorted.
+    */
+    void solver::gc_tiered() {
+        unsigned num_glue[256];
+        memset(num_glue, 0, sizeof(num_glue));
+        unsigned num_core = 0, num_tier2 = 0, num_local = 0, num_demoted = 0, num_candidates = 0;
+        for (clause* cp : m_learned)
+            if (cp->tier() == CORE_TIER)
+                ++num_core;
+        bool demote_core = num_core > m_config.m_gc_tier1_max;
+        for (clause* cp : m_learned) {
+            clause& c = *cp;
+            switch (c.tier()) {
+            case CORE_TIER:
+                if (demote_core && !c.was_used()) {
+                    // the clause gets another round in tier2.
+                    c.set_tier(TIER2);
+                    c.mark_used();
+                    --num_core;
+                    ++num_demoted;
+                    ++num_tier2;
+                }
+                break;
+            case TIER2:
+                if (c.was_used()) {
+                    ++num_tier2;
+                    break;
+                }
+                // the clause gets another round in the local tier.
+                c.set_tier(LOCAL_TIER);
+                c.mark_used();
+                ++num_demoted;
+                ++num_local;
+                break;
+            case LOCAL_TIER:
+                ++num_local;
+                if (!c.was_used()) {
+                    ++num_glue[c.glue()];
+                    ++num_candidates;
+                }
+                break;
+            }
+        }
+        // delete the unused local clauses with glue above max_glue
+        // and num_at_max of the clauses with glue max_glue.
+        unsigned to_delete = num_candidates / 2;
+        unsigned max_glue = 256, num_at_max = 0;
+        for (unsigned g = 256; g-- > 0 && to_delete > 0; ) {
+            max_glue = g;
+            num_at_max = std::min(num_glue[g], to_delete);
+            to_delete -= num_at_max;
+        }
+        unsigned sz = m_learned.size();
+        unsigned j = 0;
+        for (unsigned i = 0; i < sz; ++i) {
+            clause& c = *m_learned[i];
+            bool del = false;
+            if (c.tier() == LOCAL_TIER && !c.was_used()) {
+                if (c.glue() > max_glue)
+                    del = true;
+                else if (c.glue() == max_glue && num_at_max > 0) {
+                    --num_at_max;
+                    del = true;
+                }
+            }
+            c.unmark_used();
+            if (del && can_delete(c)) {
+                detach_clause(c);
+                del_clause(c);
+            }
+            else
+                m_learned[j++] = &c;
+        }
+        m_stats.m_gc_clause += sz - j;
+        m_learned.shrink(j);
+        IF_VERBOSE(SAT_VB_LVL, verbose_stream() << "(sat-gc :strategy tiered :core " << num_core << " :tier2 " << num_tier2 << " :local " << num_local
+                   << " :demoted " << num_demoted << " :deleted " << (sz - j) << ")\n";);
+    }
+
 #if ENABLE_TERNARY
     bool solver::can_delete3(literal l1, literal l2, literal l3) const {                                                           
         if (value(l1) == l_true && 
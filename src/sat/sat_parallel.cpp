@@ -19,83 +19,128 @@ Revision History:
 #include "sat/sat_parallel.h"
 #include "sat/sat_clause.h"
 #include "sat/sat_solver.h"
+#include "util/buffer.h"
+#include "util/symbol.h"
+#include <thread>
 
 namespace sat {
 
-    void parallel::vector_pool::next(unsigned& index) {
-        SASSERT(index < m_size);
-        unsigned n = index + 2 + get_length(index);
-        if (n >= m_size) {
-            index = 0;
-        }
-        else {
-            index = n;
+    void parallel::clause_ring::dealloc_ring() {
+        if (m_slots) {
+            dealloc_vect(m_slots, m_num_slots);
+            dealloc_vect(m_elems, m_num_slots * m_capacity);
         }
+        m_slots = nullptr;
+        m_elems = nullptr;
     }
 
-    void parallel::vector_pool::reserve(unsigned num_threads, unsigned sz) {
-        m_vectors.reset();
-        m_vectors.resize(sz, 0);
-        m_heads.reset();
-        m_heads.resize(num_threads, 0);
-        m_at_end.reset();
-        m_at_end.resize(num_threads, true);
+    void parallel::clause_ring::reserve(unsigned num_slots, unsigned capacity) {
+        dealloc_ring();
+        m_num_slots = 1;
+        while (m_num_slots < num_slots)
+            m_num_slots *= 2;
+        m_capacity = capacity;
+        m_slots = alloc_vect<slot>(m_num_slots);
+        m_elems = alloc_vect<std::atomic<unsigned>>(m_num_slots * m_capacity);
         m_tail = 0;
-        m_size = sz;
-    }
-    
-    void parallel::vector_pool::begin_add_vector(unsigned owner, unsigned n) {
-        SASSERT(m_tail < m_size);
-        unsigned capacity = n + 2;
-        m_vectors.reserve(m_size + capacity, 0);
-        IF_VERBOSE(3, verbose_stream() << owner << ": begin-add " << n << " tail: " << m_tail << " size: " << m_size << "\n";);
-        for (unsigned i = 0; i < m_heads.size(); ++i) {
-            while (m_tail < m_heads[i] && m_heads[i] < m_tail + capacity) {
-                next(m_heads[i]);
-            }
-            m_at_end[i] = false;
-        }
-        m_vectors[m_tail++] = owner;
-        m_vectors[m_tail++] = n;    
     }
 
-    void parallel::vector_pool::add_vector_elem(unsigned e) {
-        m_vectors[m_tail++] = e;
-    }
-
-    void parallel::vector_pool::end_add_vector() {
-        if (m_tail >= m_size) {
-            m_tail = 0;
+    bool parallel::clause_ring::push(unsigned owner, unsigned n, unsigned const* elems) {
+        if (n > m_capacity)
+            return false;
+        uint64_t pos = m_tail.fetch_add(1);
+        slot& sl = m_slots[pos & (m_num_slots - 1)];
+        uint64_t seq = sl.m_seq.load(std::memory_order_acquire);
+        while (true) {
+            // a writer of a later position took the slot.
+            if (seq >= 2 * pos + 1)
+                return false;
+            // the writer of an earlier position is still copying its clause.
+            if (seq % 2 == 1) {
+                std::this_thread::yield();
+                seq = sl.m_seq.load(std::memory_order_acquire);
+                continue;
+            }
+            if (sl.m_seq.compare_exchange_weak(seq, 2 * pos + 1, std::memory_order_acq_rel))
+                break;
         }
+        std::atomic_thread_fence(std::memory_order_release);
+        sl.m_owner.store(owner, std::memory_order_relaxed);
+        sl.m_size.store(n, std::memory_order_relaxed);
+        std::atomic<unsigned>* dst = m_elems + (pos & (m_num_slots - 1)) * m_capacity;
+        for (unsigned i = 0; i < n; ++i)
+            dst[i].store(elems[i], std::memory_order_relaxed);
+        sl.m_seq.store(2 * pos + 2, std::memory_order_release);
+        return true;
     }
 
-
-    bool parallel::vector_pool::get_vector(unsigned owner, unsigned& n, unsigned const*& ptr) {
-        unsigned head = m_heads[owner];      
-        unsigned iterations = 0;
-        while (head != m_tail || !m_at_end[owner]) {
-            ++iterations;
-            SASSERT(head < m_size && m_tail < m_size);            
-            bool is_self = owner == get_owner(head);
-            next(m_heads[owner]);
-            IF_VERBOSE(static_cast<unsigned>(iterations > m_size ? 0 : 3), verbose_stream() << owner << ": [" << head << ":" << m_heads[owner] << "] tail: " << m_tail << "\n";);
-            m_at_end[owner] = (m_heads[owner] == m_tail);
-            if (!is_self) {
-                n = get_length(head);
-                ptr = get_ptr(head);
-                return true;
+    bool parallel::clause_ring::pop(unsigned owner, uint64_t& head, unsigned& num_dropped, unsigned_vector& elems) {
+        while (true) {
+            uint64_t tail = m_tail.load(std::memory_order_acquire);
+            if (head >= tail)
+                return false;
+            if (tail - head > m_num_slots) {
+                num_dropped += static_cast<unsigned>(tail - m_num_slots - head);
+                head = tail - m_num_slots;
+            }
+            slot& sl = m_slots[head & (m_num_slots - 1)];
+            uint64_t seq = sl.m_seq.load(std::memory_order_acquire);
+            // the clause at head is not yet published.
+            if (seq < 2 * head + 2)
+                return false;
+            if (seq == 2 * head + 2) {
+                unsigned o = sl.m_owner.load(std::memory_order_relaxed);
+                unsigned n = std::min(sl.m_size.load(std::memory_order_relaxed), m_capacity);
+                std::atomic<unsigned> const* src = m_elems + (head & (m_num_slots - 1)) * m_capacity;
+                elems.reset();
+                for (unsigned i = 0; i < n; ++i)
+                    elems.push_back(src[i].load(std::memory_order_relaxed));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sl.m_seq.load(std::memory_order_relaxed) == seq) {
+                    ++head;
+                    if (o != owner)
+                        return true;
+                    continue;
+                }
             }
-            head = m_heads[owner];
+            // the clause was overwritten by a writer that wrapped around.
+            ++num_dropped;
+            ++head;
         }
-        return false;
     }
 
-    parallel::parallel(solver& s): m_num_clauses(0), m_consumer_ready(false), m_scoped_rlimit(s.rlimit()) {}
+    parallel::parallel(solver& s): 
+        m_units_tail(0),
+        m_export_glue(s.get_config().m_par_export_glue),
+        m_export_size(std::max(2u, s.get_config().m_par_export_size)),
+        m_num_clauses(0), m_consumer_ready(false), m_scoped_rlimit(s.rlimit()) {}
 
     parallel::~parallel() {
         for (unsigned i = 0; i < m_solvers.size(); ++i) {            
             dealloc(m_solvers[i]);
         }
+        if (m_units) {
+            dealloc_vect(m_units, m_num_lits);
+            dealloc_vect(m_unit_seen, m_num_lits);
+        }
+        if (m_hashes)
+            dealloc_vect(m_hashes, m_num_hashes);
+    }
+
+    void parallel::reserve(unsigned num_owners, unsigned num_vars, unsigned sz) {
+        SASSERT(!m_units && !m_hashes);
+        m_ring.reserve(sz, m_export_size);
+        m_heads.reset();
+        m_heads.resize(num_owners, 0);
+        m_stats.reset();
+        m_stats.resize(num_owners);
+        m_num_lits = 2 * num_vars;
+        m_units = alloc_vect<std::atomic<unsigned>>(m_num_lits);
+        m_unit_seen = alloc_vect<std::atomic<bool>>(m_num_lits);
+        m_num_hashes = 1;
+        while (m_num_hashes < 4 * sz)
+            m_num_hashes *= 2;
+        m_hashes = alloc_vect<std::atomic<uint64_t>>(m_num_hashes);
     }
 
     void parallel::init_solvers(solver& s, unsigned num_extra_solvers) {
@@ -126,80 +171,106 @@ namespace sat {
     void parallel::exchange(solver& s, literal_vector const& in, unsigned& limit, literal_vector& out) {
         if (s.get_config().m_num_threads == 1 || s.m_par_syncing_clauses) return;
         flet<bool> _disable_sync_clause(s.m_par_syncing_clauses, true);
-        {
-            lock_guard lock(m_mux);
-            if (limit < m_units.size()) {
-                // this might repeat some literals.
-                out.append(m_units.size() - limit, m_units.data() + limit);
-            }
-            for (unsigned i = 0; i < in.size(); ++i) {
-                literal lit = in[i];
-                if (!m_unit_set.contains(lit.index())) {
-                    m_unit_set.insert(lit.index());
-                    m_units.push_back(lit);
-                }
-            }
-            limit = m_units.size();
+        unsigned tail = std::min(m_units_tail.load(std::memory_order_acquire), m_num_lits);
+        for (; limit < tail; ++limit) {
+            // the unit at limit is claimed but not yet published.
+            unsigned idx = m_units[limit].load(std::memory_order_acquire);
+            if (idx == 0)
+                break;
+            out.push_back(to_literal(idx - 1));
+        }
+        for (literal lit : in) {
+            if (lit.index() >= m_num_lits || m_unit_seen[lit.index()].exchange(true))
+                continue;
+            unsigned pos = m_units_tail.fetch_add(1);
+            SASSERT(pos < m_num_lits);
+            m_units[pos].store(lit.index() + 1, std::memory_order_release);
         }
     }
 
+    static uint64_t hash_elem(unsigned e) {
+        uint64_t x = e + 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    // the hash of a clause does not depend on the order of its literals.
+    // two clauses that hash to the same entry evict each other, so
+    // only recently shared clauses are suppressed.
+    bool parallel::is_duplicate(unsigned n, unsigned const* elems) {
+        uint64_t h = n;
+        for (unsigned i = 0; i < n; ++i)
+            h += hash_elem(elems[i]);
+        if (h == 0)
+            h = 1;
+        return m_hashes[h & (m_num_hashes - 1)].exchange(h, std::memory_order_relaxed) == h;
+    }
+
+    void parallel::export_clause(solver& s, unsigned n, unsigned const* elems) {
+        par_stats& st = m_stats[s.m_par_id];
+        if (is_duplicate(n, elems))
+            ++st.m_duplicates;
+        else if (m_ring.push(s.m_par_id, n, elems))
+            ++st.m_exported;
+        else
+            ++st.m_dropped;
+    }
+
     void parallel::share_clause(solver& s, literal l1, literal l2) {        
         if (s.get_config().m_num_threads == 1 || s.m_par_syncing_clauses) return;
         flet<bool> _disable_sync_clause(s.m_par_syncing_clauses, true);
         IF_VERBOSE(3, verbose_stream() << s.m_par_id << ": share " <<  l1 << " " << l2 << "\n";);
-        {
-            lock_guard lock(m_mux);
-            m_pool.begin_add_vector(s.m_par_id, 2);
-            m_pool.add_vector_elem(l1.index());
-            m_pool.add_vector_elem(l2.index());            
-            m_pool.end_add_vector();
-        }        
+        unsigned elems[2] = { l1.index(), l2.index() };
+        export_clause(s, 2, elems);
     }
 
     void parallel::share_clause(solver& s, clause const& c) {        
-        if (s.get_config().m_num_threads == 1 || !enable_add(c) || s.m_par_syncing_clauses) return;
+        if (s.get_config().m_num_threads == 1 || s.m_par_syncing_clauses) return;
+        if (!enable_add(c)) {
+            ++m_stats[s.m_par_id].m_dropped;
+            return;
+        }
         flet<bool> _disable_sync_clause(s.m_par_syncing_clauses, true);
         unsigned n = c.size();
-        unsigned owner = s.m_par_id;
-        IF_VERBOSE(3, verbose_stream() << owner << ": share " <<  c << "\n";);
-        lock_guard lock(m_mux);
-        m_pool.begin_add_vector(owner, n);                
-        for (unsigned i = 0; i < n; ++i) {
-            m_pool.add_vector_elem(c[i].index());
-        }
-        m_pool.end_add_vector();        
+        IF_VERBOSE(3, verbose_stream() << s.m_par_id << ": share " <<  c << "\n";);
+        sbuffer<unsigned, 64> elems;
+        for (unsigned i = 0; i < n; ++i) 
+            elems.push_back(c[i].index());
+        export_clause(s, n, elems.data());
     }
 
     void parallel::get_clauses(solver& s) {
         if (s.m_par_syncing_clauses) return;
         flet<bool> _disable_sync_clause(s.m_par_syncing_clauses, true);
-        lock_guard lock(m_mux);
         _get_clauses(s);        
     }
 
     void parallel::_get_clauses(solver& s) {
-        unsigned n;
-        unsigned const* ptr;
         unsigned owner = s.m_par_id;
-        while (m_pool.get_vector(owner, n, ptr)) {
-            m_lits.reset();
+        par_stats& st = m_stats[owner];
+        unsigned_vector elems;
+        literal_vector lits;
+        while (m_ring.pop(owner, m_heads[owner], st.m_dropped, elems)) {
+            lits.reset();
             bool usable_clause = true;
-            for (unsigned i = 0; usable_clause && i < n; ++i) {
-                literal lit(to_literal(ptr[i]));                
-                m_lits.push_back(lit);
+            for (unsigned i = 0; usable_clause && i < elems.size(); ++i) {
+                literal lit(to_literal(elems[i]));
+                lits.push_back(lit);
                 usable_clause = lit.var() <= s.m_par_num_vars && !s.was_eliminated(lit.var());
             }
-            IF_VERBOSE(3, verbose_stream() << s.m_par_id << ": retrieve " << m_lits << "\n";);
-            SASSERT(n >= 2);
+            IF_VERBOSE(3, verbose_stream() << s.m_par_id << ": retrieve " << lits << "\n";);
+            SASSERT(elems.size() >= 2);
             if (usable_clause) {
-                s.mk_clause_core(m_lits.size(), m_lits.data(), sat::status::redundant());
+                s.mk_clause_core(lits.size(), lits.data(), sat::status::redundant());
+                ++st.m_imported;
             }
         }        
     }
 
     bool parallel::enable_add(clause const& c) const {
         // plingeling, glucose heuristic:
-        return (c.size() <= 40 && c.glue() <= 8) || c.glue() <= 2;
+        return c.size() <= m_export_size && c.glue() <= m_export_glue;
     }
 
     void parallel::_from_solver(solver& s) {
@@ -274,6 +345,31 @@ namespace sat {
         }        
         return copied;
     }
+
+    void parallel::collect_statistics(statistics& st) const {
+        par_stats total;
+        for (unsigned i = 0; i < m_stats.size(); ++i) {
+            par_stats const& ps = m_stats[i];
+            IF_VERBOSE(2, verbose_stream() << "(sat-parallel :thread " << i << " :exported " << ps.m_exported << " :imported " << ps.m_imported
+                       << " :dropped " << ps.m_dropped << " :duplicates " << ps.m_duplicates << ")\n";);
+            // the statistics keep the keys, symbols are not deallocated
+            auto thread_key = [i](char const* name) {
+                return symbol(("sat par thread " + std::to_string(i) + " " + name).c_str()).bare_str();
+            };
+            st.update(thread_key("exported"), ps.m_exported);
+            st.update(thread_key("imported"), ps.m_imported);
+            st.update(thread_key("dropped"), ps.m_dropped);
+            st.update(thread_key("duplicates"), ps.m_duplicates);
+            total.m_exported += ps.m_exported;
+            total.m_imported += ps.m_imported;
+            total.m_dropped += ps.m_dropped;
+            total.m_duplicates += ps.m_duplicates;
+        }
+        st.update("sat par exported", total.m_exported);
+        st.update("sat par imported", total.m_imported);
+        st.update("sat par dropped", total.m_dropped);
+        st.update("sat par duplicates", total.m_duplicates);
+    }
     
 };
 
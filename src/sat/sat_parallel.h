@@ -24,28 +24,49 @@ Revision History:
 #include "util/rlimit.h"
 #include "util/scoped_ptr_vector.h"
 #include "util/mutex.h"
+#include "util/statistics.h"
+#include <atomic>
 
 namespace sat {
 
     class parallel {
+    public:
 
-        // shared pool of learned clauses.
-        class vector_pool {
-            unsigned_vector m_vectors;
-            unsigned        m_size{ 0 };
-            unsigned        m_tail{ 0 };
-            unsigned_vector m_heads;
-            bool_vector   m_at_end;
-            void next(unsigned& index);
-            unsigned get_owner(unsigned index) const { return m_vectors[index]; }
-            unsigned get_length(unsigned index) const { return m_vectors[index+1]; }
-            unsigned const* get_ptr(unsigned index) const { return m_vectors.data() + index + 2; }
+        // shared ring of learned clauses.
+        // producers claim a position by incrementing the tail and
+        // publish the clause in the slot of the position, readers
+        // keep their own cursor. The sequence number of a slot is 2*pos+1
+        // while the clause at position pos is written and 2*pos+2 when it
+        // is complete. Readers that fall behind by more than the number
+        // of slots lose the overwritten clauses.
+        class clause_ring {
+            struct slot {
+                std::atomic<uint64_t> m_seq;
+                std::atomic<unsigned> m_owner;
+                std::atomic<unsigned> m_size;
+            };
+            slot*                  m_slots = nullptr;
+            std::atomic<unsigned>* m_elems = nullptr;    // m_capacity elements per slot
+            unsigned               m_num_slots = 0;
+            unsigned               m_capacity = 0;
+            std::atomic<uint64_t>  m_tail;
+            void dealloc_ring();
         public:
-            void reserve(unsigned num_owners, unsigned sz);
-            void begin_add_vector(unsigned owner, unsigned n);
-            void end_add_vector();
-            void add_vector_elem(unsigned e);
-            bool get_vector(unsigned owner, unsigned& n, unsigned const*& ptr);
+            clause_ring(): m_tail(0) {}
+            ~clause_ring() { dealloc_ring(); }
+            void reserve(unsigned num_slots, unsigned capacity);
+            unsigned capacity() const { return m_capacity; }
+            bool push(unsigned owner, unsigned n, unsigned const* elems);
+            bool pop(unsigned owner, uint64_t& head, unsigned& num_dropped, unsigned_vector& elems);
+        };
+
+    private:
+
+        struct par_stats {
+            unsigned m_exported = 0;
+            unsigned m_imported = 0;
+            unsigned m_dropped = 0;      // filtered, overwritten or lost in the ring
+            unsigned m_duplicates = 0;
         };
 
         bool enable_add(clause const& c) const;
@@ -54,13 +75,25 @@ namespace sat {
         bool _to_solver(solver& s);
         bool _from_solver(i_local_search& s);
         void _to_solver(i_local_search& s);
-
-        typedef hashtable<unsigned, u_hash, u_eq> index_set;
-        literal_vector m_units;
-        index_set      m_unit_set;
-        literal_vector m_lits;
-        vector_pool    m_pool;
-        mutex          m_mux;
+        bool is_duplicate(unsigned n, unsigned const* elems);
+        void export_clause(solver& s, unsigned n, unsigned const* elems);
+
+        // units are appended once each, the buffer holds every literal at most once.
+        std::atomic<unsigned>* m_units = nullptr;
+        std::atomic<bool>*     m_unit_seen = nullptr;
+        unsigned               m_num_lits = 0;
+        std::atomic<unsigned>  m_units_tail;
+
+        // lossy filter of the hashes of recently shared clauses.
+        std::atomic<uint64_t>* m_hashes = nullptr;
+        unsigned               m_num_hashes = 0;
+
+        unsigned           m_export_glue;
+        unsigned           m_export_size;
+        clause_ring        m_ring;
+        svector<uint64_t>  m_heads;    // read cursor of each owner
+        svector<par_stats> m_stats;    // updated only by the owner
+        mutex              m_mux;
 
         // for exchange with local search:
         unsigned           m_num_clauses;
@@ -82,8 +115,8 @@ namespace sat {
 
         void push_child(reslimit& rl);
 
-        // reserve space
-        void reserve(unsigned num_owners, unsigned sz) { m_pool.reserve(num_owners, sz); }
+        // reserve space for the owners, literals over num_vars variables and sz shared clauses.
+        void reserve(unsigned num_owners, unsigned num_vars, unsigned sz);
 
         solver& get_solver(unsigned i) { return *m_solvers[i]; }
 
@@ -108,6 +141,8 @@ namespace sat {
         void to_solver(i_local_search& s);
         
         bool copy_solver(solver& s);
+
+        void collect_statistics(statistics& st) const;
     };
 
 };
@@ -29,6 +29,7 @@ Revision History:
 #include "sat/sat_solver.h"
 #include "sat/sat_integrity_checker.h"
 #include "sat/sat_lookahead.h"
+#include "sat/sat_cube_and_conquer.h"
 #include "sat/sat_ddfw.h"
 #include "sat/sat_prob.h"
 #include "sat/sat_anf_simplifier.h"
@@ -55,6 +56,7 @@ namespace sat {
         m_probing(*this, p),
         m_mus(*this),
         m_binspr(*this),
+        m_vivifier(*this),
         m_inconsistent(false),
         m_searching(false),
         m_conflict(justification(0)),
@@ -225,6 +227,7 @@ namespace sat {
                         ++num_learned;
                         c1->set_glue(c->glue());
                         c1->set_psm(c->psm());
+                        c1->set_tier(c->tier());
                     }
                 }
             }
@@ -1073,8 +1076,10 @@ namespace sat {
             m_stats.m_propagate++;          
             c.mark_used();                                          
             assign_core(c[0], justification(assign_level, cls_off)); 
-            if (update && c.is_learned() && c.glue() > 2 && num_diff_levels_below(c.size(), c.begin(), c.glue() - 1, glue)) 
-                c.set_glue(glue);                                   \
+            if (update && c.is_learned() && c.glue() > 2 && num_diff_levels_below(c.size(), c.begin(), c.glue() - 1, glue)) {
+                c.set_glue(glue);
+                promote(c);
+            }
     }
 
     void solver::set_watch(clause& c, unsigned idx, clause_offset cls_off) {
@@ -1340,6 +1345,10 @@ namespace sat {
             m_cleaner(true);
             return do_local_search(num_lits, lits);
         }
+        if (m_config.m_cube_and_conquer && !m_par && !m_ext) {
+            SASSERT(scope_lvl() == 0);
+            return check_cube_and_conquer(num_lits, lits);
+        }
         if ((m_config.m_num_threads > 1 || m_config.m_local_search_threads > 0 || 
              m_config.m_ddfw_threads > 0) && !m_par && !m_ext) {
             SASSERT(scope_lvl() == 0);
@@ -1481,7 +1490,18 @@ namespace sat {
     lbool solver::check_par(unsigned num_lits, literal const* lits) {
         return l_undef;
     }
+
+    lbool solver::check_cube_and_conquer(unsigned num_lits, literal const* lits) {
+        return l_undef;
+    }
 #else
+    lbool solver::check_cube_and_conquer(unsigned num_lits, literal const* lits) {
+        if (!rlimit().inc())
+            return l_undef;
+        cube_and_conquer cc(*this);
+        return cc(num_lits, lits);
+    }
+
     lbool solver::check_par(unsigned num_lits, literal const* lits) {
         if (!rlimit().inc()) {
             return l_undef;
@@ -1520,7 +1540,7 @@ namespace sat {
 #define IS_MAIN_SOLVER(i)  (i == main_solver_offset)
 
         sat::parallel par(*this);
-        par.reserve(num_threads, 1 << 12);
+        par.reserve(num_threads, num_vars(), 1 << 12);
         par.init_solvers(*this, num_extra_solvers);
         for (unsigned i = 0; i < ls.size(); ++i) {
             par.push_child(ls[i]->rlimit());
@@ -1602,6 +1622,7 @@ namespace sat {
         for (auto & th : threads) {
             th.join();
         }
+        par.collect_statistics(m_aux_stats);
         
         if (IS_AUX_SOLVER(finished_id)) {
             m_stats = par.get_solver(finished_id).m_stats;
@@ -2082,6 +2103,12 @@ namespace sat {
         CASSERT("sat_simplify_bug", check_invariant());
         m_asymm_branch(false);
 
+        if (m_config.m_vivify && !inconsistent()) {
+            m_vivifier();
+            CASSERT("sat_missed_prop", check_missed_propagation());
+            CASSERT("sat_simplify_bug", check_invariant());
+        }
+
         if (m_config.m_lookahead_simplify && !m_ext) {
             lookahead lh(*this);
             lh.simplify(true);
@@ -2673,6 +2700,7 @@ namespace sat {
         clause * lemma = mk_clause_core(m_lemma.size(), m_lemma.data(), sat::status::redundant());
         if (lemma) {
             lemma->set_glue(glue);
+            lemma->set_tier(tier_of(glue));
         }
         if (m_par && lemma) {
             m_par->share_clause(*this, *lemma);
@@ -3850,6 +3878,7 @@ namespace sat {
         m_scc.collect_statistics(st);
         m_asymm_branch.collect_statistics(st);
         m_probing.collect_statistics(st);
+        m_vivifier.collect_statistics(st);
         if (m_ext) m_ext->collect_statistics(st);
         if (m_local_search) m_local_search->collect_statistics(st);
         if (m_cut_simplifier) m_cut_simplifier->collect_statistics(st);
@@ -3862,6 +3891,7 @@ namespace sat {
         m_simplifier.reset_statistics();
         m_asymm_branch.reset_statistics();
         m_probing.reset_statistics();
+        m_vivifier.reset_statistics();
         m_aux_stats.reset();
     }
 
@@ -4835,6 +4865,7 @@ namespace sat {
         st.update("sat mk clause nary", m_mk_clause);
         st.update("sat mk var", m_mk_var);
         st.update("sat gc clause", m_gc_clause);
+        st.update("sat gc promoted", m_promoted);
         st.update("sat del clause", m_del_clause);
         st.update("sat conflicts", m_conflict);
         st.update("sat decisions", m_decision);
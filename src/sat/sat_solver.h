@@ -42,6 +42,7 @@ Revision History:
 #include "sat/sat_probing.h"
 #include "sat/sat_mus.h"
 #include "sat/sat_binspr.h"
+#include "sat/sat_vivifier.h"
 #include "sat/sat_drat.h"
 #include "sat/sat_parallel.h"
 #include "sat/sat_local_search.h"
@@ -68,6 +69,7 @@ namespace sat {
         unsigned m_decision;
         unsigned m_restart;
         unsigned m_gc_clause;
+        unsigned m_promoted;
         unsigned m_del_clause;
         unsigned m_minimized_lits;
         unsigned m_dyn_sub_res;
@@ -114,6 +116,7 @@ namespace sat {
         bool                    m_is_probing { false };
         mus                     m_mus;           // MUS for minimal core extraction
         binspr                  m_binspr;
+        vivifier                m_vivifier;
         bool                    m_inconsistent;
         bool                    m_searching;
         // A conflict is usually a single justification. That is, a justification
@@ -213,6 +216,7 @@ namespace sat {
         friend class asymm_branch;
         friend class big;
         friend class binspr;
+        friend class vivifier;
         friend class drat;
         friend class elim_eqs;
         friend class bcd;
@@ -224,6 +228,7 @@ namespace sat {
         friend class anf_simplifier;
         friend class cut_simplifier;
         friend class parallel;
+        friend class cube_and_conquer;
         friend class lookahead;
         friend class local_search;
         friend class ddfw;
@@ -517,6 +522,9 @@ namespace sat {
         // collect n-ary clauses
         clause_vector const& clauses() const { return m_clauses; }
 
+        // changes whenever an irredundant clause is added, simplified or deleted
+        unsigned non_learned_generation() const { return m_stats.m_non_learned_generation; }
+
         // collect binary clauses
         void collect_bin_clauses(svector<bin_clause> & r, bool learned, bool learned_only) const;
 
@@ -591,6 +599,7 @@ namespace sat {
         void sort_watch_lits();
         void exchange_par();
         lbool check_par(unsigned num_lits, literal const* lits);
+        lbool check_cube_and_conquer(unsigned num_lits, literal const* lits);
         lbool do_local_search(unsigned num_lits, literal const* lits);
         lbool do_ddfw_search(unsigned num_lits, literal const* lits);
         lbool do_prob_search(unsigned num_lits, literal const* lits);
@@ -612,6 +621,18 @@ namespace sat {
         void save_psm();
         void gc_half(char const * st_name);
         void gc_dyn_psm();
+        void gc_tiered();
+        clause_tier tier_of(unsigned glue) const {
+            return glue <= m_config.m_gc_tier1 ? CORE_TIER : glue <= m_config.m_gc_tier2 ? TIER2 : LOCAL_TIER;
+        }
+        // move a learned clause to a better tier when its glue decreases.
+        void promote(clause& c) {
+            clause_tier t = tier_of(c.glue());
+            if (t < c.tier()) {
+                c.set_tier(t);
+                ++m_stats.m_promoted;
+            }
+        }
         bool activate_frozen_clause(clause & c);
         unsigned psm(clause const & c) const;
         bool can_delete(clause const & c) const;
@@ -0,0 +1,256 @@
+/*++
+Copyright (c) 2011 Microsoft Corporation
+
+Module Name:
+
+    sat_vivifier.cpp
+
+Abstract:
+
+    Clause vivification.
+
+--*/
+#include "sat/sat_vivifier.h"
+#include "sat/sat_solver.h"
+#include "util/stopwatch.h"
+#include "util/trace.h"
+
+namespace sat {
+
+    struct vivifier::report {
+        vivifier& m_vivifier;
+        stopwatch m_watch;
+        unsigned  m_vivified;
+        unsigned  m_elim_literals;
+        unsigned  m_propagations;
+        unsigned  m_units;
+        report(vivifier& v):
+            m_vivifier(v),
+            m_vivified(v.m_vivified),
+            m_elim_literals(v.m_elim_literals),
+            m_propagations(v.m_propagations),
+            m_units(v.s.init_trail_size()) {
+            m_watch.start();
+        }
+
+        ~report() {
+            m_watch.stop();
+            IF_VERBOSE(2,
+                       unsigned num_units = m_vivifier.s.init_trail_size() - m_units;
+                       verbose_stream() << " (sat-vivify :clauses " << (m_vivifier.m_vivified - m_vivified)
+                       << " :elim-literals " << (m_vivifier.m_elim_literals - m_elim_literals);
+                       if (num_units > 0) verbose_stream() << " :units " << num_units;
+                       verbose_stream() << " :propagations " << (m_vivifier.m_propagations - m_propagations)
+                       << mem_stat() << m_watch << ")\n";);
+        }
+    };
+
+    void vivifier::operator()() {
+        SASSERT(s.at_base_lvl());
+        if (s.inconsistent())
+            return;
+        s.propagate(false);
+        if (s.inconsistent())
+            return;
+        report _rpt(*this);
+        // the clause is detached while its literals are propagated, so the propagation must not be
+        // interrupted. The round is bounded by the budget and the resource limit is checked per clause.
+        solver::scoped_disable_checkpoint _sdc(s);
+        m_budget = s.m_config.m_vivify_limit;
+        process(s.m_clauses, m_next_clause, false);
+        process(s.m_learned, m_next_learned, true);
+    }
+
+    /**
+       \brief vivify the clauses from position next until the budget is exhausted,
+       and set next to the position where the next round continues.
+    */
+    void vivifier::process(clause_vector& clauses, unsigned& next, bool learned) {
+        unsigned sz = clauses.size();
+        unsigned start = next < sz ? next : 0;
+        bool stopped = false;
+        unsigned j = 0;
+        next = 0;
+        for (unsigned i = 0; i < sz; ++i) {
+            clause& c = *clauses[i];
+            bool keep = true;
+            if (i >= start && !stopped) {
+                if (m_budget <= 0 || s.inconsistent() || !s.rlimit().inc()) {
+                    stopped = true;
+                    next = j;
+                }
+                else if (!c.was_removed() && !c.frozen() && c.size() > 2 && (!learned || c.tier() == TIER2))
+                    keep = vivify(c);
+            }
+            if (keep)
+                clauses[j++] = &c;
+        }
+        clauses.shrink(j);
+    }
+
+    // return false if the clause was removed.
+    bool vivifier::vivify(clause& c) {
+        for (literal l : c)
+            if (s.value(l) != l_undef)
+                return true;
+        VERIFY(s.m_trail.size() == s.m_qhead);
+        scoped_detach scoped_d(s, c); // clause must not be used for propagation
+        m_trail_start = s.m_trail.size();
+        m_lits.reset();
+        s.push();
+        for (literal l : c) {
+            lbool val = s.value(l);
+            if (val == l_false)
+                continue;
+            if (val == l_true) {
+                analyze_implied(l);
+                break;
+            }
+            m_lits.push_back(l);
+            s.assign_scoped(~l);
+            s.propagate_core(false); // must not use propagate(), since check_missed_propagation may fail for c
+            if (s.inconsistent()) {
+                analyze_conflict();
+                break;
+            }
+        }
+        unsigned num_props = s.m_trail.size() - m_trail_start;
+        m_propagations += num_props;
+        m_budget -= num_props;
+        s.pop(1);
+        SASSERT(m_lits.size() <= c.size());
+        if (m_lits.size() == c.size())
+            return true;
+        for (literal l : m_lits)
+            if (!c.contains(l))
+                return true;
+        TRACE("sat", tout << "vivify " << c << " to " << m_lits << "\n";);
+        // move the remaining literals to the front of the clause.
+        for (unsigned i = 0; i < m_lits.size(); ++i) {
+            unsigned j = i;
+            while (c[j] != m_lits[i])
+                ++j;
+            std::swap(c[i], c[j]);
+        }
+        ++m_vivified;
+        return re_attach(scoped_d, c);
+    }
+
+    void vivifier::mark_antecedent(literal l) {
+        bool_var v = l.var();
+        if (s.lvl(v) > 0 && !s.is_marked(v))
+            s.mark(v);
+    }
+
+    void vivifier::mark_antecedents(literal consequent, justification const& js) {
+        switch (js.get_kind()) {
+        case justification::NONE:
+            break;
+        case justification::BINARY:
+            mark_antecedent(js.get_literal());
+            break;
+#if ENABLE_TERNARY
+        case justification::TERNARY:
+            mark_antecedent(js.get_literal1());
+            mark_antecedent(js.get_literal2());
+            break;
+#endif
+        case justification::CLAUSE:
+            for (literal l : s.get_clause(js))
+                if (l != consequent)
+                    mark_antecedent(l);
+            break;
+        case justification::EXT_JUSTIFICATION:
+            s.fill_ext_antecedents(consequent, js, false);
+            for (literal l : s.m_ext_antecedents)
+                mark_antecedent(l);
+            break;
+        default:
+            UNREACHABLE();
+            break;
+        }
+    }
+
+    /**
+       \brief collect the falsified clause literals that the marked literals depend on
+       and unmark the literals.
+    */
+    void vivifier::collect_decisions() {
+        m_decisions.reset();
+        for (unsigned i = s.m_trail.size(); i-- > m_trail_start; ) {
+            literal l = s.m_trail[i];
+            if (!s.is_marked(l.var()))
+                continue;
+            s.reset_mark(l.var());
+            justification const& js = s.m_justification[l.var()];
+            if (js.is_none())
+                m_decisions.push_back(l);
+            else
+                mark_antecedents(l, js);
+        }
+    }
+
+    // the clause literal l is implied by the falsified literals.
+    void vivifier::analyze_implied(literal l) {
+        mark_antecedents(l, s.m_justification[l.var()]);
+        collect_decisions();
+        m_lits.reset();
+        m_lits.push_back(l);
+        for (literal d : m_decisions)
+            m_lits.push_back(~d);
+    }
+
+    // the falsified literals are in conflict.
+    void vivifier::analyze_conflict() {
+        if (s.m_not_l != null_literal) {
+            mark_antecedent(s.m_not_l);
+            mark_antecedents(~s.m_not_l, s.m_conflict);
+        }
+        else
+            mark_antecedents(null_literal, s.m_conflict);
+        collect_decisions();
+        m_lits.reset();
+        for (literal d : m_decisions)
+            m_lits.push_back(~d);
+    }
+
+    bool vivifier::re_attach(scoped_detach& scoped_d, clause& c) {
+        VERIFY(s.m_trail.size() == s.m_qhead);
+        unsigned old_sz = c.size();
+        unsigned new_sz = m_lits.size();
+        m_elim_literals += old_sz - new_sz;
+        switch (new_sz) {
+        case 0:
+            s.set_conflict();
+            return true;
+        case 1:
+            TRACE("sat", tout << "vivification produced unit clause: " << c[0] << "\n";);
+            s.assign_unit(c[0]);
+            s.propagate_core(false);
+            scoped_d.del_clause();
+            return false;
+        case 2:
+            VERIFY(s.value(c[0]) == l_undef && s.value(c[1]) == l_undef);
+            s.mk_bin_clause(c[0], c[1], c.is_learned());
+            if (s.m_trail.size() > s.m_qhead) s.propagate_core(false);
+            scoped_d.del_clause();
+            return false;
+        default:
+            s.shrink(c, old_sz, new_sz);
+            return true;
+        }
+    }
+
+    void vivifier::collect_statistics(statistics& st) const {
+        st.update("sat vivified clauses", m_vivified);
+        st.update("sat vivified literals", m_elim_literals);
+        st.update("sat vivify propagations", m_propagations);
+    }
+
+    void vivifier::reset_statistics() {
+        m_vivified = 0;
+        m_elim_literals = 0;
+        m_propagations = 0;
+    }
+
+};
@@ -0,0 +1,69 @@
+/*++
+Copyright (c) 2011 Microsoft Corporation
+
+Module Name:
+
+    sat_vivifier.h
+
+Abstract:
+
+    Clause vivification.
+
+    The literals of a clause are falsified one by one and propagated
+    while the clause is detached. If a literal of the clause becomes true,
+    or propagation produces a conflict, conflict analysis determines the
+    falsified literals the implication depends on and the clause is
+    shortened to these literals (and the implied literal).
+    Literals that become false are removed.
+
+    Irredundant clauses and learned clauses of tier2 are vivified.
+    A round is bounded by the number of propagated literals and the next
+    round continues where the previous one stopped.
+
+--*/
+#pragma once
+
+#include "sat/sat_types.h"
+#include "sat/sat_clause.h"
+#include "sat/sat_justification.h"
+#include "util/statistics.h"
+
+namespace sat {
+    class solver;
+    class scoped_detach;
+
+    class vivifier {
+        struct report;
+
+        solver&        s;
+        unsigned       m_trail_start = 0;   // first literal of the vivification scope
+        int64_t        m_budget = 0;
+        unsigned       m_next_clause = 0;
+        unsigned       m_next_learned = 0;
+        literal_vector m_lits;
+        literal_vector m_decisions;
+
+        // stats
+        unsigned       m_vivified = 0;
+        unsigned       m_elim_literals = 0;
+        unsigned       m_propagations = 0;
+
+        void process(clause_vector& clauses, unsigned& next, bool learned);
+        bool vivify(clause& c);
+        void mark_antecedent(literal l);
+        void mark_antecedents(literal consequent, justification const& js);
+        void analyze_implied(literal l);
+        void analyze_conflict();
+        void collect_decisions();
+        bool re_attach(scoped_detach& scoped_d, clause& c);
+
+    public:
+        vivifier(solver& s): s(s) {}
+
+        void operator()();
+
+        void collect_statistics(statistics& st) const;
+        void reset_statistics();
+    };
+
+};
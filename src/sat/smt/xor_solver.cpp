@@ -3,77 +3,602 @@ Copyright (c) 2014 Microsoft Corporation
 
 Module Name:
 
-    xor_solver.h
+    xor_solver.cpp
 
 Abstract:
 
     XOR solver.
-    Interface outline.
+    Gauss-Jordan elimination over the xor constraints
+    extracted from the clauses.
 
 --*/
 
-
+#include "util/mpz.h"
+#include "util/union_find.h"
 #include "sat/smt/xor_solver.h"
-#include "sat/sat_simplifier_params.hpp"
+#include "sat/smt/euf_solver.h"
 #include "sat/sat_xor_finder.h"
 
 namespace xr {
 
+    static inline bool parity64(uint64_t w) {
+        w ^= w >> 32;
+        return get_num_1bits(static_cast<unsigned>(w)) & 1;
+    }
+
+    void solver::matrix::add_row(unsigned dst, unsigned src) {
+        uint64_t* d = row(dst);
+        uint64_t const* s = row(src);
+        for (unsigned i = 0; i < m_num_words; ++i)
+            d[i] ^= s[i];
+    }
+
+    void solver::matrix::swap_rows(unsigned r1, unsigned r2) {
+        uint64_t* a = row(r1);
+        uint64_t* b = row(r2);
+        for (unsigned i = 0; i < m_num_words; ++i)
+            std::swap(a[i], b[i]);
+    }
+
+    void solver::matrix::assign(unsigned c, bool value) {
+        SASSERT(is_unassigned(c));
+        flip(m_unassigned.data(), c);
+        if (value != this->value(c))
+            flip(m_values.data(), c);
+    }
+
+    void solver::matrix::unassign(unsigned c) {
+        SASSERT(!is_unassigned(c));
+        flip(m_unassigned.data(), c);
+    }
+
+    /**
+       \brief parity of the assigned columns of the row that are true.
+    */
+    bool solver::matrix::parity(unsigned r) const {
+        uint64_t const* bits = row(r);
+        bool p = false;
+        for (unsigned i = 0; i < m_num_words; ++i)
+            p ^= parity64(bits[i] & m_values[i] & ~m_unassigned[i]);
+        return p;
+    }
+
     solver::solver(euf::solver& ctx):
-        th_solver(ctx.get_manager(), symbol("xor-solver"), ctx.get_manager().get_family_id("xor-solver"))
+        solver(ctx.get_manager(), ctx.get_manager().mk_family_id("xor-solver"))
+    {}
+
+    solver::solver(ast_manager& m, euf::theory_id id):
+        th_solver(m, symbol("xor-solver"), id)
     {}
 
     euf::th_solver* solver::clone(euf::solver& ctx) {
-        // and relevant copy internal state
-        return alloc(solver, ctx);
+        solver* result = alloc(solver, ctx);
+        result->m_xors.append(m_xors);
+        result->m_clause_epoch = m_clause_epoch;
+        result->m_dirty = true;
+        return result;
     }
 
-    void solver::asserted(sat::literal l) {
+    sat::extension* solver::copy(sat::solver* s) {
+        solver* result = alloc(solver, m, get_id());
+        result->set_solver(s);
+        result->m_xors.append(m_xors);
+        result->m_clause_epoch = m_clause_epoch;
+        result->m_dirty = true;
+        return result;
+    }
+
+    /**
+       \brief add the constraint: the xor of the variables equals rhs.
+       Duplicate variables cancel out.
+    */
+    void solver::add_xor(sat::bool_var_vector const& vars, bool rhs) {
+        constraint c;
+        c.m_rhs = rhs;
+        c.m_vars.append(vars);
+        std::sort(c.m_vars.begin(), c.m_vars.end());
+        unsigned j = 0;
+        for (unsigned i = 0; i < c.m_vars.size(); ++i) {
+            if (i + 1 < c.m_vars.size() && c.m_vars[i] == c.m_vars[i + 1])
+                ++i;
+            else
+                c.m_vars[j++] = c.m_vars[i];
+        }
+        c.m_vars.shrink(j);
+        for (sat::bool_var v : c.m_vars)
+            s().set_external(v);
+        m_xors.push_back(c);
+        m_dirty = true;
+    }
+
+    /**
+       \brief add an xor found by xor_finder: the xor of the literals is true.
+    */
+    void solver::add_xor(sat::literal_vector const& lits) {
+        sat::bool_var_vector vars;
+        bool rhs = true;
+        for (sat::literal l : lits) {
+            vars.push_back(l.var());
+            rhs ^= l.sign();
+        }
+        add_xor(vars, rhs);
+    }
+
+    void solver::extract_xors() {
+        m_xors.reset();
+        m_clause_epoch = s().non_learned_generation();
+        std::function<void(sat::literal_vector const&)> f =
+            [&, this](sat::literal_vector const& lits) {
+            add_xor(lits);
+        };
+        sat::xor_finder xf(s());
+        xf.set(f);
+        sat::clause_vector clauses(s().clauses());
+        xf(clauses);
+        // the clauses of the xors are not removed
+        for (sat::clause* cp : xf.removed_clauses())
+            cp->unmark_used();
+        m_dirty = true;
+        TRACE("xor", display(tout););
+    }
+
+    void solver::reset_matrices() {
+        m_matrices.reset();
+        m_var2matrix.reset();
+        m_var2col.reset();
+        m_trail.reset();
+        m_queue.reset();
+        m_qhead = 0;
+        m_row_queue.reset();
+    }
+
+    /**
+       \brief build the matrices of the connected components of the xors.
+       Variables assigned at base level are replaced by their values.
+    */
+    void solver::rebuild() {
+        SASSERT(s().at_base_lvl());
+        SASSERT(m_lim.empty());
+        reset_matrices();
+        m_dirty = false;
+        m_trail_epoch = s().init_trail_size();
+        m_stats.m_num_matrices = 0;
+        if (s().inconsistent())
+            return;
+
+        vector<constraint> xors;
+        basic_union_find uf;
+        for (constraint const& x : m_xors) {
+            constraint c;
+            c.m_rhs = x.m_rhs;
+            for (sat::bool_var v : x.m_vars) {
+                if (s().value(v) == l_undef)
+                    c.m_vars.push_back(v);
+                else if (s().value(v) == l_true)
+                    c.m_rhs = !c.m_rhs;
+            }
+            if (c.m_vars.empty()) {
+                if (c.m_rhs) {
+                    s().set_conflict(sat::justification(0));
+                    return;
+                }
+                continue;
+            }
+            for (unsigned i = 1; i < c.m_vars.size(); ++i)
+                uf.merge(c.m_vars[0], c.m_vars[i]);
+            xors.push_back(c);
+        }
+
+        unsigned max_vars = s().get_config().m_xor_max_vars;
+        unsigned_vector root2comp;
+        vector<unsigned_vector> comp2xors;
+        vector<sat::bool_var_vector> comp2vars;
+        for (unsigned i = 0; i < xors.size(); ++i) {
+            unsigned root = uf.find(xors[i].m_vars[0]);
+            root2comp.reserve(root + 1, UINT_MAX);
+            if (root2comp[root] == UINT_MAX) {
+                root2comp[root] = comp2xors.size();
+                comp2xors.push_back(unsigned_vector());
+                comp2vars.push_back(sat::bool_var_vector());
+            }
+            comp2xors[root2comp[root]].push_back(i);
+        }
+        for (unsigned comp = 0; comp < comp2xors.size(); ++comp) {
+            auto& vars = comp2vars[comp];
+            unsigned root = uf.find(xors[comp2xors[comp][0]].m_vars[0]);
+            unsigned v = root;
+            do {
+                vars.push_back(v);
+                v = uf.next(v);
+            }
+            while (v != root);
+            // large components stay with the clauses
+            if (vars.size() > max_vars)
+                continue;
+            mk_matrix(xors, comp2xors[comp], vars);
+            if (s().inconsistent())
+                return;
+        }
+        m_stats.m_num_matrices = m_matrices.size();
+        IF_VERBOSE(10, verbose_stream() << "(sat.xor :xors " << m_xors.size() << " :matrices " << m_matrices.size() << ")\n");
+        unit_propagate();
+    }
+
+    /**
+       \brief create the matrix of the xors ids (over the variables vars)
+       and bring it to reduced row echelon form.
+    */
+    void solver::mk_matrix(vector<constraint> const& xors, unsigned_vector const& ids, sat::bool_var_vector const& vars) {
+        unsigned mi = m_matrices.size();
+        matrix* mx = alloc(matrix);
+        m_matrices.push_back(mx);
+        matrix& M = *mx;
+        M.m_num_cols = vars.size();
+        M.m_num_words = M.m_num_cols / 64 + 1;
+        M.m_col2var.append(vars);
+        for (unsigned c = 0; c < M.m_num_cols; ++c) {
+            m_var2matrix.reserve(vars[c] + 1, UINT_MAX);
+            m_var2col.reserve(vars[c] + 1, UINT_MAX);
+            m_var2matrix[vars[c]] = mi;
+            m_var2col[vars[c]] = c;
+            s().set_external(vars[c]);
+        }
+        unsigned num_rows = ids.size();
+        M.m_bits.resize(num_rows * M.m_num_words, 0);
+        for (unsigned r = 0; r < num_rows; ++r) {
+            constraint const& x = xors[ids[r]];
+            for (sat::bool_var v : x.m_vars)
+                matrix::flip(M.row(r), m_var2col[v]);
+            if (x.m_rhs)
+                matrix::flip(M.row(r), M.m_num_cols);
+        }
+
+        // Gauss-Jordan elimination
+        M.m_col_row.resize(M.m_num_cols, UINT_MAX);
+        unsigned rank = 0;
+        for (unsigned c = 0; c < M.m_num_cols && rank < num_rows; ++c) {
+            unsigned p = rank;
+            while (p < num_rows && !matrix::get(M.row(p), c))
+                ++p;
+            if (p == num_rows)
+                continue;
+            if (p != rank)
+                M.swap_rows(p, rank);
+            for (unsigned r = 0; r < num_rows; ++r)
+                if (r != rank && matrix::get(M.row(r), c))
+                    M.add_row(r, rank);
+            M.m_row_basic.push_back(c);
+            M.m_col_row[c] = rank;
+            ++rank;
+        }
+        // the remaining rows are 0 = rhs
+        for (unsigned r = rank; r < num_rows; ++r) {
+            if (M.rhs(r)) {
+                s().set_conflict(sat::justification(0));
+                return;
+            }
+        }
+        M.m_bits.shrink(rank * M.m_num_words);
 
+        M.m_row_watch.resize(rank, UINT_MAX);
+        M.m_row_stamp.resize(rank, 0);
+        M.m_col_watch.resize(M.m_num_cols);
+        M.m_unassigned.resize(M.m_num_words, 0);
+        M.m_values.resize(M.m_num_words, 0);
+        for (unsigned c = 0; c < M.m_num_cols; ++c)
+            matrix::flip(M.m_unassigned.data(), c);
+        for (unsigned r = 0; r < rank; ++r)
+            m_row_queue.push_back({ mi, r });
+    }
+
+    void solver::asserted(sat::literal l) {
+        sat::bool_var v = l.var();
+        if (v >= m_var2matrix.size() || m_var2matrix[v] == UINT_MAX)
+            return;
+        matrix& M = *m_matrices[m_var2matrix[v]];
+        unsigned c = m_var2col[v];
+        if (M.is_unassigned(c)) {
+            M.assign(c, !l.sign());
+            m_trail.push_back(v);
+        }
+        m_queue.push_back(v);
     }
 
     bool solver::unit_propagate() {
-        return false;
+        unsigned num_props = m_stats.m_num_propagations + m_stats.m_num_conflicts;
+        while (!s().inconsistent()) {
+            if (!m_row_queue.empty()) {
+                auto [mi, r] = m_row_queue.back();
+                m_row_queue.pop_back();
+                if (mi < m_matrices.size() && r < m_matrices[mi]->num_rows())
+                    update_row(mi, r);
+            }
+            else if (m_qhead < m_queue.size())
+                propagate_var(m_queue[m_qhead++]);
+            else
+                break;
+        }
+        if (m_qhead == m_queue.size()) {
+            m_queue.reset();
+            m_qhead = 0;
+        }
+        return num_props != m_stats.m_num_propagations + m_stats.m_num_conflicts;
+    }
+
+    /**
+       \brief process the rows of column of v: the row where it is basic
+       and the rows that watch it.
+    */
+    void solver::propagate_var(sat::bool_var v) {
+        unsigned mi = m_var2matrix[v];
+        matrix& M = *m_matrices[mi];
+        unsigned c = m_var2col[v];
+        unsigned r = M.m_col_row[c];
+        if (r != UINT_MAX)
+            update_row(mi, r);
+        auto& ws = M.m_col_watch[c];
+        m_rows.reset();
+        m_rows.append(ws);
+        ws.reset();
+        ++M.m_stamp;
+        for (unsigned r : m_rows) {
+            if (M.m_row_watch[r] != c || M.m_row_stamp[r] == M.m_stamp)
+                continue;
+            M.m_row_stamp[r] = M.m_stamp;
+            if (!s().inconsistent())
+                update_row(mi, r);
+            if (M.m_row_watch[r] == c)
+                ws.push_back(r);
+        }
+    }
+
+    /**
+       \brief update row r of matrix mi after some of its columns were assigned.
+       - with no unassigned column the row is either satisfied or a conflict.
+       - with one unassigned column the column is propagated.
+       - otherwise the basic column and the watched column are made unassigned,
+         pivoting the row on another column if its basic column is assigned.
+    */
+    void solver::update_row(unsigned mi, unsigned r) {
+        matrix& M = *m_matrices[mi];
+        uint64_t const* bits = M.row(r);
+        unsigned u1 = UINT_MAX, u2 = UINT_MAX;
+        for (unsigned i = 0; i < M.m_num_words && u2 == UINT_MAX; ++i) {
+            uint64_t w = bits[i] & M.m_unassigned[i];
+            for (; w && u2 == UINT_MAX; w &= w - 1) {
+                unsigned c = 64 * i + trailing_zeros(w);
+                if (u1 == UINT_MAX)
+                    u1 = c;
+                else
+                    u2 = c;
+            }
+        }
+
+        if (u2 == UINT_MAX) {
+            // value of the unassigned column forced by the row
+            bool val = M.rhs(r) ^ M.parity(r);
+            if (u1 == UINT_MAX) {
+                if (val) {
+                    ++m_stats.m_num_conflicts;
+                    TRACE("xor", tout << "conflict row " << r << "\n";);
+                    s().set_conflict(mk_justification(M, r, UINT_MAX));
+                }
+                return;
+            }
+            sat::bool_var v = M.m_col2var[u1];
+            sat::literal lit(v, !val);
+            if (s().value(lit) == l_true)
+                return;
+            ++m_stats.m_num_propagations;
+            TRACE("xor", tout << "propagate " << lit << " row " << r << "\n";);
+            s().assign(lit, mk_justification(M, r, u1));
+            if (!s().inconsistent() && M.is_unassigned(u1)) {
+                M.assign(u1, val);
+                m_trail.push_back(v);
+                m_queue.push_back(v);
+            }
+            return;
+        }
+
+        unsigned b = M.m_row_basic[r];
+        if (!M.is_unassigned(b)) {
+            pivot(mi, r, u1);
+            b = u1;
+        }
+        unsigned w = M.m_row_watch[r];
+        if (w == UINT_MAX || w == b || !M.is_unassigned(w) || !matrix::get(bits, w))
+            w = (u1 == b) ? u2 : u1;
+        set_watch(M, r, w);
+    }
+
+    /**
+       \brief make c the basic column of row r.
+       Row r is added to the other rows containing c.
+    */
+    void solver::pivot(unsigned mi, unsigned r, unsigned c) {
+        matrix& M = *m_matrices[mi];
+        SASSERT(M.m_col_row[c] == UINT_MAX);
+        ++m_stats.m_num_pivots;
+        for (unsigned r2 = 0; r2 < M.num_rows(); ++r2) {
+            if (r2 != r && matrix::get(M.row(r2), c)) {
+                M.add_row(r2, r);
+                m_row_queue.push_back({ mi, r2 });
+            }
+        }
+        M.m_col_row[M.m_row_basic[r]] = UINT_MAX;
+        M.m_col_row[c] = r;
+        M.m_row_basic[r] = c;
+    }
+
+    void solver::set_watch(matrix& M, unsigned r, unsigned c) {
+        if (M.m_row_watch[r] == c)
+            return;
+        M.m_row_watch[r] = c;
+        M.m_col_watch[c].push_back(r);
+    }
+
+    /**
+       \brief justification by the true literals of the assigned columns of row r
+       except for column except.
+    */
+    sat::justification solver::mk_justification(matrix const& M, unsigned r, unsigned except) {
+        m_lits.reset();
+        uint64_t const* bits = M.row(r);
+        for (unsigned i = 0; i < M.m_num_words; ++i) {
+            uint64_t w = bits[i] & ~M.m_unassigned[i];
+            for (; w; w &= w - 1) {
+                unsigned c = 64 * i + trailing_zeros(w);
+                if (c == M.m_num_cols || c == except)
+                    continue;
+                m_lits.push_back(sat::literal(M.m_col2var[c], !M.value(c)));
+            }
+        }
+        void* mem = m_region.allocate(justification::get_obj_size(m_lits.size()));
+        sat::constraint_base::initialize(mem, this);
+        auto* j = new (sat::constraint_base::ptr2mem(mem)) justification(m_lits.size());
+        for (unsigned i = 0; i < m_lits.size(); ++i)
+            j->lits()[i] = m_lits[i];
+        return sat::justification::mk_ext_justification(s().scope_lvl(), j->to_index());
     }
-    
+
     void solver::get_antecedents(sat::literal l, sat::ext_justification_idx idx,
                                  sat::literal_vector & r, bool probing) {
-        
+        auto& j = justification::from_index(idx);
+        for (unsigned i = 0; i < j.m_num_lits; ++i)
+            r.push_back(j.lits()[i]);
     }
-    
+
     sat::check_result solver::check() {
         return sat::check_result::CR_DONE;
     }
-    
+
     void solver::push() {
+        m_lim.push_back(m_trail.size());
+        m_region.push_scope();
     }
-    
+
     void solver::pop(unsigned n) {
+        SASSERT(n <= m_lim.size());
+        unsigned new_lvl = m_lim.size() - n;
+        unsigned old_sz = m_lim[new_lvl];
+        m_lim.shrink(new_lvl);
+        unsigned j = old_sz;
+        for (unsigned i = old_sz; i < m_trail.size(); ++i) {
+            sat::bool_var v = m_trail[i];
+            // variables assigned below the new level stay assigned (chronological backtracking)
+            if (s().value(v) != l_undef && s().lvl(v) <= new_lvl) {
+                m_trail[j++] = v;
+                continue;
+            }
+            unsigned mi = m_var2matrix[v];
+            matrix& M = *m_matrices[mi];
+            unsigned c = m_var2col[v];
+            M.unassign(c);
+            // rows pivoted at the popped levels may keep an assigned basic or watched column,
+            // they are updated again.
+            unsigned r = M.m_col_row[c];
+            if (r != UINT_MAX && M.m_row_watch[r] != UINT_MAX && !M.is_unassigned(M.m_row_watch[r]))
+                m_row_queue.push_back({ mi, r });
+            for (unsigned r2 : M.m_col_watch[c])
+                if (M.m_row_watch[r2] == c && !M.is_unassigned(M.m_row_basic[r2]))
+                    m_row_queue.push_back({ mi, r2 });
+        }
+        m_trail.shrink(j);
+        m_region.pop_scope(n);
+    }
+
+    void solver::gc_vars(unsigned num_vars) {
+        unsigned j = 0;
+        for (constraint const& x : m_xors)
+            if (std::all_of(x.m_vars.begin(), x.m_vars.end(), [&](sat::bool_var v) { return v < num_vars; }))
+                m_xors[j++] = x;
+        m_xors.shrink(j);
+        if (m_var2matrix.size() > num_vars) {
+            reset_matrices();
+            m_dirty = true;
+        }
     }
 
     // inprocessing
-    // pre_simplify: decompile all xor constraints to allow other in-processing.
-    // simplify: recompile clauses to xor constraints
-    // literals that get added to xor constraints are tagged with the theory.
+    // the xors are extracted from the clauses when the search starts
+    // (again, if an irredundant clause was added, simplified or deleted),
+    // the matrices are rebuilt at base level (again, if new units were assigned).
+    void solver::init_search() {
+        if (s().inconsistent() || !s().at_base_lvl())
+            return;
+        if (m_clause_epoch != s().non_learned_generation())
+            extract_xors();
+        if (m_dirty || m_trail_epoch != s().init_trail_size())
+            rebuild();
+    }
+
+    // the clauses of the xors are kept, so they are available to the other in-processing.
     void solver::pre_simplify() {
-        
     }
 
     void solver::simplify() {
-        
+        if (m_dirty && !s().inconsistent() && s().at_base_lvl())
+            rebuild();
+    }
+
+    bool solver::check_model(sat::model const& m) const {
+        bool ok = true;
+        for (constraint const& x : m_xors) {
+            bool parity = false, has_undef = false;
+            for (sat::bool_var v : x.m_vars) {
+                has_undef |= m[v] == l_undef;
+                parity ^= m[v] == l_true;
+            }
+            if (!has_undef && parity != x.m_rhs) {
+                IF_VERBOSE(0, verbose_stream() << "xor violated:";
+                           for (sat::bool_var v : x.m_vars) verbose_stream() << " " << v;
+                           verbose_stream() << " = " << x.m_rhs << "\n");
+                ok = false;
+            }
+        }
+        return ok;
     }
 
     std::ostream& solver::display(std::ostream& out) const {
+        for (constraint const& x : m_xors) {
+            out << "xor";
+            for (sat::bool_var v : x.m_vars)
+                out << " " << v;
+            out << " = " << x.m_rhs << "\n";
+        }
+        for (unsigned mi = 0; mi < m_matrices.size(); ++mi) {
+            matrix const& M = *m_matrices[mi];
+            out << "matrix " << mi << " rows: " << M.num_rows() << " cols: " << M.m_num_cols << "\n";
+            for (unsigned r = 0; r < M.num_rows(); ++r) {
+                out << "  ";
+                for (unsigned c = 0; c < M.m_num_cols; ++c)
+                    if (matrix::get(M.row(r), c))
+                        out << M.m_col2var[c] << (M.is_unassigned(c) ? "" : (M.value(c) ? "=1" : "=0")) << " ";
+                out << "= " << M.rhs(r) << "\n";
+            }
+        }
         return out;
     }
-    
+
     std::ostream& solver::display_justification(std::ostream& out, sat::ext_justification_idx idx) const  {
+        auto& j = justification::from_index(idx);
+        out << "xor";
+        for (unsigned i = 0; i < j.m_num_lits; ++i)
+            out << " " << j.lits()[i];
         return out;
     }
-    
+
     std::ostream& solver::display_constraint(std::ostream& out, sat::ext_constraint_idx idx) const {
-        return out;
+        return display_justification(out, idx);
     }
-    
+
+    void solver::collect_statistics(statistics& st) const {
+        st.update("sat xor constraints", m_xors.size());
+        st.update("sat xor matrices", m_stats.m_num_matrices);
+        st.update("sat xor propagations", m_stats.m_num_propagations);
+        st.update("sat xor conflicts", m_stats.m_num_conflicts);
+        st.update("sat xor pivots", m_stats.m_num_pivots);
+    }
+
 }
 
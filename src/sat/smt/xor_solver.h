@@ -8,40 +8,153 @@ Module Name:
 Abstract:
 
     XOR solver.
-    Interface outline.
+
+    Xor constraints are extracted from the clauses by sat::xor_finder.
+    The constraints of each connected component (by shared variables)
+    are kept in a dense bit-packed matrix in reduced row echelon form.
+    Each row is watched by its basic column and one other unassigned column.
+    When a row has only one unassigned column left, the column is propagated,
+    when it has none and its parity is wrong, the row is a conflict.
+    Rows whose basic column gets assigned are pivoted on another
+    unassigned column (incremental Gauss-Jordan elimination).
+
+    The clauses that the xor constraints were extracted from are kept,
+    so the matrices only strengthen propagation.
 
 --*/
 
 #pragma once
 
-#include "sat/smt/euf_solver.h"
+#include "util/region.h"
+#include "sat/smt/sat_th.h"
 
 namespace xr {
+
     class solver : public euf::th_solver {
+
+        struct stats {
+            unsigned m_num_matrices;
+            unsigned m_num_propagations;
+            unsigned m_num_conflicts;
+            unsigned m_num_pivots;
+            void reset() { memset(this, 0, sizeof(*this)); }
+            stats() { reset(); }
+        };
+
+        // the xor of the variables equals m_rhs
+        struct constraint {
+            sat::bool_var_vector m_vars;
+            bool                 m_rhs;
+        };
+
+        // propagation or conflict, the literals are true
+        struct justification {
+            unsigned m_num_lits;
+            justification(unsigned n): m_num_lits(n) {}
+            sat::literal* lits() { return reinterpret_cast<sat::literal*>(this + 1); }
+            sat::literal const* lits() const { return reinterpret_cast<sat::literal const*>(this + 1); }
+            sat::ext_constraint_idx to_index() const {
+                return sat::constraint_base::mem2base(this);
+            }
+            static justification& from_index(size_t idx) {
+                return *reinterpret_cast<justification*>(sat::constraint_base::from_index(idx)->mem());
+            }
+            static size_t get_obj_size(unsigned n) { return sat::constraint_base::obj_size(sizeof(justification) + n * sizeof(sat::literal)); }
+        };
+
+        // xor constraints of a connected component in reduced row echelon form.
+        // the bit of column c of row r is bit c of the words of the row,
+        // the right-hand side of a row is the bit of column m_num_cols.
+        struct matrix {
+            unsigned                m_num_cols = 0;
+            unsigned                m_num_words = 0;  // words of a row
+            svector<uint64_t>       m_bits;           // rows of the matrix
+            sat::bool_var_vector    m_col2var;
+            unsigned_vector         m_row_basic;      // basic column of the row
+            unsigned_vector         m_col_row;        // row of a basic column, UINT_MAX for non-basic columns
+            unsigned_vector         m_row_watch;      // watched non-basic column of the row, UINT_MAX if none
+            vector<unsigned_vector> m_col_watch;      // rows watching the column (may be stale)
+            unsigned_vector         m_row_stamp;
+            unsigned                m_stamp = 0;
+            svector<uint64_t>       m_unassigned;     // columns unassigned in the xor solver
+            svector<uint64_t>       m_values;         // values of the assigned columns
+
+            unsigned num_rows() const { return m_row_basic.size(); }
+            uint64_t* row(unsigned r) { return m_bits.data() + r * m_num_words; }
+            uint64_t const* row(unsigned r) const { return m_bits.data() + r * m_num_words; }
+            static bool get(uint64_t const* bits, unsigned c) { return (bits[c / 64] >> (c % 64)) & 1; }
+            static void flip(uint64_t* bits, unsigned c) { bits[c / 64] ^= (1ull << (c % 64)); }
+            bool rhs(unsigned r) const { return get(row(r), m_num_cols); }
+            bool is_unassigned(unsigned c) const { return get(m_unassigned.data(), c); }
+            bool value(unsigned c) const { return get(m_values.data(), c); }
+            void add_row(unsigned dst, unsigned src);
+            void swap_rows(unsigned r1, unsigned r2);
+            void assign(unsigned c, bool value);
+            void unassign(unsigned c);
+            bool parity(unsigned r) const;
+        };
+
+        stats                    m_stats;
+        region                   m_region;
+        vector<constraint>       m_xors;
+        unsigned                 m_clause_epoch = UINT_MAX; // irredundant clause generation when the xors were extracted
+        unsigned                 m_trail_epoch = UINT_MAX;  // size of the base level trail when the matrices were built
+        bool                     m_dirty = false;           // the matrices have to be rebuilt
+        scoped_ptr_vector<matrix> m_matrices;
+        unsigned_vector          m_var2matrix;
+        unsigned_vector          m_var2col;
+        sat::bool_var_vector     m_trail;                   // variables assigned in the matrices
+        unsigned_vector          m_lim;
+        sat::bool_var_vector     m_queue;                   // assigned variables to propagate
+        unsigned                 m_qhead = 0;
+        svector<std::pair<unsigned, unsigned>> m_row_queue; // rows (matrix, row) changed by pivoting
+        unsigned_vector          m_rows;
+        sat::literal_vector      m_lits;
+
+        void extract_xors();
+        void add_xor(sat::literal_vector const& lits);
+        void reset_matrices();
+        void rebuild();
+        void mk_matrix(vector<constraint> const& xors, unsigned_vector const& ids, sat::bool_var_vector const& vars);
+        void propagate_var(sat::bool_var v);
+        void update_row(unsigned mi, unsigned r);
+        void pivot(unsigned mi, unsigned r, unsigned c);
+        void set_watch(matrix& mx, unsigned r, unsigned c);
+        sat::justification mk_justification(matrix const& mx, unsigned r, unsigned except);
+
     public:
         solver(euf::solver& ctx);
-        
+        solver(ast_manager& m, euf::theory_id id);
+
         th_solver* clone(euf::solver& ctx) override;
+        sat::extension* copy(sat::solver* s) override;
 
         sat::literal internalize(expr* e, bool sign, bool root)  override { UNREACHABLE(); return sat::null_literal; }
 
         void internalize(expr* e) override { UNREACHABLE(); }
 
+        void add_xor(sat::bool_var_vector const& vars, bool rhs);
 
         void asserted(sat::literal l) override;
         bool unit_propagate() override;
         void get_antecedents(sat::literal l, sat::ext_justification_idx idx, sat::literal_vector & r, bool probing) override;
 
+        void init_search() override;
         void pre_simplify() override;
         void simplify() override;
 
         sat::check_result check() override;
         void push() override;
         void pop(unsigned n) override;
+        void user_push() override {}
+        void user_pop(unsigned n) override { m_dirty = true; }
+        void gc_vars(unsigned num_vars) override;
+        bool check_model(sat::model const& m) const override;
 
         std::ostream& display(std::ostream& out) const override;
         std::ostream& display_justification(std::ostream& out, sat::ext_justification_idx idx) const override;
         std::ostream& display_constraint(std::ostream& out, sat::ext_constraint_idx idx) const override;
+        void collect_statistics(statistics& st) const override;
 
     };
 
@@ -42,6 +42,7 @@ Notes:
 #include "sat/sat_drat.h"
 #include "sat/tactic/goal2sat.h"
 #include "sat/smt/pb_solver.h"
+#include "sat/smt/xor_solver.h"
 #include "sat/smt/euf_solver.h"
 #include "sat/smt/sat_th.h"
 #include "sat/sat_params.hpp"
@@ -75,6 +76,7 @@ struct goal2sat::imp : public sat::sat_internalizer {
     func_decl_ref_vector        m_unhandled_funs;
     bool                        m_default_external;
     bool                        m_euf = false;
+    bool                        m_xor_solver = false;
     bool                        m_top_level = false;
     sat::literal_vector         aig_lits;
     
@@ -100,6 +102,7 @@ struct goal2sat::imp : public sat::sat_internalizer {
         m_ite_extra  = p.get_bool("ite_extra", true);
         m_max_memory = megabytes_to_bytes(p.get_uint("max_memory", UINT_MAX));
         m_euf = sp.euf();
+        m_xor_solver = sp.xor_solver();
     }
 
     void throw_op_not_handled(std::string const& s) {
@@ -697,6 +700,14 @@ struct goal2sat::imp : public sat::sat_internalizer {
             m_result_stack.push_back(lit);
     }
 
+    // the xor solver extracts xors from the clauses, it is only used without other extensions.
+    // a pb solver created later replaces it.
+    void ensure_xor_solver() {
+        if (!m_xor_solver || m_euf || m_solver.get_extension() || !dynamic_cast<sat::solver*>(&m_solver))
+            return;
+        m_solver.set_extension(alloc(xr::solver, m, m.mk_family_id("xor-solver")));
+    }
+
     void convert_ba(app* t, bool root, bool sign) {
         SASSERT(!m_euf);
         sat::extension* ext = dynamic_cast<pb::solver*>(m_solver.get_extension());
@@ -927,6 +938,7 @@ struct goal2sat::imp : public sat::sat_internalizer {
         // collect_boolean_interface(g, m_interface_vars);
         for (unsigned i = 0; i < n; ++i) 
             process(fmls[i]);
+        ensure_xor_solver();
     }
 
     void assumptions(unsigned n, expr* const* fmls) {
@@ -982,6 +994,7 @@ struct goal2sat::imp : public sat::sat_internalizer {
         skip_dep:
             ;
         }
+        ensure_xor_solver();
     }
 
     void update_model(model_ref& mdl) {
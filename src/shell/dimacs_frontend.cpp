@@ -27,6 +27,7 @@ Revision History:
 #include "sat/sat_solver.h"
 #include "sat/tactic/goal2sat.h"
 #include "sat/tactic/sat2goal.h"
+#include "sat/smt/xor_solver.h"
 #include "ast/reg_decl_plugins.h"
 #include "tactic/tactic.h"
 #include "tactic/fd_solver/fd_solver.h"
@@ -229,8 +230,11 @@ unsigned read_dimacs(char const * file_name) {
     p.set_bool("cardinality.solver", false);
     sat_params sp(p);
     reslimit limit;
+    ast_manager m;
     sat::solver solver(p, limit);
     g_solver = &solver;
+    if (sp.xor_solver())
+        solver.set_extension(alloc(xr::solver, m, m.mk_family_id("xor-solver")));
 
     if (file_name) {
         std::ifstream in(file_name);
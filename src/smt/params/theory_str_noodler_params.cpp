@@ -6,6 +6,11 @@ void theory_str_noodler_params::updt_params(params_ref const & _p) {
     smt_params_helper p(_p);
     m_underapproximation = p.str_underapprox();
     m_preprocess_red = p.str_preprocess_red();
+    m_parallel_threads = p.str_parallel_threads();
+    m_bounded_search_timeout = p.str_bounded_search_timeout();
+    m_bounded_search_max_length = p.str_bounded_search_max_length();
+    m_reduce_growth = p.str_reduce_growth();
+    m_reduce_min_states = p.str_reduce_min_states();
 }
 
 #define DISPLAY_PARAM(X) out << #X"=" << X << std::endl;
@@ -13,4 +18,9 @@ void theory_str_noodler_params::updt_params(params_ref const & _p) {
 void theory_str_noodler_params::display(std::ostream & out) const {
     DISPLAY_PARAM(m_underapproximation);
     DISPLAY_PARAM(m_preprocess_red);
+    DISPLAY_PARAM(m_parallel_threads);
+    DISPLAY_PARAM(m_bounded_search_timeout);
+    DISPLAY_PARAM(m_bounded_search_max_length);
+    DISPLAY_PARAM(m_reduce_growth);
+    DISPLAY_PARAM(m_reduce_min_states);
 }
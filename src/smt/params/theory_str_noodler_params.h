@@ -7,6 +7,11 @@ struct theory_str_noodler_params {
    
     bool m_underapproximation = false;
     bool m_preprocess_red = false;
+    unsigned m_parallel_threads = 0;
+    unsigned m_bounded_search_timeout = 10;
+    unsigned m_bounded_search_max_length = 16;
+    double m_reduce_growth = 2.0;
+    unsigned m_reduce_min_states = 32;
 
     theory_str_noodler_params(params_ref const & p = params_ref()) {
         updt_params(p);
@@ -0,0 +1,225 @@
+#include <algorithm>
+
+#include "bounded_search.h"
+
+namespace smt::noodler {
+
+    BoundedWordSearch::BoundedWordSearch(const Formula& formula, const AutAssignment& aut_ass, unsigned timeout)
+        : deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout)) {
+        for(const Predicate& pred : formula.get_predicates()) {
+            if(!pred.is_eq_or_ineq()) {
+                continue;
+            }
+            for(const auto& side : { pred.get_left_side(), pred.get_right_side() }) {
+                for(const BasicTerm& term : side) {
+                    if(!term.is_variable()) {
+                        continue;
+                    }
+                    auto& preds = this->var_predicates[term];
+                    if(preds.empty()) {
+                        // variables are assigned in the order of their first occurrence, so that the predicates can be
+                        // checked (and the assignments pruned) as soon as possible
+                        this->vars.push_back(term);
+                    }
+                    if(preds.empty() || preds.back() != this->predicates.size()) {
+                        preds.push_back(this->predicates.size());
+                    }
+                }
+            }
+            this->predicates.push_back(pred);
+        }
+        // variables with only regular constraints
+        std::vector<BasicTerm> other_vars;
+        for(const auto& var_aut : aut_ass) {
+            if(this->var_predicates.count(var_aut.first) == 0) {
+                other_vars.push_back(var_aut.first);
+            }
+        }
+        std::sort(other_vars.begin(), other_vars.end());
+        this->vars.insert(this->vars.end(), other_vars.begin(), other_vars.end());
+
+        for(const BasicTerm& var : this->vars) {
+            VarWords& var_words = this->var_words[var];
+            auto it = aut_ass.find(var);
+            var_words.aut = it != aut_ass.end() ? *it->second : aut_ass.sigma_star_automaton();
+            var_words.aut.trim();
+            var_words.words.emplace_back();
+            Mata::Nfa::StateSet initial;
+            for(Mata::Nfa::State state : var_words.aut.initial) {
+                initial.insert(state);
+                if(var_words.aut.final[state] && var_words.words[0].empty()) {
+                    var_words.words[0].emplace_back();
+                }
+            }
+            if(!initial.empty()) {
+                var_words.frontier.emplace_back(Mata::Word(), std::move(initial));
+            }
+            this->num_stored_words += var_words.words[0].size() + var_words.frontier.size();
+        }
+    }
+
+    std::optional<BoundedWordSearch::WordAssignment> BoundedWordSearch::search(unsigned max_length, const AcceptFunction& accept) {
+        for(unsigned length = 0; length <= max_length && !is_stopped(); length++) {
+            this->assignment.clear();
+            if(assign_vars(0, length, accept)) {
+                return this->assignment;
+            }
+
+            // if all the languages are known to be finite, there might be no longer assignments
+            unsigned max_total_length = 0;
+            bool is_finite = true;
+            for(const BasicTerm& var : this->vars) {
+                std::optional<unsigned> max_var_length = get_max_word_length(var);
+                if(!max_var_length.has_value()) {
+                    is_finite = false;
+                    break;
+                }
+                max_total_length += *max_var_length;
+            }
+            if(is_finite && max_total_length <= length) {
+                break;
+            }
+        }
+        return std::nullopt;
+    }
+
+    const std::vector<Mata::Word>* BoundedWordSearch::get_words(const BasicTerm& var, unsigned length) {
+        VarWords& var_words = this->var_words.at(var);
+        while(var_words.words.size() <= length) {
+            // extend the prefixes in the frontier by one symbol (the automaton is trimmed, so each prefix can be
+            // extended to some word of the language); the frontier grows by up to the size of the alphabet, so the
+            // budget and the limit of stored words are checked for each new prefix
+            std::vector<std::pair<Mata::Word, Mata::Nfa::StateSet>> new_frontier;
+            std::vector<Mata::Word> new_words;
+            for(const auto& [prefix, states] : var_words.frontier) {
+                if(is_stopped()) {
+                    return nullptr;
+                }
+                std::map<Mata::Symbol, Mata::Nfa::StateSet> symbol_post;
+                for(Mata::Nfa::State state : states) {
+                    for(const auto& move : var_words.aut.delta[state]) {
+                        Mata::Nfa::StateSet& post = symbol_post[move.symbol];
+                        for(Mata::Nfa::State target : move.targets) {
+                            post.insert(target);
+                        }
+                    }
+                }
+                for(auto& [symbol, post] : symbol_post) {
+                    if(this->num_stored_words + new_frontier.size() + new_words.size() >= MAX_STORED_WORDS || is_stopped()) {
+                        this->stopped = true;
+                        return nullptr;
+                    }
+                    Mata::Word word = prefix;
+                    word.push_back(symbol);
+                    if(std::any_of(post.begin(), post.end(), [&var_words](Mata::Nfa::State state) { return var_words.aut.final[state]; })) {
+                        new_words.push_back(word);
+                    }
+                    new_frontier.emplace_back(std::move(word), std::move(post));
+                }
+            }
+            // the prefixes of the shorter words are not needed anymore
+            this->num_stored_words += new_frontier.size() + new_words.size() - var_words.frontier.size();
+            var_words.frontier = std::move(new_frontier);
+            var_words.words.push_back(std::move(new_words));
+        }
+        return &var_words.words[length];
+    }
+
+    std::optional<unsigned> BoundedWordSearch::get_max_word_length(const BasicTerm& var) const {
+        const VarWords& var_words = this->var_words.at(var);
+        if(!var_words.frontier.empty()) {
+            return std::nullopt;
+        }
+        for(size_t length = var_words.words.size(); length > 0; length--) {
+            if(!var_words.words[length - 1].empty()) {
+                return length - 1;
+            }
+        }
+        return 0;
+    }
+
+    bool BoundedWordSearch::assign_vars(size_t index, unsigned remaining, const AcceptFunction& accept) {
+        if(index == this->vars.size()) {
+            return remaining == 0 && accept(this->assignment);
+        }
+
+        const BasicTerm& var = this->vars[index];
+        // the last variable takes the rest of the length, so that each assignment is found for exactly one bound
+        unsigned min_length = index + 1 == this->vars.size() ? remaining : 0;
+        for(unsigned length = min_length; length <= remaining; length++) {
+            const std::vector<Mata::Word>* words = get_words(var, length);
+            if(words == nullptr) {
+                return false;
+            }
+            for(const Mata::Word& word : *words) {
+                if(is_stopped()) {
+                    return false;
+                }
+                this->assignment[var] = word;
+                bool is_cons = true;
+                for(size_t pred_index : this->var_predicates[var]) {
+                    if(!is_consistent(this->predicates[pred_index])) {
+                        is_cons = false;
+                        break;
+                    }
+                }
+                if(is_cons && assign_vars(index + 1, remaining - length, accept)) {
+                    return true;
+                }
+            }
+        }
+        this->assignment.erase(var);
+        return false;
+    }
+
+    bool BoundedWordSearch::is_consistent(const Predicate& pred) const {
+        auto [left, left_full] = get_assigned_word(pred.get_left_side(), false);
+        auto [right, right_full] = get_assigned_word(pred.get_right_side(), false);
+        if(left_full && right_full) {
+            return pred.is_equation() ? left == right : left != right;
+        }
+        if(pred.is_inequation()) {
+            return true;
+        }
+
+        // the known prefixes (and suffixes) of the sides have to be compatible
+        auto is_compatible = [](const Mata::Word& word1, bool full1, const Mata::Word& word2, bool full2) {
+            if((full1 && word2.size() > word1.size()) || (full2 && word1.size() > word2.size())) {
+                return false;
+            }
+            size_t common = std::min(word1.size(), word2.size());
+            return std::equal(word1.begin(), word1.begin() + common, word2.begin());
+        };
+        if(!is_compatible(left, left_full, right, right_full)) {
+            return false;
+        }
+        auto [left_suffix, left_suffix_full] = get_assigned_word(pred.get_left_side(), true);
+        auto [right_suffix, right_suffix_full] = get_assigned_word(pred.get_right_side(), true);
+        return is_compatible(left_suffix, left_suffix_full, right_suffix, right_suffix_full);
+    }
+
+    std::pair<Mata::Word, bool> BoundedWordSearch::get_assigned_word(const std::vector<BasicTerm>& side, bool from_right) const {
+        Mata::Word res;
+        for(size_t i = 0; i < side.size(); i++) {
+            const BasicTerm& term = from_right ? side[side.size() - 1 - i] : side[i];
+            if(term.is_literal()) {
+                const zstring& lit = term.get_name();
+                for(unsigned j = 0; j < lit.length(); j++) {
+                    res.push_back(from_right ? lit[lit.length() - 1 - j] : lit[j]);
+                }
+                continue;
+            }
+            auto it = this->assignment.find(term);
+            if(it == this->assignment.end()) {
+                return { res, false };
+            }
+            if(from_right) {
+                res.insert(res.end(), it->second.rbegin(), it->second.rend());
+            } else {
+                res.insert(res.end(), it->second.begin(), it->second.end());
+            }
+        }
+        return { res, true };
+    }
+
+} // Namespace smt::noodler.
@@ -0,0 +1,115 @@
+#ifndef _NOODLER_BOUNDED_SEARCH_H_
+#define _NOODLER_BOUNDED_SEARCH_H_
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <mata/nfa.hh>
+#include "formula.h"
+#include "aut_assignment.h"
+
+namespace smt::noodler {
+
+    /**
+     * @brief Bounded-length search for solutions of (dis)equations with regular constraints.
+     *
+     * The search assigns words of the languages of the variables to the variables (one by one, with pruning of the
+     * assignments that already violate some (dis)equation) and looks for an assignment with the total length of the
+     * words at most some bound. The bound is increased iteratively (iterative deepening), so the shortest solutions
+     * are found first. It is an underapproximation meant for satisfiable instances with short solutions; it cannot
+     * prove unsatisfiability, so it stops either with a solution or when the time budget runs out or too many words
+     * would have to be stored (see MAX_STORED_WORDS).
+     */
+    class BoundedWordSearch {
+    public:
+        using WordAssignment = std::map<BasicTerm, Mata::Word>;
+        // function deciding whether a found assignment is a solution (e.g. whether the lengths of its words satisfy
+        // the length constraints), the search stops if it returns true
+        using AcceptFunction = std::function<bool(const WordAssignment&)>;
+
+        /**
+         * @param formula (Dis)equations of the instance (other predicates are ignored)
+         * @param aut_ass Regular constraints of the variables (variables without automata can be any words)
+         * @param timeout Time budget of the search in milliseconds
+         */
+        BoundedWordSearch(const Formula& formula, const AutAssignment& aut_ass, unsigned timeout);
+
+        /**
+         * @brief Search for a solution with the total length of the words at most @p max_length.
+         *
+         * @param accept Decides whether a found assignment is a solution
+         * @return The accepted solution if found within the time budget
+         */
+        std::optional<WordAssignment> search(unsigned max_length, const AcceptFunction& accept);
+
+        // maximal number of words and prefixes stored for all the variables together; the words of each length are
+        // needed again with each greater bound, so they are kept, and the search stops when there would be more of them
+        static constexpr size_t MAX_STORED_WORDS = 1 << 18;
+
+    private:
+        // words of the language of a variable, computed length by length
+        struct VarWords {
+            // trimmed automaton of the variable
+            Mata::Nfa::Nfa aut;
+            // words[n] are the words of the language of length n
+            std::vector<std::vector<Mata::Word>> words;
+            // prefixes of words of the language of length words.size() - 1 together with the states they lead to
+            std::vector<std::pair<Mata::Word, Mata::Nfa::StateSet>> frontier;
+        };
+
+        // (dis)equations of the instance
+        std::vector<Predicate> predicates;
+        // variables in the order in which they are assigned
+        std::vector<BasicTerm> vars;
+        // indices of the predicates in which the variable occurs
+        std::unordered_map<BasicTerm, std::vector<size_t>> var_predicates;
+        std::unordered_map<BasicTerm, VarWords> var_words;
+        std::chrono::steady_clock::time_point deadline;
+        // number of the words and the prefixes in the frontiers stored in var_words
+        size_t num_stored_words = 0;
+        // whether the time budget ran out or the limit of stored words was reached
+        bool stopped = false;
+        WordAssignment assignment;
+
+        /**
+         * @brief Get the words of @p var of length @p length (nullptr if the search was stopped).
+         */
+        const std::vector<Mata::Word>* get_words(const BasicTerm& var, unsigned length);
+        /**
+         * @brief Get the length of the longest word of @p var if its language is known to be finite (i.e. there are
+         * no prefixes of longer words in the frontier).
+         */
+        std::optional<unsigned> get_max_word_length(const BasicTerm& var) const;
+
+        /**
+         * @brief Assign the variables from @p index onwards so that the total length of the assignment is exactly
+         * @p remaining more than now.
+         * @return True if an accepted solution was found (it is then in assignment), false otherwise
+         */
+        bool assign_vars(size_t index, unsigned remaining, const AcceptFunction& accept);
+        /**
+         * @brief Check whether the (partial) assignment does not violate the predicate @p pred.
+         */
+        bool is_consistent(const Predicate& pred) const;
+        /**
+         * @brief Get the word of the concatenation @p side from the left (or from the right if @p from_right is
+         * true) up to the first variable that is not assigned.
+         * @return The word (reversed if @p from_right) and whether the whole side is assigned
+         */
+        std::pair<Mata::Word, bool> get_assigned_word(const std::vector<BasicTerm>& side, bool from_right) const;
+
+        bool is_stopped() {
+            if(!stopped && std::chrono::steady_clock::now() > deadline) {
+                stopped = true;
+            }
+            return stopped;
+        }
+    };
+
+} // Namespace smt::noodler.
+
+#endif //_NOODLER_BOUNDED_SEARCH_H_
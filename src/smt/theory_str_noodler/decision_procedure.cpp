@@ -10,7 +10,105 @@
 
 namespace smt::noodler {
 
-    void SolvingState::substitute_vars(std::unordered_map<BasicTerm, std::vector<BasicTerm>> &substitution_map) {
+    InclusionSet::InclusionSet(const std::set<Predicate> &inclusions) : inclusions(inclusions) {
+        rebuild_index();
+    }
+
+    InclusionSet& InclusionSet::operator=(const InclusionSet &other) {
+        if (this != &other) {
+            inclusions = other.inclusions;
+            rebuild_index();
+        }
+        return *this;
+    }
+
+    bool InclusionSet::insert(const Predicate &inclusion) {
+        auto [it, inserted] = inclusions.insert(inclusion);
+        if (inserted) {
+            index_inclusion(*it);
+        }
+        return inserted;
+    }
+
+    bool InclusionSet::erase(const Predicate &inclusion) {
+        auto it = inclusions.find(inclusion);
+        if (it == inclusions.end()) {
+            return false;
+        }
+        unindex_inclusion(*it);
+        inclusions.erase(it);
+        return true;
+    }
+
+    void InclusionSet::index_inclusion(const Predicate &inclusion) {
+        for (const BasicTerm &var : inclusion.get_left_side()) {
+            if (var.is_variable()) {
+                left_occurrences[var].insert(&inclusion);
+            }
+        }
+        for (const BasicTerm &var : inclusion.get_right_side()) {
+            if (var.is_variable()) {
+                right_occurrences[var].insert(&inclusion);
+            }
+        }
+    }
+
+    void InclusionSet::unindex_inclusion(const Predicate &inclusion) {
+        auto unindex_side = [&inclusion](const std::vector<BasicTerm> &side, Index &index) {
+            for (const BasicTerm &var : side) {
+                auto it = index.find(var);
+                if (it != index.end()) {
+                    it->second.erase(&inclusion);
+                    if (it->second.empty()) {
+                        index.erase(it);
+                    }
+                }
+            }
+        };
+        unindex_side(inclusion.get_left_side(), left_occurrences);
+        unindex_side(inclusion.get_right_side(), right_occurrences);
+    }
+
+    void InclusionSet::rebuild_index() {
+        left_occurrences.clear();
+        right_occurrences.clear();
+        for (const Predicate &inclusion : inclusions) {
+            index_inclusion(inclusion);
+        }
+    }
+
+    std::vector<Predicate> InclusionSet::get_indexed_inclusions(const std::vector<BasicTerm> &vars, bool both_sides) const {
+        std::unordered_set<const Predicate*> found;
+        auto collect = [&found, &vars](const Index &index) {
+            for (const BasicTerm &var : vars) {
+                auto it = index.find(var);
+                if (it != index.end()) {
+                    found.insert(it->second.begin(), it->second.end());
+                }
+            }
+        };
+        collect(right_occurrences);
+        if (both_sides) {
+            collect(left_occurrences);
+        }
+
+        // we keep the order of the set, so that the order of processing inclusions does not depend on the hashing
+        std::vector<const Predicate*> sorted(found.begin(), found.end());
+        std::sort(sorted.begin(), sorted.end(), [](const Predicate *lhs, const Predicate *rhs) { return *lhs < *rhs; });
+        std::vector<Predicate> result;
+        result.reserve(sorted.size());
+        for (const Predicate *inclusion : sorted) {
+            result.push_back(*inclusion);
+        }
+        return result;
+    }
+
+    void SolvingState::substitute_vars(const std::unordered_map<BasicTerm, std::vector<BasicTerm>> &substitution_map) {
+        if (substitution_map.empty()) {
+            // nothing to substitute, we keep sharing the inclusions with the other states
+            return;
+        }
+
         // substitutes variables in a vector using substitution_map
         auto substitute_vector = [&substitution_map](const std::vector<BasicTerm> &vector) {
             std::vector<BasicTerm> result;
@@ -35,35 +133,66 @@ namespace smt::noodler {
         // returns true if the inclusion has the same thing on both sides
         auto inclusion_has_same_sides = [](const Predicate &inclusion) { return inclusion.get_left_side() == inclusion.get_right_side(); };
 
-        // substitutes variables of inclusions in a vector using substitute_map, but does not keep the ones that have the same sides after substitution
-        auto substitute_set = [&substitute_inclusion, &inclusion_has_same_sides](const std::set<Predicate> inclusions) {
-            std::set<Predicate> new_inclusions;
-            for (const auto &old_inclusion : inclusions) {
-                auto new_inclusion = substitute_inclusion(old_inclusion);
+        // only the inclusions containing some substituted variable are changed, we find them using the index of inclusions
+        std::vector<BasicTerm> substituted_vars;
+        for (const auto &subst : substitution_map) {
+            substituted_vars.push_back(subst.first);
+        }
+        const std::vector<Predicate> affected_inclusions = inclusions->get_inclusions_with_vars(substituted_vars);
+        if (affected_inclusions.empty()) {
+            // the other sets are subsets of inclusions, so they are not affected either
+            return;
+        }
+        // maps the affected inclusions to their substituted versions
+        std::unordered_map<Predicate, Predicate> substituted_inclusions;
+        for (const Predicate &inclusion : affected_inclusions) {
+            substituted_inclusions.emplace(inclusion, substitute_inclusion(inclusion));
+        }
+
+        // substitutes affected inclusions in a set, but does not keep the ones that have the same sides after substitution
+        // (all affected inclusions are removed first, as some substituted inclusion can be the same as some other affected one)
+        auto substitute_set = [&affected_inclusions, &substituted_inclusions, &inclusion_has_same_sides](auto &set) {
+            std::vector<const Predicate*> affected_in_set;
+            for (const Predicate &inclusion : affected_inclusions) {
+                if (set->count(inclusion) > 0) {
+                    affected_in_set.push_back(&inclusion);
+                }
+            }
+            if (affected_in_set.empty()) {
+                return;
+            }
+            auto &modified_set = set.mut();
+            for (const Predicate *inclusion : affected_in_set) {
+                modified_set.erase(*inclusion);
+            }
+            for (const Predicate *inclusion : affected_in_set) {
+                const Predicate &new_inclusion = substituted_inclusions.at(*inclusion);
                 if (!inclusion_has_same_sides(new_inclusion)) {
-                    new_inclusions.insert(new_inclusion);
+                    modified_set.insert(new_inclusion);
                 }
             }
-            return new_inclusions;
         };
 
-        inclusions = substitute_set(inclusions);
-        inclusions_not_on_cycle = substitute_set(inclusions_not_on_cycle);
+        substitute_set(inclusions);
+        substitute_set(inclusions_not_on_cycle);
 
+        if (std::none_of(affected_inclusions.begin(), affected_inclusions.end(),
+                         [this](const Predicate &inclusion) { return inclusions_to_process->contains(inclusion); })) {
+            return;
+        }
         // substituting inclusions to process is bit harder, it is possible that two inclusions that were supposed to
         // be processed become same after substituting, so we do not want to keep both in inclusions to process
-        std::set<Predicate> substituted_inclusions_to_process;
+        // (InclusionQueue keeps only the first one)
         std::deque<Predicate> new_inclusions_to_process;
-        while (!inclusions_to_process.empty()) {
-            Predicate substituted_inclusion = substitute_inclusion(inclusions_to_process.front());
-            inclusions_to_process.pop_front();
-            
-            if (!inclusion_has_same_sides(substituted_inclusion) // we do not want to add inclusion that is already in inclusions_to_process
-                && substituted_inclusions_to_process.count(substituted_inclusion) == 0) {
-                new_inclusions_to_process.push_back(substituted_inclusion);
+        for (const Predicate &inclusion : *inclusions_to_process) {
+            auto substituted = substituted_inclusions.find(inclusion);
+            if (substituted == substituted_inclusions.end()) {
+                new_inclusions_to_process.push_back(inclusion);
+            } else if (!inclusion_has_same_sides(substituted->second)) {
+                new_inclusions_to_process.push_back(substituted->second);
             }
         }
-        inclusions_to_process = new_inclusions_to_process;
+        inclusions_to_process = InclusionQueue(new_inclusions_to_process);
     }
 
     AutAssignment SolvingState::flatten_substition_map() {
@@ -82,9 +211,9 @@ namespace smt::noodler {
                 return result[var];
             }
         };
-        for (const auto &subst_map_pair : substitution_map) {
-            flatten_var(subst_map_pair.first);
-        }
+        substitution_map.for_each([&flatten_var](const BasicTerm &var, const std::vector<BasicTerm> &) {
+            flatten_var(var);
+        });
         STRACE("str-nfa",
             tout << "Flattened substitution map:" << std::endl;
             for (const auto &var_aut : result) {
@@ -94,6 +223,139 @@ namespace smt::noodler {
         return result;
     }
 
+    void DecisionProcedureStats::collect_statistics(::statistics& st) const {
+        auto to_seconds = [](uint64_t time) { return static_cast<double>(time) / 1000000.0; };
+        st.update("noodler preprocessings", num_preprocessings);
+        st.update("noodler preprocess time", to_seconds(preprocess_time));
+        st.update("noodler aut states before reduce", static_cast<double>(aut_states_before_reduce));
+        st.update("noodler aut states after reduce", static_cast<double>(aut_states_after_reduce));
+        st.update("noodler solving states", num_states);
+        st.update("noodler max worklist size", max_worklist_size);
+        st.update("noodler inclusion tests", num_inclusion_tests);
+        st.update("noodler inclusion time", to_seconds(inclusion_time));
+        st.update("noodler noodlifications", num_noodlifications);
+        st.update("noodler noodles", num_noodles);
+        st.update("noodler noodlify time", to_seconds(noodlify_time));
+        st.update("noodler word lengths", num_word_lengths);
+        st.update("noodler word lengths time", to_seconds(word_lengths_time));
+        st.update("noodler size reductions", num_size_reductions);
+        st.update("noodler size reduction cache hits", num_size_reduction_cache_hits);
+        st.update("noodler size reduction states before", static_cast<double>(size_reduction_states_before));
+        st.update("noodler size reduction states after", static_cast<double>(size_reduction_states_after));
+        st.update("noodler size reduction time", to_seconds(size_reduction_time));
+    }
+
+    ParallelWorklist::ParallelWorklist(unsigned num_of_workers, ProcessFunction process, std::deque<SolvingState> init_states,
+                                       DecisionProcedureStats* stats)
+        : stats(stats), num_of_states(init_states.size()), process(std::move(process)), deques(num_of_workers),
+          max_waiting_solutions(num_of_workers) {
+        assert(num_of_workers > 0);
+        deques[0] = std::move(init_states);
+        for (unsigned worker = 0; worker < num_of_workers; ++worker) {
+            workers.emplace_back(&ParallelWorklist::run_worker, this, worker);
+        }
+    }
+
+    ParallelWorklist::~ParallelWorklist() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        cond.notify_all();
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+    }
+
+    bool ParallelWorklist::has_work() const {
+        return std::any_of(deques.begin(), deques.end(), [](const std::deque<SolvingState> &deque) { return !deque.empty(); });
+    }
+
+    SolvingState ParallelWorklist::take_state(unsigned worker) {
+        // the worker takes the state from the front of its own deque (the same as in the sequential procedure)...
+        if (!deques[worker].empty()) {
+            SolvingState state = std::move(deques[worker].front());
+            deques[worker].pop_front();
+            return state;
+        }
+        // ...or steals the state from the back of some other deque
+        for (unsigned other = 1; other < deques.size(); ++other) {
+            std::deque<SolvingState> &victim = deques[(worker + other) % deques.size()];
+            if (!victim.empty()) {
+                SolvingState state = std::move(victim.back());
+                victim.pop_back();
+                return state;
+            }
+        }
+        UNREACHABLE();
+        return SolvingState();
+    }
+
+    void ParallelWorklist::run_worker(unsigned worker) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cond.wait(lock, [this]() { return stopped || (solutions.size() < max_waiting_solutions && has_work()); });
+            if (stopped) {
+                return;
+            }
+
+            SolvingState state = take_state(worker);
+            --num_of_states;
+            ++busy_workers;
+            lock.unlock();
+
+            // the new states are collected locally, so that the lock is not needed during processing
+            std::vector<std::pair<SolvingState, bool>> new_states;
+            bool is_solution = false;
+            std::exception_ptr exception;
+            try {
+                is_solution = process(state, [&new_states](SolvingState&& new_state, bool to_back) {
+                    new_states.emplace_back(std::move(new_state), to_back);
+                });
+            } catch (...) {
+                exception = std::current_exception();
+            }
+
+            lock.lock();
+            --busy_workers;
+            if (exception) {
+                error = exception;
+                stopped = true;
+            } else if (is_solution) {
+                solutions.push_back(std::move(state));
+            }
+            for (auto &[new_state, to_back] : new_states) {
+                if (to_back) {
+                    deques[worker].push_back(std::move(new_state));
+                } else {
+                    deques[worker].push_front(std::move(new_state));
+                }
+            }
+            num_of_states += new_states.size();
+            if (stats) {
+                stats->update_max_worklist_size(num_of_states);
+            }
+            cond.notify_all();
+        }
+    }
+
+    bool ParallelWorklist::next_solution(SolvingState& solution) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this]() { return error || !solutions.empty() || (busy_workers == 0 && !has_work()); });
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        if (solutions.empty()) {
+            // there are no solving states left, which means nothing led to solution
+            return false;
+        }
+        solution = std::move(solutions.front());
+        solutions.pop_front();
+        // workers could be waiting for the solution to be taken
+        cond.notify_all();
+        return true;
+    }
+
     DecisionProcedure::DecisionProcedure(ast_manager& m, seq_util& m_util_s, arith_util& m_util_a, const theory_str_noodler_params& par) 
         : prep_handler(Formula(), AutAssignment(), {}, par), m{ m }, m_util_s{ m_util_s },
         m_util_a{ m_util_a },
@@ -110,155 +372,222 @@ namespace smt::noodler {
                            << "Getting another solution"
                            << "------------------------" << std::endl;);
 
+        if (m_params.m_parallel_threads > 1) {
+            if (!parallel_worklist) {
+                parallel_worklist = std::make_unique<ParallelWorklist>(m_params.m_parallel_threads,
+                    [this](SolvingState& state, const ParallelWorklist::PushFunction& push_state) {
+                        return process_state(state, push_state);
+                    },
+                    std::move(worklist), stats.get());
+                worklist.clear();
+            }
+            return parallel_worklist->next_solution(solution);
+        }
+
+        auto push_to_worklist = [this](SolvingState&& state, bool to_back) {
+            if (to_back) {
+                worklist.push_back(std::move(state));
+            } else {
+                worklist.push_front(std::move(state));
+            }
+            stats->update_max_worklist_size(worklist.size());
+        };
+
         while (!worklist.empty()) {
             SolvingState element_to_process = std::move(worklist.front());
             worklist.pop_front();
 
-            if (element_to_process.inclusions_to_process.empty()) {
+            if (process_state(element_to_process, push_to_worklist)) {
                 // we found another solution, element_to_process contain the automata
                 // assignment and variable substition that satisfy the original
                 // inclusion graph
                 solution = std::move(element_to_process);
                 return true;
             }
+        }
 
-            // we will now process one inclusion from the inclusion graph which is at front
-            // i.e. we will update automata assignments and substitutions so that this inclusion is fulfilled
-            Predicate inclusion_to_process = element_to_process.inclusions_to_process.front();
-            element_to_process.inclusions_to_process.pop_front();
+        // there are no solving states left, which means nothing led to solution -> it must be unsatisfiable
+        return false;
+    }
 
-            // this will decide whether we will continue in our search by DFS or by BFS
-            bool is_inclusion_to_process_on_cycle = element_to_process.is_inclusion_on_cycle(inclusion_to_process);
+    bool DecisionProcedure::process_state(SolvingState& element_to_process, const ParallelWorklist::PushFunction& push_state) {
+        if (element_to_process.pending_noodles) {
+            // we create the solving state of the next pending noodle and put the rest back to the front, so that the
+            // states created for the new noodle are explored in the same order as if all the noodles were created at once
+            std::shared_ptr<PendingNoodles> pending = std::move(element_to_process.pending_noodles);
+            element_to_process = create_next_noodle_state(*pending);
+            if (pending->has_next()) {
+                SolvingState rest_of_noodles;
+                rest_of_noodles.pending_noodles = std::move(pending);
+                push_state(std::move(rest_of_noodles), false);
+            }
+        }
 
-            STRACE("str", tout << "Processing node with inclusion " << inclusion_to_process << " which is" << (is_inclusion_to_process_on_cycle ? " " : " not ") << "on the cycle" << std::endl;);
-            STRACE("str",
-                tout << "Length variables are:";
-                for(auto const &var : inclusion_to_process.get_vars()) {
-                    if (element_to_process.length_sensitive_vars.count(var)) {
-                        tout << " " << var.to_string();
-                    }
-                }
-                tout << std::endl;
-            );
+        ++stats->num_states;
 
-            const auto &left_side_vars = inclusion_to_process.get_left_side();
-            const auto &right_side_vars = inclusion_to_process.get_right_side();
-
-            /********************************************************************************************************/
-            /****************************************** One side is empty *******************************************/
-            /********************************************************************************************************/
-            // As kinda optimization step, we do "noodlification" for empty sides separately (i.e. sides that
-            // represent empty string). This is because it is simpler, we would get only one noodle so we just need to
-            // check that the non-empty side actually contains empty string and replace the vars on that side by epsilon.
-            if (right_side_vars.empty() || left_side_vars.empty()) {
-                std::unordered_map<BasicTerm, std::vector<BasicTerm>> substitution_map;
-                auto const non_empty_side_vars = right_side_vars.empty() ? 
-                                                        inclusion_to_process.get_left_set()
-                                                      : inclusion_to_process.get_right_set();
-                bool non_empty_side_contains_empty_word = true;
-                for (const auto &var : non_empty_side_vars) {
-                    if (Mata::Nfa::is_in_lang(*element_to_process.aut_ass.at(var), {{}, {}})) {
-                        // var contains empty word, we substitute it with only empty word, but only if...
-                        if (right_side_vars.empty() // ...non-empty side is the left side (var is from left) or...
-                               || element_to_process.length_sensitive_vars.count(var) > 0 // ...var is length-aware
-                         ) {
-                            assert(substitution_map.count(var) == 0 && element_to_process.aut_ass.count(var) > 0);
-                            // we prepare substitution for all vars on the left or only the length vars on the right
-                            // (as non-length vars are probably not needed? TODO: would it make sense to update non-length vars too?)
-                            substitution_map[var] = {};
-                            element_to_process.aut_ass.erase(var);
-                        }
-                    } else {
-                        // var does not contain empty word => whole non-empty side cannot contain empty word
-                        non_empty_side_contains_empty_word = false;
-                        break;
-                    }
-                }
-                if (!non_empty_side_contains_empty_word) {
-                    // in the case that the non_empty side does not contain empty word
-                    // the inclusion cannot hold (noodlification would not create anything)
-                    continue;
-                }
+        if (element_to_process.inclusions_to_process->empty()) {
+            // element_to_process is a solution
+            return true;
+        }
 
-                // TODO: all this following shit is done also during normal noodlification, I need to split it to some better defined functions
+        // we will now process one inclusion from the inclusion graph which is at front
+        // i.e. we will update automata assignments and substitutions so that this inclusion is fulfilled
+        Predicate inclusion_to_process = element_to_process.inclusions_to_process->front();
+        element_to_process.inclusions_to_process.mut().pop_front();
 
-                element_to_process.remove_inclusion(inclusion_to_process);
+        // this will decide whether we will continue in our search by DFS or by BFS
+        bool is_inclusion_to_process_on_cycle = element_to_process.is_inclusion_on_cycle(inclusion_to_process);
 
-                // We might be updating left side, in that case we need to process all nodes that contain the variables from the left,
-                // i.e. those nodes to which inclusion_to_process goes to. In the case we are updating right side, there will be no edges
-                // coming from inclusion_to_process, so this for loop will do nothing.
-                for (const auto &dependent_inclusion : element_to_process.get_dependent_inclusions(inclusion_to_process)) {
-                    // we push only those nodes which are not already in inclusions_to_process
-                    // if the inclusion_to_process is on cycle, we need to do BFS
-                    // if it is not on cycle, we can do DFS
-                    // TODO: can we really do DFS??
-                    element_to_process.push_unique(dependent_inclusion, is_inclusion_to_process_on_cycle);
+        STRACE("str", tout << "Processing node with inclusion " << inclusion_to_process << " which is" << (is_inclusion_to_process_on_cycle ? " " : " not ") << "on the cycle" << std::endl;);
+        STRACE("str",
+            tout << "Length variables are:";
+            for(auto const &var : inclusion_to_process.get_vars()) {
+                if (element_to_process.length_sensitive_vars->count(var)) {
+                    tout << " " << var.to_string();
                 }
+            }
+            tout << std::endl;
+        );
 
-                // do substitution in the inclusion graph
-                element_to_process.substitute_vars(substitution_map);
-                // update the substitution_map of new_element by the new substitutions
-                element_to_process.substitution_map.merge(substitution_map);
-
-                // TODO: should we really push to front when not on cycle?
-                // TODO: maybe for this case of one side being empty, we should just push to front?
-                if (!is_inclusion_to_process_on_cycle) {
-                    worklist.push_front(element_to_process);
+        const auto &left_side_vars = inclusion_to_process.get_left_side();
+        const auto &right_side_vars = inclusion_to_process.get_right_side();
+
+        /********************************************************************************************************/
+        /****************************************** One side is empty *******************************************/
+        /********************************************************************************************************/
+        // As kinda optimization step, we do "noodlification" for empty sides separately (i.e. sides that
+        // represent empty string). This is because it is simpler, we would get only one noodle so we just need to
+        // check that the non-empty side actually contains empty string and replace the vars on that side by epsilon.
+        if (right_side_vars.empty() || left_side_vars.empty()) {
+            std::unordered_map<BasicTerm, std::vector<BasicTerm>> substitution_map;
+            auto const non_empty_side_vars = right_side_vars.empty() ? 
+                                                    inclusion_to_process.get_left_set()
+                                                  : inclusion_to_process.get_right_set();
+            bool non_empty_side_contains_empty_word = true;
+            for (const auto &var : non_empty_side_vars) {
+                if (Mata::Nfa::is_in_lang(*element_to_process.aut_ass.at(var), {{}, {}})) {
+                    // var contains empty word, we substitute it with only empty word, but only if...
+                    if (right_side_vars.empty() // ...non-empty side is the left side (var is from left) or...
+                           || element_to_process.length_sensitive_vars->count(var) > 0 // ...var is length-aware
+                     ) {
+                        assert(substitution_map.count(var) == 0 && element_to_process.aut_ass.count(var) > 0);
+                        // we prepare substitution for all vars on the left or only the length vars on the right
+                        // (as non-length vars are probably not needed? TODO: would it make sense to update non-length vars too?)
+                        substitution_map[var] = {};
+                        element_to_process.aut_ass.erase(var);
+                    }
                 } else {
-                    worklist.push_back(element_to_process);
+                    // var does not contain empty word => whole non-empty side cannot contain empty word
+                    non_empty_side_contains_empty_word = false;
+                    break;
                 }
-                continue;
             }
-            /********************************************************************************************************/
-            /*************************************** End of one side is empty ***************************************/
-            /********************************************************************************************************/
+            if (!non_empty_side_contains_empty_word) {
+                // in the case that the non_empty side does not contain empty word
+                // the inclusion cannot hold (noodlification would not create anything)
+                return false;
+            }
 
+            // TODO: all this following shit is done also during normal noodlification, I need to split it to some better defined functions
 
+            element_to_process.remove_inclusion(inclusion_to_process);
 
-            /********************************************************************************************************/
-            /****************************************** Process left side *******************************************/
-            /********************************************************************************************************/
-            std::vector<std::shared_ptr<Mata::Nfa::Nfa>> left_side_automata;
-            STRACE("str-nfa", tout << "Left automata:" << std::endl);
-            for (const auto &l_var : left_side_vars) {
-                left_side_automata.push_back(element_to_process.aut_ass.at(l_var));
-                STRACE("str-nfa",
-                    tout << "Automaton for left var " << l_var.get_name() << ":" << std::endl;
-                    left_side_automata.back()->print_to_DOT(tout);
-                );
+            // We might be updating left side, in that case we need to process all nodes that contain the variables from the left,
+            // i.e. those nodes to which inclusion_to_process goes to. In the case we are updating right side, there will be no edges
+            // coming from inclusion_to_process, so this for loop will do nothing.
+            for (const auto &dependent_inclusion : element_to_process.get_dependent_inclusions(inclusion_to_process)) {
+                // we push only those nodes which are not already in inclusions_to_process
+                // if the inclusion_to_process is on cycle, we need to do BFS
+                // if it is not on cycle, we can do DFS
+                // TODO: can we really do DFS??
+                element_to_process.push_unique(dependent_inclusion, is_inclusion_to_process_on_cycle);
             }
-            /********************************************************************************************************/
-            /************************************** End of left side processing *************************************/
-            /********************************************************************************************************/
 
+            // do substitution in the inclusion graph
+            element_to_process.substitute_vars(substitution_map);
+            // update the substitution_map of new_element by the new substitutions
+            element_to_process.substitution_map.merge(substitution_map);
 
+            // TODO: should we really push to front when not on cycle?
+            // TODO: maybe for this case of one side being empty, we should just push to front?
+            if (!is_inclusion_to_process_on_cycle) {
+                push_state(std::move(element_to_process), false);
+            } else {
+                push_state(std::move(element_to_process), true);
+            }
+            return false;
+        }
+        /********************************************************************************************************/
+        /*************************************** End of one side is empty ***************************************/
+        /********************************************************************************************************/
 
 
-            /********************************************************************************************************/
-            /***************************************** Process right side *******************************************/
-            /********************************************************************************************************/
-            // We combine the right side into automata where we concatenate non-length-aware vars next to each other.
-            // Each right side automaton corresponds to either concatenation of non-length-aware vars (vector of
-            // basic terms) or one lenght-aware var (vector of one basic term). Division then contains for each right
-            // side automaton the variables whose concatenation it represents.
-            std::vector<std::shared_ptr<Mata::Nfa::Nfa>> right_side_automata;
-            std::vector<std::vector<BasicTerm>> right_side_division;
-
-            assert(!right_side_vars.empty()); // empty case was processed at the beginning
-            auto right_var_it = right_side_vars.begin();
-            auto right_side_end = right_side_vars.end();
-
-            std::shared_ptr<Mata::Nfa::Nfa> next_aut = element_to_process.aut_ass[*right_var_it];
-            std::vector<BasicTerm> next_division{ *right_var_it };
-            bool last_was_length = (element_to_process.length_sensitive_vars.count(*right_var_it) > 0);
-            bool is_there_length_on_right = last_was_length;
-            ++right_var_it;
 
-            STRACE("str-nfa", tout << "Right automata:" << std::endl);
-            for (; right_var_it != right_side_end; ++right_var_it) {
-                std::shared_ptr<Mata::Nfa::Nfa> right_var_aut = element_to_process.aut_ass.at(*right_var_it);
-                if (element_to_process.length_sensitive_vars.count(*right_var_it) > 0) {
-                    // current right_var is length-aware
+        /********************************************************************************************************/
+        /****************************************** Process left side *******************************************/
+        /********************************************************************************************************/
+        std::vector<std::shared_ptr<Mata::Nfa::Nfa>> left_side_automata;
+        STRACE("str-nfa", tout << "Left automata:" << std::endl);
+        for (const auto &l_var : left_side_vars) {
+            left_side_automata.push_back(element_to_process.aut_ass.at(l_var));
+            STRACE("str-nfa",
+                tout << "Automaton for left var " << l_var.get_name() << ":" << std::endl;
+                left_side_automata.back()->print_to_DOT(tout);
+            );
+        }
+        /********************************************************************************************************/
+        /************************************** End of left side processing *************************************/
+        /********************************************************************************************************/
+
+
+
+
+        /********************************************************************************************************/
+        /***************************************** Process right side *******************************************/
+        /********************************************************************************************************/
+        // We combine the right side into automata where we concatenate non-length-aware vars next to each other.
+        // Each right side automaton corresponds to either concatenation of non-length-aware vars (vector of
+        // basic terms) or one lenght-aware var (vector of one basic term). Division then contains for each right
+        // side automaton the variables whose concatenation it represents.
+        std::vector<std::shared_ptr<Mata::Nfa::Nfa>> right_side_automata;
+        std::vector<std::vector<BasicTerm>> right_side_division;
+
+        assert(!right_side_vars.empty()); // empty case was processed at the beginning
+        auto right_var_it = right_side_vars.begin();
+        auto right_side_end = right_side_vars.end();
+
+        std::shared_ptr<Mata::Nfa::Nfa> next_aut = element_to_process.aut_ass[*right_var_it];
+        // number of states of the biggest automaton next_aut was built from (see reduce_if_grown())
+        size_t next_aut_input_states = next_aut->size();
+        std::vector<BasicTerm> next_division{ *right_var_it };
+        bool last_was_length = (element_to_process.length_sensitive_vars->count(*right_var_it) > 0);
+        bool is_there_length_on_right = last_was_length;
+        ++right_var_it;
+
+        STRACE("str-nfa", tout << "Right automata:" << std::endl);
+        for (; right_var_it != right_side_end; ++right_var_it) {
+            std::shared_ptr<Mata::Nfa::Nfa> right_var_aut = element_to_process.aut_ass.at(*right_var_it);
+            if (element_to_process.length_sensitive_vars->count(*right_var_it) > 0) {
+                // current right_var is length-aware
+                right_side_automata.push_back(next_aut);
+                right_side_division.push_back(next_division);
+                STRACE("str-nfa",
+                    tout << "Automaton for right var(s)";
+                    for (const auto &r_var : next_division) {
+                        tout << " " << r_var.get_name();
+                    }
+                    tout << ":" << std::endl;
+                    next_aut->print_to_DOT(tout);
+                );
+                next_aut = right_var_aut;
+                next_aut_input_states = next_aut->size();
+                next_division = std::vector<BasicTerm>{ *right_var_it };
+                last_was_length = true;
+                is_there_length_on_right = true;
+            } else {
+                // current right_var is not length-aware
+                if (last_was_length) {
+                    // if last var was length-aware, we need to add automaton for it into right_side_automata
                     right_side_automata.push_back(next_aut);
                     right_side_division.push_back(next_division);
                     STRACE("str-nfa",
@@ -270,260 +599,297 @@ namespace smt::noodler {
                         next_aut->print_to_DOT(tout);
                     );
                     next_aut = right_var_aut;
+                    next_aut_input_states = next_aut->size();
                     next_division = std::vector<BasicTerm>{ *right_var_it };
-                    last_was_length = true;
-                    is_there_length_on_right = true;
                 } else {
-                    // current right_var is not length-aware
-                    if (last_was_length) {
-                        // if last var was length-aware, we need to add automaton for it into right_side_automata
-                        right_side_automata.push_back(next_aut);
-                        right_side_division.push_back(next_division);
-                        STRACE("str-nfa",
-                            tout << "Automaton for right var(s)";
-                            for (const auto &r_var : next_division) {
-                                tout << " " << r_var.get_name();
-                            }
-                            tout << ":" << std::endl;
-                            next_aut->print_to_DOT(tout);
-                        );
-                        next_aut = right_var_aut;
-                        next_division = std::vector<BasicTerm>{ *right_var_it };
-                    } else {
-                        // if last var was not length-aware, we combine it (and possibly the non-length-aware vars before)
-                        // with the current one
-                        next_aut = std::make_shared<Mata::Nfa::Nfa>(Mata::Nfa::concatenate(*next_aut, *right_var_aut));
-                        next_division.push_back(*right_var_it);
-                        // TODO should we reduce size here?
-                    }
-                    last_was_length = false;
+                    // if last var was not length-aware, we combine it (and possibly the non-length-aware vars before)
+                    // with the current one
+                    next_aut = std::make_shared<Mata::Nfa::Nfa>(Mata::Nfa::concatenate(*next_aut, *right_var_aut));
+                    next_division.push_back(*right_var_it);
+                    // the concatenation is reduced only once it is much bigger than its parts, its (possibly
+                    // reduced) size is then the reference for the next reduction
+                    next_aut_input_states = std::max(next_aut_input_states, right_var_aut->size());
+                    next_aut = reduce_if_grown(next_aut, next_aut_input_states, false);
+                    next_aut_input_states = std::max(next_aut_input_states, next_aut->size());
                 }
+                last_was_length = false;
             }
-            right_side_automata.push_back(next_aut);
-            right_side_division.push_back(next_division);
-            STRACE("str-nfa",
-                tout << "Automaton for right var(s)";
-                for (const auto &r_var : next_division) {
-                    tout << " " << r_var.get_name();
-                }
-                tout << ":" << std::endl;
-                next_aut->print_to_DOT(tout);
-            );
-            /********************************************************************************************************/
-            /************************************* End of right side processing *************************************/
-            /********************************************************************************************************/
-
-
-            /********************************************************************************************************/
-            /****************************************** Inclusion test **********************************************/
-            /********************************************************************************************************/
-            if (!is_there_length_on_right) {
-                // we have no length-aware variables on the right hand side => we need to check if inclusion holds
-                assert(right_side_automata.size() == 1); // there should be exactly one element in right_side_automata as we do not have length variables
-                // TODO probably we should try shortest words, it might work correctly
-                if (is_inclusion_to_process_on_cycle // we do not test inclusion if we have node that is not on cycle, because we will not go back to it (TODO: should we really not test it?)
-                    && Mata::Nfa::is_included(element_to_process.aut_ass.get_automaton_concat(left_side_vars), *right_side_automata[0])) {
-                    // TODO can I push to front? I think I can, and I probably want to, so I can immediately test if it is not sat (if element_to_process.inclusions_to_process is empty), or just to get to sat faster
-                    worklist.push_front(element_to_process);
-                    // we continue as there is no need for noodlification, inclusion already holds
-                    continue;
-                }
+        }
+        right_side_automata.push_back(next_aut);
+        right_side_division.push_back(next_division);
+        STRACE("str-nfa",
+            tout << "Automaton for right var(s)";
+            for (const auto &r_var : next_division) {
+                tout << " " << r_var.get_name();
             }
-            /********************************************************************************************************/
-            /*************************************** End of inclusion test ******************************************/
-            /********************************************************************************************************/
+            tout << ":" << std::endl;
+            next_aut->print_to_DOT(tout);
+        );
+        /********************************************************************************************************/
+        /************************************* End of right side processing *************************************/
+        /********************************************************************************************************/
+
+
+        /********************************************************************************************************/
+        /****************************************** Inclusion test **********************************************/
+        /********************************************************************************************************/
+        if (!is_there_length_on_right) {
+            // we have no length-aware variables on the right hand side => we need to check if inclusion holds
+            assert(right_side_automata.size() == 1); // there should be exactly one element in right_side_automata as we do not have length variables
+            // TODO probably we should try shortest words, it might work correctly
+            // we do not test inclusion if we have node that is not on cycle, because we will not go back to it (TODO: should we really not test it?)
+            bool is_included = false;
+            if (is_inclusion_to_process_on_cycle) {
+                DecisionProcedureStats::ScopedTimer timer(stats->inclusion_time);
+                ++stats->num_inclusion_tests;
+                is_included = Mata::Nfa::is_included(element_to_process.aut_ass.get_automaton_concat(left_side_vars), *right_side_automata[0]);
+            }
+            if (is_included) {
+                // TODO can I push to front? I think I can, and I probably want to, so I can immediately test if it is not sat (if element_to_process.inclusions_to_process is empty), or just to get to sat faster
+                push_state(std::move(element_to_process), false);
+                // we continue as there is no need for noodlification, inclusion already holds
+                return false;
+            }
+        }
+        /********************************************************************************************************/
+        /*************************************** End of inclusion test ******************************************/
+        /********************************************************************************************************/
+
+        element_to_process.remove_inclusion(inclusion_to_process);
+
+        // We are going to change the automata on the left side (potentially also split some on the right side, but that should not have impact)
+        // so we need to add all nodes whose variable assignments are going to change on the right side (i.e. we follow inclusion graph) for processing.
+        // Warning: Self-loops are not in inclusion graph, but we might still want to add this node again to inclusions_to_process, however, this node will be
+        // split during noodlification, so we will only add parts whose right sides actually change (see below in noodlification)
+        for (const auto &node : element_to_process.get_dependent_inclusions(inclusion_to_process)) {
+            // we push only those nodes which are not already in inclusions_to_process
+            // if the inclusion_to_process is on cycle, we need to do BFS
+            // if it is not on cycle, we can do DFS
+            // TODO: can we really do DFS??
+            element_to_process.push_unique(node, is_inclusion_to_process_on_cycle);
+        }
 
-            element_to_process.remove_inclusion(inclusion_to_process);
 
-            // We are going to change the automata on the left side (potentially also split some on the right side, but that should not have impact)
-            // so we need to add all nodes whose variable assignments are going to change on the right side (i.e. we follow inclusion graph) for processing.
-            // Warning: Self-loops are not in inclusion graph, but we might still want to add this node again to inclusions_to_process, however, this node will be
-            // split during noodlification, so we will only add parts whose right sides actually change (see below in noodlification)
-            for (const auto &node : element_to_process.get_dependent_inclusions(inclusion_to_process)) {
-                // we push only those nodes which are not already in inclusions_to_process
-                // if the inclusion_to_process is on cycle, we need to do BFS
-                // if it is not on cycle, we can do DFS
-                // TODO: can we really do DFS??
-                element_to_process.push_unique(node, is_inclusion_to_process_on_cycle);
-            }
-            // We will need the set of left vars, so we can sort the 'non-existing self-loop' in noodlification (see previous warning)
-            const auto left_vars_set = inclusion_to_process.get_left_set();
+        /* TODO check here if we have empty elements_to_process, if we do, then every noodle we get should finish and return sat
+         * right now if we test sat at the beginning it should work, but it is probably better to immediatly return sat if we have
+         * empty elements_to_process, however, we need to remmeber the state of the algorithm, we would need to return back to noodles
+         * and process them if z3 realizes that the result is actually not sat (because of lengths)
+         */
 
+        
 
-            /* TODO check here if we have empty elements_to_process, if we do, then every noodle we get should finish and return sat
-             * right now if we test sat at the beginning it should work, but it is probably better to immediatly return sat if we have
-             * empty elements_to_process, however, we need to remmeber the state of the algorithm, we would need to return back to noodles
-             * and process them if z3 realizes that the result is actually not sat (because of lengths)
-             */
+        /********************************************************************************************************/
+        /******************************************* Noodlification *********************************************/
+        /********************************************************************************************************/
+        /**
+         * We get noodles where each noodle consists of automata connected with a vector of numbers.
+         * So for example if we have some noodle and automaton noodle[i].first, then noodle[i].second is a vector,
+         * where first element i_l = noodle[i].second[0] tells us that automaton noodle[i].first belongs to the
+         * i_l-th left var (i.e. left_side_vars[i_l]) and the second element i_r = noodle[i].second[1] tell us that
+         * it belongs to the i_r-th division of the right side (i.e. right_side_division[i_r])
+         **/
+        std::vector<Mata::Strings::SegNfa::Noodle> noodles;
+        {
+            DecisionProcedureStats::ScopedTimer timer(stats->noodlify_time);
+            noodles = Mata::Strings::SegNfa::noodlify_for_equation(left_side_automata,
+                                                                   right_side_automata,
+                                                                   false,
+                                                                   {{"reduce", "true"}});
+        }
+        ++stats->num_noodlifications;
+        stats->num_noodles += noodles.size();
+        if (noodles.empty()) {
+            return false;
+        }
+        size_t max_noodle_size = 0;
+        for (const auto &noodle : noodles) {
+            max_noodle_size = std::max(max_noodle_size, noodle.size());
+        }
+        if (!is_inclusion_to_process_on_cycle) {
+            // the states of the noodles would be pushed to the front one by one, i.e. the last noodle would be explored first
+            std::reverse(noodles.begin(), noodles.end());
+        }
 
-            
+        // the solving states of the noodles are created only when they are taken from the worklist (see PendingNoodles)
+        SolvingState pending_state;
+        pending_state.pending_noodles = std::make_shared<PendingNoodles>(PendingNoodles{
+            std::move(element_to_process), inclusion_to_process, std::move(right_side_division),
+            is_inclusion_to_process_on_cycle, create_noodle_vars(max_noodle_size), std::move(noodles)
+        });
+        push_state(std::move(pending_state), is_inclusion_to_process_on_cycle);
 
-            /********************************************************************************************************/
-            /******************************************* Noodlification *********************************************/
-            /********************************************************************************************************/
-            /**
-             * We get noodles where each noodle consists of automata connected with a vector of numbers.
-             * So for example if we have some noodle and automaton noodle[i].first, then noodle[i].second is a vector,
-             * where first element i_l = noodle[i].second[0] tells us that automaton noodle[i].first belongs to the
-             * i_l-th left var (i.e. left_side_vars[i_l]) and the second element i_r = noodle[i].second[1] tell us that
-             * it belongs to the i_r-th division of the right side (i.e. right_side_division[i_r])
-             **/
-            auto noodles = Mata::Strings::SegNfa::noodlify_for_equation(left_side_automata, 
-                                                                        right_side_automata,
-                                                                        false, 
-                                                                        {{"reduce", "true"}});
-
-            for (const auto &noodle : noodles) {
-                STRACE("str", tout << "Processing noodle" << std::endl; );
-                SolvingState new_element = element_to_process;
-
-                /* Explanation of the next code on an example:
-                 * Left side has variables x_1, x_2, x_3, x_2 while the right side has variables x_4, x_1, x_5, x_6, where x_1
-                 * and x_4 are length-aware (i.e. there is one automaton for concatenation of x_5 and x_6 on the right side).
-                 * Assume that noodle represents the case where it was split like this:
-                 *              | x_1 |    x_2    | x_3 |       x_2       |
-                 *              | t_1 | t_2 | t_3 | t_4 | t_5 |    t_6    |
-                 *              |    x_4    |       x_1       | x_5 | x_6 |
-                 * In the following for loop, we create the vars t1, t2, ..., t6 and prepare two vectors left_side_vars_to_new_vars
-                 * and right_side_divisions_to_new_vars which map left vars and right divisions into the concatenation of the new
-                 * vars. So for example left_side_vars_to_new_vars[1] = t_2 t_3, because second left var is x_2 and we map it to t_2 t_3,
-                 * while right_side_divisions_to_new_vars[2] = t_6, because the third division on the right represents the automaton for
-                 * concatenation of x_5 and x_6 and we map it to t_6.
-                 */
-                std::vector<std::vector<BasicTerm>> left_side_vars_to_new_vars(left_side_vars.size());
-                std::vector<std::vector<BasicTerm>> right_side_divisions_to_new_vars(right_side_division.size());
-                for (unsigned i = 0; i < noodle.size(); ++i) {
-                    // TODO do not make a new_var if we can replace it with one left or right var (i.e. new_var is exactly left or right var)
-                    // TODO also if we can substitute with epsilon, we should do that first? or generally process epsilon substitutions better, in some sort of 'preprocessing'
-                    BasicTerm new_var(BasicTermType::Variable, VAR_PREFIX + std::string("_") + std::to_string(noodlification_no) + std::string("_") + std::to_string(i));
-                    left_side_vars_to_new_vars[noodle[i].second[0]].push_back(new_var);
-                    right_side_divisions_to_new_vars[noodle[i].second[1]].push_back(new_var);
-                    new_element.aut_ass[new_var] = noodle[i].first; // we assign the automaton to new_var
-                }
-
-                // Each variable that occurs in the left side or is length-aware needs to be substituted, we use this map for that 
-                std::unordered_map<BasicTerm, std::vector<BasicTerm>> substitution_map;
-
-                /* Following the example from before, the following loop will create these inclusions from the right side divisions:
-                 *         t_1 t_2 ⊆ x_4
-                 *     t_3 t_4 t_5 ⊆ x_1
-                 *             t_6 ⊆ x_5 x_6
-                 * However, we do not add the first two inclusions into the inclusion graph but use them for substitution, i.e.
-                 *        substitution_map[x_4] = t_1 t_2
-                 *        substitution_map[x_1] = t_3 t_4 t_5
-                 * because they are length-aware vars.
-                 */
-                for (unsigned i = 0; i < right_side_division.size(); ++i) {
-                    const auto &division = right_side_division[i];
-                    if (division.size() == 1 && element_to_process.length_sensitive_vars.count(division[0]) != 0) {
-                        // right side is length-aware variable y => we are either substituting or adding new inclusion "new_vars ⊆ y"
-                        const BasicTerm &right_var = division[0];
-                        if (substitution_map.count(right_var)) {
-                            // right_var is already substituted, therefore we add 'new_vars ⊆ right_var' to the inclusion graph
-                            // TODO: how to decide if sometihng is on cycle? by previous node being on cycle, or when we recompute inclusion graph edges?
-                            const auto &new_inclusion = new_element.add_inclusion(right_side_divisions_to_new_vars[i], division, is_inclusion_to_process_on_cycle);
-                            // we also add this inclusion to the worklist, as it represents unification
-                            // we push it to the front if we are processing node that is not on the cycle, because it should not get stuck in the cycle then
-                            // TODO: is this correct? can we push to the front?
-                            // TODO: can't we push to front even if it is on cycle??
-                            new_element.push_unique(new_inclusion, is_inclusion_to_process_on_cycle);
-                            STRACE("str", tout << "added new inclusion from the right side because it could not be substituted: " << new_inclusion << std::endl; );
-                        } else {
-                            // right_var is not substitued by anything yet, we will substitute it
-                            substitution_map[right_var] = right_side_divisions_to_new_vars[i];
-                            STRACE("str", tout << "right side var " << right_var.get_name() << " replaced with:"; for (auto const &var : right_side_divisions_to_new_vars[i]) { tout << " " << var.get_name(); } tout << std::endl; );
-                            // as right_var wil be substituted in the inclusion graph, we do not need to remember the automaton assignment for it
-                            new_element.aut_ass.erase(right_var);
-                            // update the length variables
-                            for (const BasicTerm &new_var : right_side_divisions_to_new_vars[i]) {
-                                new_element.length_sensitive_vars.insert(new_var);
-                            }
-                        }
+        /********************************************************************************************************/
+        /*************************************** End of noodlification ******************************************/
+        /********************************************************************************************************/
 
-                    } else {
-                        // right side is non-length concatenation "y_1...y_n" => we are adding new inclusion "new_vars ⊆ y1...y_n"
-                        // TODO: how to decide if sometihng is on cycle? by previous node being on cycle, or when we recompute inclusion graph edges?
-                        // TODO: do we need to add inclusion if previous node was not on cycle? because I think it is not possible to get to this new node anyway
-                        const auto &new_inclusion = new_element.add_inclusion(right_side_divisions_to_new_vars[i], division, is_inclusion_to_process_on_cycle);
-                        // we add this inclusion to the worklist only if the right side contains something that was on the left (i.e. it was possibly changed)
-                        if (SolvingState::is_dependent(left_vars_set, new_inclusion.get_right_set())) {
-                            // TODO: again, push to front? back? where the fuck to push??
-                            new_element.push_unique(new_inclusion, is_inclusion_to_process_on_cycle);
-                        }
-                        STRACE("str", tout << "added new inclusion from the right side (non-length): " << new_inclusion << std::endl; );
-                    }
+        return false;
+    }
+
+    std::vector<BasicTerm> DecisionProcedure::create_noodle_vars(size_t num_of_vars) {
+        std::lock_guard<std::mutex> lock(noodle_vars_mutex);
+        const unsigned noodl_no = noodlification_no++;
+        std::vector<BasicTerm> new_vars;
+        new_vars.reserve(num_of_vars);
+        for (size_t i = 0; i < num_of_vars; ++i) {
+            new_vars.emplace_back(BasicTermType::Variable, VAR_PREFIX + std::string("_") + std::to_string(noodl_no) + std::string("_") + std::to_string(i));
+        }
+        return new_vars;
+    }
+
+    SolvingState DecisionProcedure::create_next_noodle_state(PendingNoodles& pending) {
+        const auto &noodle = pending.noodles[pending.next_noodle++];
+        const auto &left_side_vars = pending.inclusion.get_left_side();
+        const auto &right_side_division = pending.right_side_division;
+        // We will need the set of left vars, so we can sort the 'non-existing self-loop' in noodlification
+        const auto left_vars_set = pending.inclusion.get_left_set();
+        const bool is_inclusion_to_process_on_cycle = pending.is_on_cycle;
+
+        STRACE("str", tout << "Processing noodle" << std::endl; );
+        SolvingState new_element = pending.state;
+
+        /* Explanation of the next code on an example:
+         * Left side has variables x_1, x_2, x_3, x_2 while the right side has variables x_4, x_1, x_5, x_6, where x_1
+         * and x_4 are length-aware (i.e. there is one automaton for concatenation of x_5 and x_6 on the right side).
+         * Assume that noodle represents the case where it was split like this:
+         *              | x_1 |    x_2    | x_3 |       x_2       |
+         *              | t_1 | t_2 | t_3 | t_4 | t_5 |    t_6    |
+         *              |    x_4    |       x_1       | x_5 | x_6 |
+         * In the following for loop, we create the vars t1, t2, ..., t6 and prepare two vectors left_side_vars_to_new_vars
+         * and right_side_divisions_to_new_vars which map left vars and right divisions into the concatenation of the new
+         * vars. So for example left_side_vars_to_new_vars[1] = t_2 t_3, because second left var is x_2 and we map it to t_2 t_3,
+         * while right_side_divisions_to_new_vars[2] = t_6, because the third division on the right represents the automaton for
+         * concatenation of x_5 and x_6 and we map it to t_6.
+         */
+        std::vector<std::vector<BasicTerm>> left_side_vars_to_new_vars(left_side_vars.size());
+        std::vector<std::vector<BasicTerm>> right_side_divisions_to_new_vars(right_side_division.size());
+        for (unsigned i = 0; i < noodle.size(); ++i) {
+            // TODO do not make a new_var if we can replace it with one left or right var (i.e. new_var is exactly left or right var)
+            // TODO also if we can substitute with epsilon, we should do that first? or generally process epsilon substitutions better, in some sort of 'preprocessing'
+            const BasicTerm &new_var = pending.new_vars[i];
+            left_side_vars_to_new_vars[noodle[i].second[0]].push_back(new_var);
+            right_side_divisions_to_new_vars[noodle[i].second[1]].push_back(new_var);
+            // we assign the automaton to new_var, reduced if it is much bigger than the automata of the left var and the
+            // right division it comes from
+            size_t input_states = 0;
+            for (const BasicTerm &var : right_side_division[noodle[i].second[1]]) {
+                auto aut_it = pending.state.aut_ass.find(var);
+                if (aut_it != pending.state.aut_ass.end()) {
+                    input_states = std::max(input_states, aut_it->second->size());
                 }
+            }
+            auto left_aut_it = pending.state.aut_ass.find(left_side_vars[noodle[i].second[0]]);
+            if (left_aut_it != pending.state.aut_ass.end()) {
+                input_states = std::max(input_states, left_aut_it->second->size());
+            }
+            new_element.aut_ass[new_var] = reduce_if_grown(noodle[i].first, input_states);
+        }
 
-                /* Following the example from before, the following loop will create these inclusions from the left side:
-                 *           x_1 ⊆ t_1
-                 *           x_2 ⊆ t_2 t_3
-                 *           x_3 ⊆ t_4
-                 *           x_2 ⊆ t_5 t_6
-                 * Again, we want to use the inclusions for substitutions, but we replace only those variables which were
-                 * not substituted yet, so the first inclusion stays (x_1 was substituted from the right side) and the
-                 * fourth inclusion stays (as we substitute x_2 using the second inclusion). So from the second and third
-                 * inclusion we get:
-                 *        substitution_map[x_2] = t_2 t_3
-                 *        substitution_map[x_3] = t_4
-                 */
-                for (unsigned i = 0; i < left_side_vars.size(); ++i) {
-                    // TODO maybe if !is_there_length_on_right, we should just do intersection and not create new inclusions
-                    const BasicTerm &left_var = left_side_vars[i];
-                    if (left_var.is_literal()) {
-                        // we skip literals, we do not want to substitute them
-                        continue;
-                    }
-                    if (substitution_map.count(left_var)) {
-                        // left_var is already substituted, therefore we add 'left_var ⊆ left_side_vars_to_new_vars[i]' to the inclusion graph
-                        std::vector<BasicTerm> new_inclusion_left_side{ left_var };
-                        // TODO: how to decide if sometihng is on cycle? by previous node being on cycle, or when we recompute inclusion graph edges?
-                        const auto &new_inclusion = new_element.add_inclusion(new_inclusion_left_side, left_side_vars_to_new_vars[i], is_inclusion_to_process_on_cycle);
-                        // we also add this inclusion to the worklist, as it represents unification
-                        // we push it to the front if we are processing node that is not on the cycle, because it should not get stuck in the cycle then
-                        // TODO: is this correct? can we push to the front?
-                        // TODO: can't we push to front even if it is on cycle??
-                        new_element.push_unique(new_inclusion, is_inclusion_to_process_on_cycle);
-                        STRACE("str", tout << "added new inclusion from the left side because it could not be substituted: " << new_inclusion << std::endl; );
-                    } else {
-                        // TODO make this function or something, we do the same thing here as for the right side when substituting
-                        // left_var is not substitued by anything yet, we will substitute it
-                        substitution_map[left_var] = left_side_vars_to_new_vars[i];
-                        STRACE("str", tout << "left side var " << left_var.get_name() << " replaced with:"; for (auto const &var : left_side_vars_to_new_vars[i]) { tout << " " << var.get_name(); } tout << std::endl; );
-                        // as left_var wil be substituted in the inclusion graph, we do not need to remember the automaton assignment for it
-                        new_element.aut_ass.erase(left_var);
-                        // update the length variables
-                        if (new_element.length_sensitive_vars.count(left_var) > 0) { // if left_var is length-aware => substituted vars should become length-aware
-                            for (const BasicTerm &new_var : left_side_vars_to_new_vars[i]) {
-                                new_element.length_sensitive_vars.insert(new_var);
-                            }
-                        }
+        // Each variable that occurs in the left side or is length-aware needs to be substituted, we use this map for that 
+        std::unordered_map<BasicTerm, std::vector<BasicTerm>> substitution_map;
+
+        /* Following the example from before, the following loop will create these inclusions from the right side divisions:
+         *         t_1 t_2 ⊆ x_4
+         *     t_3 t_4 t_5 ⊆ x_1
+         *             t_6 ⊆ x_5 x_6
+         * However, we do not add the first two inclusions into the inclusion graph but use them for substitution, i.e.
+         *        substitution_map[x_4] = t_1 t_2
+         *        substitution_map[x_1] = t_3 t_4 t_5
+         * because they are length-aware vars.
+         */
+        for (unsigned i = 0; i < right_side_division.size(); ++i) {
+            const auto &division = right_side_division[i];
+            if (division.size() == 1 && pending.state.length_sensitive_vars->count(division[0]) != 0) {
+                // right side is length-aware variable y => we are either substituting or adding new inclusion "new_vars ⊆ y"
+                const BasicTerm &right_var = division[0];
+                if (substitution_map.count(right_var)) {
+                    // right_var is already substituted, therefore we add 'new_vars ⊆ right_var' to the inclusion graph
+                    // TODO: how to decide if sometihng is on cycle? by previous node being on cycle, or when we recompute inclusion graph edges?
+                    const auto &new_inclusion = new_element.add_inclusion(right_side_divisions_to_new_vars[i], division, is_inclusion_to_process_on_cycle);
+                    // we also add this inclusion to the worklist, as it represents unification
+                    // we push it to the front if we are processing node that is not on the cycle, because it should not get stuck in the cycle then
+                    // TODO: is this correct? can we push to the front?
+                    // TODO: can't we push to front even if it is on cycle??
+                    new_element.push_unique(new_inclusion, is_inclusion_to_process_on_cycle);
+                    STRACE("str", tout << "added new inclusion from the right side because it could not be substituted: " << new_inclusion << std::endl; );
+                } else {
+                    // right_var is not substitued by anything yet, we will substitute it
+                    substitution_map[right_var] = right_side_divisions_to_new_vars[i];
+                    STRACE("str", tout << "right side var " << right_var.get_name() << " replaced with:"; for (auto const &var : right_side_divisions_to_new_vars[i]) { tout << " " << var.get_name(); } tout << std::endl; );
+                    // as right_var wil be substituted in the inclusion graph, we do not need to remember the automaton assignment for it
+                    new_element.aut_ass.erase(right_var);
+                    // update the length variables
+                    for (const BasicTerm &new_var : right_side_divisions_to_new_vars[i]) {
+                        new_element.length_sensitive_vars.mut().insert(new_var);
                     }
                 }
 
-                // do substitution in the inclusion graph
-                new_element.substitute_vars(substitution_map);
-
-                // update the substitution_map of new_element by the new substitutions
-                new_element.substitution_map.merge(substitution_map);
-
-                // TODO should we really push to front when not on cycle?
-                if (!is_inclusion_to_process_on_cycle) {
-                    worklist.push_front(new_element);
-                } else {
-                    worklist.push_back(new_element);
+            } else {
+                // right side is non-length concatenation "y_1...y_n" => we are adding new inclusion "new_vars ⊆ y1...y_n"
+                // TODO: how to decide if sometihng is on cycle? by previous node being on cycle, or when we recompute inclusion graph edges?
+                // TODO: do we need to add inclusion if previous node was not on cycle? because I think it is not possible to get to this new node anyway
+                const auto &new_inclusion = new_element.add_inclusion(right_side_divisions_to_new_vars[i], division, is_inclusion_to_process_on_cycle);
+                // we add this inclusion to the worklist only if the right side contains something that was on the left (i.e. it was possibly changed)
+                if (SolvingState::is_dependent(left_vars_set, new_inclusion.get_right_set())) {
+                    // TODO: again, push to front? back? where the fuck to push??
+                    new_element.push_unique(new_inclusion, is_inclusion_to_process_on_cycle);
                 }
+                STRACE("str", tout << "added new inclusion from the right side (non-length): " << new_inclusion << std::endl; );
+            }
+        }
 
+        /* Following the example from before, the following loop will create these inclusions from the left side:
+         *           x_1 ⊆ t_1
+         *           x_2 ⊆ t_2 t_3
+         *           x_3 ⊆ t_4
+         *           x_2 ⊆ t_5 t_6
+         * Again, we want to use the inclusions for substitutions, but we replace only those variables which were
+         * not substituted yet, so the first inclusion stays (x_1 was substituted from the right side) and the
+         * fourth inclusion stays (as we substitute x_2 using the second inclusion). So from the second and third
+         * inclusion we get:
+         *        substitution_map[x_2] = t_2 t_3
+         *        substitution_map[x_3] = t_4
+         */
+        for (unsigned i = 0; i < left_side_vars.size(); ++i) {
+            // TODO maybe if !is_there_length_on_right, we should just do intersection and not create new inclusions
+            const BasicTerm &left_var = left_side_vars[i];
+            if (left_var.is_literal()) {
+                // we skip literals, we do not want to substitute them
+                continue;
+            }
+            if (substitution_map.count(left_var)) {
+                // left_var is already substituted, therefore we add 'left_var ⊆ left_side_vars_to_new_vars[i]' to the inclusion graph
+                std::vector<BasicTerm> new_inclusion_left_side{ left_var };
+                // TODO: how to decide if sometihng is on cycle? by previous node being on cycle, or when we recompute inclusion graph edges?
+                const auto &new_inclusion = new_element.add_inclusion(new_inclusion_left_side, left_side_vars_to_new_vars[i], is_inclusion_to_process_on_cycle);
+                // we also add this inclusion to the worklist, as it represents unification
+                // we push it to the front if we are processing node that is not on the cycle, because it should not get stuck in the cycle then
+                // TODO: is this correct? can we push to the front?
+                // TODO: can't we push to front even if it is on cycle??
+                new_element.push_unique(new_inclusion, is_inclusion_to_process_on_cycle);
+                STRACE("str", tout << "added new inclusion from the left side because it could not be substituted: " << new_inclusion << std::endl; );
+            } else {
+                // TODO make this function or something, we do the same thing here as for the right side when substituting
+                // left_var is not substitued by anything yet, we will substitute it
+                substitution_map[left_var] = left_side_vars_to_new_vars[i];
+                STRACE("str", tout << "left side var " << left_var.get_name() << " replaced with:"; for (auto const &var : left_side_vars_to_new_vars[i]) { tout << " " << var.get_name(); } tout << std::endl; );
+                // as left_var wil be substituted in the inclusion graph, we do not need to remember the automaton assignment for it
+                new_element.aut_ass.erase(left_var);
+                // update the length variables
+                if (new_element.length_sensitive_vars->count(left_var) > 0) { // if left_var is length-aware => substituted vars should become length-aware
+                    for (const BasicTerm &new_var : left_side_vars_to_new_vars[i]) {
+                        new_element.length_sensitive_vars.mut().insert(new_var);
+                    }
+                }
             }
+        }
 
-            ++noodlification_no; // TODO: when to do this increment?? maybe noodlification_no should be part of SolvingState?
-            /********************************************************************************************************/
-            /*************************************** End of noodlification ******************************************/
-            /********************************************************************************************************/
+        // do substitution in the inclusion graph
+        new_element.substitute_vars(substitution_map);
 
-        }
+        // update the substitution_map of new_element by the new substitutions
+        new_element.substitution_map.merge(substitution_map);
 
-        // there are no solving states left, which means nothing led to solution -> it must be unsatisfiable
-        return false;
+        return new_element;
     }
 
     expr_ref DecisionProcedure::get_length_from_solving_state(const std::map<BasicTerm, expr_ref>& variable_map, const SolvingState &state, const std::unordered_set<smt::noodler::BasicTerm> &vars) {
@@ -549,8 +915,7 @@ namespace smt::noodler {
 
             if (state.aut_ass.count(var) > 0) {
                 // if var is not substituted, get length constraint from its automaton
-                std::set<std::pair<int, int>> aut_constr = Mata::Strings::get_word_lengths(*state.aut_ass.at(var));
-                lengths = this->m.mk_and(lengths, mk_len_aut(z3_var, aut_constr));
+                lengths = this->m.mk_and(lengths, mk_len_aut(z3_var, get_aut_lengths(state.aut_ass.at(var))));
             } else if (state.substitution_map.count(var) > 0) {
                 // if var is substituted, then we have to create length equation
                 // i.e. if state.substitution_map[var] = x_1 x_2 ... x_n, then we create |var| = |x_1| + |x_2| + ... + |x_n|
@@ -588,7 +953,7 @@ namespace smt::noodler {
         expr_ref prep_formula = util::len_to_expr(
                 this->prep_handler.get_len_formula(),
                 variable_map,
-                this->m, this->m_util_s, this->m_util_a );
+                this->m, this->m_util_s, this->m_util_a, &this->prep_handler.get_len_node_manager() );
         lengths = this->m.mk_and(lengths, prep_formula);
 
         if(this->solution.aut_ass.size() == 0) {
@@ -600,7 +965,7 @@ namespace smt::noodler {
             lengths = this->m.mk_and(lengths, get_length_from_solving_state(variable_map, tmp_state, tmp_state.aut_ass.get_keys()));
         } else {
             // decision procedure was run, we create length constraints from the solution, we only need to look at length sensitive vars
-            lengths = this->m.mk_and(lengths, get_length_from_solving_state(variable_map, solution, solution.length_sensitive_vars));
+            lengths = this->m.mk_and(lengths, get_length_from_solving_state(variable_map, solution, *solution.length_sensitive_vars));
 
             // check whether disequalities are satisfiable
             // adds length constraint (|L| != |R| or (|x_1| == |x_2| and check_diseq(a_1,a_2)))
@@ -612,31 +977,229 @@ namespace smt::noodler {
         return lengths;
     }
 
+    bool DecisionProcedure::get_model(const std::map<BasicTerm, expr_ref>& variable_map, const model_ref& mod, std::map<BasicTerm, Mata::Word>& values) {
+        return get_model(this->solution, variable_map, mod, this->m, this->m_util_s, this->m_util_a, values);
+    }
+
+    bool DecisionProcedure::get_model(const SolvingState& state, const std::map<BasicTerm, expr_ref>& variable_map, const model_ref& mod,
+                                      ast_manager& m, seq_util& m_util_s, arith_util& m_util_a, std::map<BasicTerm, Mata::Word>& values) {
+
+        // get the word of a term that is not substituted from its automaton, preferably of the length from the model
+        auto assign_word = [&](const BasicTerm& term) {
+            auto aut_it = state.aut_ass.find(term);
+            if(aut_it == state.aut_ass.end()) {
+                if(!term.is_literal()) {
+                    return false;
+                }
+                const zstring& lit = term.get_name();
+                Mata::Word& word = values[term];
+                for(unsigned i = 0; i < lit.length(); ++i) {
+                    word.push_back(lit[i]);
+                }
+                return true;
+            }
+            Mata::Word word;
+            if(mod && term.is_variable()) {
+                expr_ref len(m);
+                auto var_it = variable_map.find(term);
+                if(var_it != variable_map.end()) {
+                    len = m_util_s.str.mk_length(var_it->second);
+                } else {
+                    // variables introduced during preprocessing or decision procedure (see get_length_from_solving_state())
+                    len = util::mk_int_var(term.get_name().encode(), m, m_util_s, m_util_a);
+                }
+                expr_ref len_val(m);
+                rational len_num;
+                if(mod->eval_expr(len, len_val, true) && m_util_a.is_numeral(len_val, len_num) && len_num.is_unsigned()
+                        && util::get_word_of_length(*aut_it->second, len_num.get_unsigned(), word)) {
+                    values[term] = std::move(word);
+                    return true;
+                }
+            }
+            if(!util::get_shortest_word(*aut_it->second, word)) {
+                return false;
+            }
+            values[term] = std::move(word);
+            return true;
+        };
+
+        // get the word of a term if the words of all the terms it depends on are known
+        std::function<bool(const BasicTerm&, Mata::Word&)> get_word;
+        get_word = [&](const BasicTerm& term, Mata::Word& word) {
+            auto it = values.find(term);
+            if(it != values.end()) {
+                word.insert(word.end(), it->second.begin(), it->second.end());
+                return true;
+            }
+            const std::vector<BasicTerm>* subst = state.substitution_map.find(term);
+            if(subst == nullptr) {
+                if(term.is_literal() && state.aut_ass.count(term) == 0) {
+                    return assign_word(term) && get_word(term, word);
+                }
+                return false;
+            }
+            Mata::Word subst_word;
+            for(const BasicTerm& part : *subst) {
+                if(!get_word(part, subst_word)) {
+                    return false;
+                }
+            }
+            word.insert(word.end(), subst_word.begin(), subst_word.end());
+            values[term] = std::move(subst_word);
+            return true;
+        };
+
+        // the terms on the right sides of inclusions get the words from the left sides, the others are independent
+        std::set<BasicTerm> right_terms;
+        for(const Predicate& inclusion : *state.inclusions) {
+            for(const BasicTerm& term : inclusion.get_right_side()) {
+                if(state.aut_ass.count(term) > 0) {
+                    right_terms.insert(term);
+                }
+            }
+        }
+        for(const auto& [term, aut] : state.aut_ass) {
+            if(right_terms.count(term) == 0 && !assign_word(term)) {
+                return false;
+            }
+        }
+
+        std::set<Predicate> unsolved(state.inclusions->begin(), state.inclusions->end());
+        while(!unsolved.empty()) {
+            bool progress = false;
+            for(auto it = unsolved.begin(); it != unsolved.end(); ) {
+                Mata::Word left_word;
+                bool left_known = true;
+                for(const BasicTerm& term : it->get_left_side()) {
+                    if(!get_word(term, left_word)) {
+                        left_known = false;
+                        break;
+                    }
+                }
+                if(!left_known) {
+                    ++it;
+                    continue;
+                }
+                // if the split does not exist, the terms of the right side get their own words below (and the
+                // theory finds out that the words are not a solution)
+                split_word(left_word, it->get_right_side(), state.aut_ass, values);
+                it = unsolved.erase(it);
+                progress = true;
+            }
+            if(!progress) {
+                // the remaining inclusions depend on each other, the word of some term of their right sides is
+                // chosen independently
+                auto term_it = std::find_if(right_terms.begin(), right_terms.end(), [&values](const BasicTerm& term) { return values.count(term) == 0; });
+                if(term_it == right_terms.end() || !assign_word(*term_it)) {
+                    return false;
+                }
+            }
+        }
+        for(const BasicTerm& term : right_terms) {
+            if(values.count(term) == 0 && !assign_word(term)) {
+                return false;
+            }
+        }
+
+        bool all_substituted = true;
+        state.substitution_map.for_each([&](const BasicTerm& var, const std::vector<BasicTerm>&) {
+            Mata::Word word;
+            all_substituted = get_word(var, word) && all_substituted;
+        });
+        return all_substituted;
+    }
+
+    bool DecisionProcedure::split_word(const Mata::Word& word, const std::vector<BasicTerm>& side, const AutAssignment& aut_ass,
+                                       std::map<BasicTerm, Mata::Word>& values) {
+        // reachable[i] maps the positions in word where the first i terms of side can end to the position where the
+        // i-th term starts
+        std::vector<std::map<size_t, size_t>> reachable(side.size() + 1);
+        reachable[0].emplace(0, 0);
+        for(size_t i = 0; i < side.size(); ++i) {
+            const BasicTerm& term = side[i];
+            auto value_it = values.find(term);
+            auto aut_it = aut_ass.find(term);
+            for(const auto& [start, prev] : reachable[i]) {
+                if(value_it != values.end()) {
+                    const Mata::Word& value = value_it->second;
+                    if(start + value.size() <= word.size() && std::equal(value.begin(), value.end(), word.begin() + start)) {
+                        reachable[i + 1].emplace(start + value.size(), start);
+                    }
+                    continue;
+                }
+                if(aut_it == aut_ass.end()) {
+                    return false;
+                }
+                // simulate the automaton of the term on the suffix of word from start
+                const Mata::Nfa::Nfa& aut = *aut_it->second;
+                std::set<Mata::Nfa::State> current(aut.initial.begin(), aut.initial.end());
+                for(size_t end = start; !current.empty(); ++end) {
+                    if(std::any_of(current.begin(), current.end(), [&aut](Mata::Nfa::State st) { return aut.final[st]; })) {
+                        reachable[i + 1].emplace(end, start);
+                    }
+                    if(end == word.size()) {
+                        break;
+                    }
+                    std::set<Mata::Nfa::State> next;
+                    for(Mata::Nfa::State st : current) {
+                        for(const auto& move : aut.delta[st]) {
+                            if(move.symbol == word[end]) {
+                                next.insert(move.targets.begin(), move.targets.end());
+                            }
+                        }
+                    }
+                    current = std::move(next);
+                }
+            }
+        }
+        if(reachable.back().count(word.size()) == 0) {
+            return false;
+        }
+
+        std::map<BasicTerm, Mata::Word> split;
+        size_t end = word.size();
+        for(size_t i = side.size(); i > 0; --i) {
+            size_t start = reachable[i].at(end);
+            if(values.count(side[i - 1]) == 0) {
+                Mata::Word part(word.begin() + start, word.begin() + end);
+                auto [it, inserted] = split.emplace(side[i - 1], part);
+                if(!inserted && it->second != part) {
+                    // a term occurring several times got different words
+                    return false;
+                }
+            }
+            end = start;
+        }
+        values.insert(split.begin(), split.end());
+        return true;
+    }
+
     expr_ref DecisionProcedure::check_diseq(const SolvingState &state, const std::pair<BasicTerm, BasicTerm>& pr) {
         // get_substituted_var(x, s) will get the most deep variable by which x is replaced in state.substitution_map and in
         // s we keep the symbols by which the nfa for x accepts (the nfa should accept words of size at most 1)
         std::function<std::vector<BasicTerm>(const smt::noodler::BasicTerm&, std::set<Mata::Symbol>&)> get_substituted_var;
         get_substituted_var = [&state, &get_substituted_var](const smt::noodler::BasicTerm &var, std::set<Mata::Symbol> &symbols_of_var) {
-            auto bla = state.substitution_map.find(var);
-            if (bla != state.substitution_map.end()) {
+            const std::vector<BasicTerm> *bla = state.substitution_map.find(var);
+            if (bla != nullptr) {
                 // var is substituted
-                if (bla->second.size() == 0) {
+                if (bla->empty()) {
                     // if var is substituted by epsilon, symbols_of_var must be empty and var is the most deep variable
                     symbols_of_var.clear();
                     return std::vector<BasicTerm>{var};
                 } else {
                     // var is substituted by some other var, recurse deeper
-                    assert(bla->second.size() == 1); // var can be substituted by only one variable
-                    return get_substituted_var(bla->second[0], symbols_of_var);
+                    assert(bla->size() == 1); // var can be substituted by only one variable
+                    return get_substituted_var((*bla)[0], symbols_of_var);
                 }
             } else {
                 // var is not substituted, get the symbols of its nfa
                 assert(state.aut_ass.count(var) > 0); // var is either in substitution map or in aut_ass
-                auto nfa = state.aut_ass.at(var);
-                nfa->trim();
+                // the automaton can be shared with other solving states (possibly processed by other threads), so we trim its copy
+                Mata::Nfa::Nfa nfa = *state.aut_ass.at(var);
+                nfa.trim();
                 // get all one-symbol words accepted by nfa assuming
                 // that nfa accepts words of size 0 and 1
-                for (const auto &tran : nfa->delta) {
+                for (const auto &tran : nfa.delta) {
                     symbols_of_var.insert(tran.symb);
                 }
                 return std::vector<BasicTerm>{var};
@@ -711,11 +1274,11 @@ namespace smt::noodler {
             expr_ref f1 = util::len_to_expr(
                 pr.second.first,
                 variable_map,
-                this->m, this->m_util_s, this->m_util_a );
+                this->m, this->m_util_s, this->m_util_a, &this->prep_handler.get_len_node_manager() );
             expr_ref f2 = util::len_to_expr(
                 pr.second.second,
                 variable_map,
-                this->m, this->m_util_s, this->m_util_a );
+                this->m, this->m_util_s, this->m_util_a, &this->prep_handler.get_len_node_manager() );
             ret = this->m.mk_and(ret, this->m.mk_or(f2, this->m.mk_and(f1, check_diseq(state, pr.first))));
         }
         return ret;
@@ -738,25 +1301,27 @@ namespace smt::noodler {
             std::deque<std::shared_ptr<GraphNode>> tmp;
             Graph incl_graph = Graph::create_inclusion_graph(this->formula, tmp);
             for (auto const &node : incl_graph.get_nodes()) {
-                initialWlEl.inclusions.insert(node->get_predicate());
+                initialWlEl.inclusions.mut().insert(node->get_predicate());
                 if (!incl_graph.is_on_cycle(node)) {
-                    initialWlEl.inclusions_not_on_cycle.insert(node->get_predicate());
+                    initialWlEl.inclusions_not_on_cycle.mut().insert(node->get_predicate());
                 }
             }
             // TODO the ordering of inclusions_to_process right now is given by how they were added from the splitting graph, should we use something different? also it is not deterministic now, depends on hashes
             while (!tmp.empty()) {
-                initialWlEl.inclusions_to_process.push_back(tmp.front()->get_predicate());
+                initialWlEl.inclusions_to_process.mut().push_back_unique(tmp.front()->get_predicate());
                 tmp.pop_front();
             }
         }
 
-        worklist.push_back(initialWlEl);
+        worklist.push_back(std::move(initialWlEl));
     }
 
     /**
      * @brief Preprocessing.
      */
     void DecisionProcedure::preprocess(PreprocessType opt) {
+        DecisionProcedureStats::ScopedTimer timer(stats->preprocess_time);
+        ++stats->num_preprocessings;
         // As a first preprocessing operation, convert string literals to fresh variables with automata assignment
         //  representing their string literal.
         conv_str_lits_to_fresh_lits();
@@ -812,44 +1377,138 @@ namespace smt::noodler {
         this->formula = this->prep_handler.get_modified_formula();
 
         if(this->formula.get_predicates().size() > 0) {
+            auto num_of_aut_states = [this]() {
+                uint64_t res = 0;
+                for (const auto& var_aut : this->init_aut_ass) {
+                    res += var_aut.second->size();
+                }
+                return res;
+            };
+            stats->aut_states_before_reduce += num_of_aut_states();
             this->init_aut_ass.reduce(); // reduce all automata in the automata assignment
+            stats->aut_states_after_reduce += num_of_aut_states();
         }
 
         STRACE("str", tout << "preprocess-output:" << std::endl << this->formula.to_string() << std::endl; );
     }
 
-    /**
-     * @brief Make a length constraint for a single NFA loop, handle
-     *
-     * @param var variable
-     * @param v1 handle
-     * @param v2 loop
-     * @return expr_ref Length formula
-     */
-    expr_ref DecisionProcedure::mk_len_aut_constr(const expr_ref& var, int v1, int v2) {
-        expr_ref len_x(var, this->m);
-        expr_ref k = util::mk_int_var_fresh("k", this->m, this->m_util_s, this->m_util_a);
-        expr_ref c1(this->m_util_a.mk_int(v1), this->m);
-        expr_ref c2(this->m_util_a.mk_int(v2), this->m);
+    const std::set<std::pair<int, int>>& DecisionProcedure::get_aut_lengths(const std::shared_ptr<Mata::Nfa::Nfa>& aut) {
+        auto it = this->aut_lengths_cache.find(aut.get());
+        if(it == this->aut_lengths_cache.end()) {
+            DecisionProcedureStats::ScopedTimer timer(stats->word_lengths_time);
+            ++stats->num_word_lengths;
+            std::set<std::pair<int, int>> lassos = remove_subsumed_lassos(Mata::Strings::get_word_lengths(*aut));
+            it = this->aut_lengths_cache.emplace(aut.get(), std::make_pair(aut, std::move(lassos))).first;
+        }
+        return it->second.second;
+    }
+
+    std::shared_ptr<Mata::Nfa::Nfa> DecisionProcedure::reduce_if_grown(const std::shared_ptr<Mata::Nfa::Nfa>& aut, size_t input_states, bool use_cache) {
+        const size_t num_of_states = aut->size();
+        if (m_params.m_reduce_growth <= 0 || num_of_states < m_params.m_reduce_min_states
+                || static_cast<double>(num_of_states) <= m_params.m_reduce_growth * static_cast<double>(input_states)) {
+            return aut;
+        }
+        if (use_cache) {
+            std::lock_guard<std::mutex> lock(reduce_cache_mutex);
+            auto it = reduce_cache.find(aut.get());
+            if (it != reduce_cache.end()) {
+                ++stats->num_size_reduction_cache_hits;
+                return it->second.second;
+            }
+        }
+
+        std::shared_ptr<Mata::Nfa::Nfa> reduced;
+        {
+            DecisionProcedureStats::ScopedTimer timer(stats->size_reduction_time);
+            reduced = std::make_shared<Mata::Nfa::Nfa>(Mata::Nfa::reduce(*aut));
+        }
+        ++stats->num_size_reductions;
+        stats->size_reduction_states_before += num_of_states;
+        stats->size_reduction_states_after += reduced->size();
+        STRACE("str-nfa", tout << "automaton reduced from " << num_of_states << " to " << reduced->size() << " states" << std::endl;);
+
+        if (use_cache) {
+            std::lock_guard<std::mutex> lock(reduce_cache_mutex);
+            if (reduce_cache.size() >= MAX_REDUCE_CACHE_SIZE) {
+                reduce_cache.clear();
+            }
+            reduce_cache.emplace(aut.get(), std::make_pair(aut, reduced));
+            // the reduction cannot be reduced further
+            reduce_cache.emplace(reduced.get(), std::make_pair(reduced, reduced));
+        }
+        return reduced;
+    }
+
+    std::set<std::pair<int, int>> DecisionProcedure::remove_subsumed_lassos(const std::set<std::pair<int, int>>& aut_constr) {
+        // lasso <h, p> is subsumed by lasso <h', q> if each h + k*p is of the form h' + l*q (for k, l >= 0)
+        auto is_subsumed = [](const std::pair<int, int>& lasso, const std::pair<int, int>& other) {
+            if(other.second == 0) {
+                return lasso == other;
+            }
+            return lasso.first >= other.first && (lasso.first - other.first) % other.second == 0 && lasso.second % other.second == 0;
+        };
 
-        if(v2 != 0) {
-            expr_ref right(this->m_util_a.mk_add(c1, this->m_util_a.mk_mul(k, c2)), this->m);
-            return expr_ref(this->m.mk_and(this->m.mk_eq(len_x, right), this->m_util_a.mk_ge(k, this->m_util_a.mk_int(0))), this->m);
+        std::set<std::pair<int, int>> res;
+        for(const auto& lasso : aut_constr) {
+            bool subsumed = false;
+            for(const auto& other : aut_constr) {
+                if(other != lasso && is_subsumed(lasso, other)) {
+                    subsumed = true;
+                    break;
+                }
+            }
+            if(!subsumed) {
+                res.insert(lasso);
+            }
         }
-        return expr_ref(this->m.mk_eq(len_x, c1), this->m);
+        return res;
     }
 
     /**
-     * @brief Make a length formula corresponding to a set of pairs <loop, handle>
+     * @brief Make a length formula corresponding to a set of pairs <handle, loop>
+     *
+     * Lassos with the same loop (period) p are merged into one modular constraint over (var mod p): for each
+     * residue r modulo p, only the lasso with the smallest handle h_r is needed and the lengths are described by
+     * var >= h_r && var mod p = r. If all residues occur and the handles follow each other, the constraint is
+     * only var >= min(h_r).
      *
      * @param var Variable
-     * @param aut_constr Set of pairs <loop, handle>
+     * @param aut_constr Set of pairs <handle, loop>
      * @return expr_ref Length constaint of the automaton
      */
-    expr_ref DecisionProcedure::mk_len_aut(const expr_ref& var, std::set<std::pair<int, int>>& aut_constr) {
+    expr_ref DecisionProcedure::mk_len_aut(const expr_ref& var, const std::set<std::pair<int, int>>& aut_constr) {
         expr_ref res(this->m.mk_false(), this->m);
+        // period -> (residue -> smallest handle with the residue)
+        std::map<int, std::map<int, int>> periodic;
         for(const auto& cns : aut_constr) {
-            res = this->m.mk_or(res, mk_len_aut_constr(var, cns.first, cns.second));
+            if(cns.second == 0) {
+                res = this->m.mk_or(res, this->m.mk_eq(var, this->m_util_a.mk_int(cns.first)));
+                continue;
+            }
+            int residue = cns.first % cns.second;
+            auto [it, inserted] = periodic[cns.second].emplace(residue, cns.first);
+            if(!inserted) {
+                it->second = std::min(it->second, cns.first);
+            }
+        }
+
+        for(const auto& [period, residues] : periodic) {
+            int min_handle = std::min_element(residues.begin(), residues.end(),
+                [](const auto& a, const auto& b) { return a.second < b.second; })->second;
+            bool is_interval = residues.size() == (size_t)period && std::all_of(residues.begin(), residues.end(),
+                [&](const auto& res_handle) { return res_handle.second < min_handle + period; });
+            if(is_interval || period == 1) {
+                res = this->m.mk_or(res, this->m_util_a.mk_ge(var, this->m_util_a.mk_int(min_handle)));
+                continue;
+            }
+            expr_ref var_mod(this->m_util_a.mk_mod(var, this->m_util_a.mk_int(period)), this->m);
+            for(const auto& [residue, handle] : residues) {
+                res = this->m.mk_or(res, this->m.mk_and(
+                    this->m_util_a.mk_ge(var, this->m_util_a.mk_int(handle)),
+                    this->m.mk_eq(var_mod, this->m_util_a.mk_int(residue))
+                ));
+            }
         }
         res = expr_ref(this->m.mk_and(res, this->m_util_a.mk_ge(var, this->m_util_a.mk_int(0))), this->m);
         return res;
@@ -4,13 +4,23 @@
 #include <memory>
 #include <deque>
 #include <algorithm>
-
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "util/statistics.h"
+#include "model/model.h"
 #include "smt/params/theory_str_noodler_params.h"
 #include "formula.h"
 #include "inclusion_graph.h"
 #include "aut_assignment.h"
 #include "state_len.h"
 #include "formula_preprocess.h"
+#include "persistent.h"
 
 namespace smt::noodler {
 
@@ -114,6 +124,109 @@ namespace smt::noodler {
 
     };
 
+    /**
+     * @brief Set of inclusions indexed by the variables occurring in them.
+     *
+     * For each variable, the index keeps the inclusions containing the variable on their left and right side, so
+     * that the inclusions depending on some variables can be found in time proportional to their number.
+     */
+    class InclusionSet {
+    public:
+        InclusionSet() = default;
+        explicit InclusionSet(const std::set<Predicate> &inclusions);
+        // the index points to the inclusions stored in the set, it has to be rebuilt for the copy
+        InclusionSet(const InclusionSet &other) : inclusions(other.inclusions) { rebuild_index(); }
+        InclusionSet(InclusionSet &&other) = default;
+        InclusionSet& operator=(const InclusionSet &other);
+        InclusionSet& operator=(InclusionSet &&other) = default;
+
+        bool insert(const Predicate &inclusion);
+        bool erase(const Predicate &inclusion);
+        size_t count(const Predicate &inclusion) const { return inclusions.count(inclusion); }
+        size_t size() const { return inclusions.size(); }
+        bool empty() const { return inclusions.empty(); }
+        std::set<Predicate>::const_iterator begin() const { return inclusions.begin(); }
+        std::set<Predicate>::const_iterator end() const { return inclusions.end(); }
+
+        /**
+         * @brief Get the inclusions whose right side contains some variable from @p vars (ordered as in the set).
+         */
+        std::vector<Predicate> get_inclusions_with_right_vars(const std::vector<BasicTerm> &vars) const {
+            return get_indexed_inclusions(vars, false);
+        }
+
+        /**
+         * @brief Get the inclusions where some variable from @p vars occurs on any side (ordered as in the set).
+         */
+        std::vector<Predicate> get_inclusions_with_vars(const std::vector<BasicTerm> &vars) const {
+            return get_indexed_inclusions(vars, true);
+        }
+
+    private:
+        using Index = std::unordered_map<BasicTerm, std::unordered_set<const Predicate*>>;
+
+        void index_inclusion(const Predicate &inclusion);
+        void unindex_inclusion(const Predicate &inclusion);
+        void rebuild_index();
+        std::vector<Predicate> get_indexed_inclusions(const std::vector<BasicTerm> &vars, bool both_sides) const;
+
+        std::set<Predicate> inclusions;
+        // variable -> inclusions containing it on the left side
+        Index left_occurrences;
+        // variable -> inclusions containing it on the right side
+        Index right_occurrences;
+    };
+
+    /**
+     * @brief Queue of inclusions without duplicates, with a hashed membership test.
+     */
+    class InclusionQueue {
+    public:
+        InclusionQueue() = default;
+        /// Creates the queue from @p inclusions, only the first occurrence of each inclusion is kept
+        explicit InclusionQueue(const std::deque<Predicate> &inclusions) {
+            for (const Predicate &inclusion : inclusions) {
+                push_back_unique(inclusion);
+            }
+        }
+
+        bool empty() const { return queue.empty(); }
+        size_t size() const { return queue.size(); }
+        bool contains(const Predicate &inclusion) const { return members.count(inclusion) > 0; }
+        const Predicate& front() const { return queue.front(); }
+        std::deque<Predicate>::const_iterator begin() const { return queue.begin(); }
+        std::deque<Predicate>::const_iterator end() const { return queue.end(); }
+
+        void pop_front() {
+            members.erase(queue.front());
+            queue.pop_front();
+        }
+
+        /// pushes inclusion to the beginning of the queue but only if it is not in it yet
+        bool push_front_unique(const Predicate &inclusion) {
+            if (!members.insert(inclusion).second) {
+                return false;
+            }
+            queue.push_front(inclusion);
+            return true;
+        }
+
+        /// pushes inclusion to the end of the queue but only if it is not in it yet
+        bool push_back_unique(const Predicate &inclusion) {
+            if (!members.insert(inclusion).second) {
+                return false;
+            }
+            queue.push_back(inclusion);
+            return true;
+        }
+
+    private:
+        std::deque<Predicate> queue;
+        std::unordered_set<Predicate> members;
+    };
+
+    struct PendingNoodles;
+
     /// A state of decision procedure that can lead to a solution
     struct SolvingState {
         // aut_ass[x] assigns variable x to some automaton while substitution_map[x] maps variable x to
@@ -121,46 +234,55 @@ namespace smt::noodler {
         // of the automata from these variables). Each variable is either assigned in aut_ass or
         // substituted in substitution_map, but not both!
         AutAssignment aut_ass;
-        std::unordered_map<BasicTerm, std::vector<BasicTerm>> substitution_map;
+        SubstitutionMap substitution_map;
+
+        // The following members are copy-on-write, so that a solving state created for a noodle shares them with
+        // its parent until they are modified (use mut() to get a modifiable value).
 
         // set of inclusions where we are trying to find aut_ass + substitution_map such that they hold 
-        std::set<Predicate> inclusions;
+        CowPtr<InclusionSet> inclusions;
         // set of inclusion from the previous set that for sure are not on cycle in the inclusion graph
         // that would be generated from inclusions
-        std::set<Predicate> inclusions_not_on_cycle;
+        CowPtr<std::set<Predicate>> inclusions_not_on_cycle;
 
-        // contains inclusions where we need to check if it holds (and if not, do something so that the inclusion holds)
-        std::deque<Predicate> inclusions_to_process;
+        // contains inclusions where we need to check if it holds (and if not, do something so that the inclusion holds),
+        // it is always a subset of inclusions
+        CowPtr<InclusionQueue> inclusions_to_process;
 
         // the variables that have length constraint on them in the rest of formula
-        std::unordered_set<BasicTerm> length_sensitive_vars;
+        CowPtr<std::unordered_set<BasicTerm>> length_sensitive_vars;
+
+        // if set, this state only stands in the worklist for the noodles whose solving states were not created yet
+        // (the other members are then unused), see PendingNoodles
+        std::shared_ptr<PendingNoodles> pending_noodles;
 
 
         SolvingState() = default;
         SolvingState(AutAssignment aut_ass,
-                     std::deque<Predicate> inclusions_to_process,
-                     std::set<Predicate> inclusions,
+                     const std::deque<Predicate> &inclusions_to_process,
+                     const std::set<Predicate> &inclusions,
                      std::set<Predicate> inclusions_not_on_cycle,
                      std::unordered_set<BasicTerm> length_sensitive_vars,
-                     std::unordered_map<BasicTerm, std::vector<BasicTerm>> substitution_map)
-                        : aut_ass(aut_ass),
-                          substitution_map(substitution_map),
-                          inclusions(inclusions),
-                          inclusions_not_on_cycle(inclusions_not_on_cycle),
-                          inclusions_to_process(inclusions_to_process),
-                          length_sensitive_vars(length_sensitive_vars) {}
+                     const std::unordered_map<BasicTerm, std::vector<BasicTerm>>& substitution_map)
+                        : aut_ass(std::move(aut_ass)),
+                          inclusions(InclusionSet(inclusions)),
+                          inclusions_not_on_cycle(std::move(inclusions_not_on_cycle)),
+                          inclusions_to_process(InclusionQueue(inclusions_to_process)),
+                          length_sensitive_vars(std::move(length_sensitive_vars)) {
+            this->substitution_map.merge(substitution_map);
+        }
 
         /// pushes inclusion to the beginning of inclusions_to_process but only if it is not in it yet
         void push_front_unique(const Predicate &inclusion) {
-            if (std::find(inclusions_to_process.begin(), inclusions_to_process.end(), inclusion) == inclusions_to_process.end()) {
-                inclusions_to_process.push_front(inclusion);
+            if (!inclusions_to_process->contains(inclusion)) {
+                inclusions_to_process.mut().push_front_unique(inclusion);
             }
         }
 
         /// pushes node to the end of nodes_to_process but only if it is not in it yet
         void push_back_unique(const Predicate &inclusion) {
-            if (std::find(inclusions_to_process.begin(), inclusions_to_process.end(), inclusion) == inclusions_to_process.end()) {
-                inclusions_to_process.push_back(inclusion);
+            if (!inclusions_to_process->contains(inclusion)) {
+                inclusions_to_process.mut().push_back_unique(inclusion);
             }
         }
 
@@ -178,7 +300,7 @@ namespace smt::noodler {
          * and say that inclusion is on cycle even if it is not).
          */
         bool is_inclusion_on_cycle(const Predicate &inclusion) {
-            return (inclusions_not_on_cycle.count(inclusion) == 0);
+            return (inclusions_not_on_cycle->count(inclusion) == 0);
         }
 
         /**
@@ -189,9 +311,9 @@ namespace smt::noodler {
          * @param is_on_cycle Whether the inclusion would be on cycle in the inclusion graph (if not sure, set to true)
          */
         void add_inclusion(const Predicate &inclusion, bool is_on_cycle = true) {
-            inclusions.insert(inclusion);
+            inclusions.mut().insert(inclusion);
             if (!is_on_cycle) {
-                inclusions_not_on_cycle.insert(inclusion);
+                inclusions_not_on_cycle.mut().insert(inclusion);
             }
         }
 
@@ -211,8 +333,10 @@ namespace smt::noodler {
         }
 
         void remove_inclusion(const Predicate &inclusion) {
-            inclusions.erase(inclusion);
-            inclusions_not_on_cycle.erase(inclusion);
+            inclusions.mut().erase(inclusion);
+            if (inclusions_not_on_cycle->count(inclusion) > 0) {
+                inclusions_not_on_cycle.mut().erase(inclusion);
+            }
         }
 
         /**
@@ -223,14 +347,7 @@ namespace smt::noodler {
          * @return The set of inclusions that depend on @p inclusion
          */
         std::vector<Predicate> get_dependent_inclusions(const Predicate &inclusion) {
-            std::vector<Predicate> dependent_inclusions;
-            auto left_vars_set = inclusion.get_left_set();
-            for (const Predicate &other_inclusion : inclusions) {
-                if (is_dependent(left_vars_set, other_inclusion.get_right_set())) {
-                    dependent_inclusions.push_back(other_inclusion);
-                }
-            }
-            return dependent_inclusions;
+            return inclusions->get_inclusions_with_right_vars(inclusion.get_left_side());
         }
 
         /**
@@ -250,7 +367,7 @@ namespace smt::noodler {
         }
 
         // substitutes vars and merge same nodes + delete copies of the merged nodes from the inclusions_to_process (and also nodes that have same sides are deleted)
-        void substitute_vars(std::unordered_map<BasicTerm, std::vector<BasicTerm>> &substitution_map);
+        void substitute_vars(const std::unordered_map<BasicTerm, std::vector<BasicTerm>> &substitution_map);
 
         /**
          * @brief Combines aut_ass and substitution_map into one AutAssigment
@@ -261,6 +378,156 @@ namespace smt::noodler {
         AutAssignment flatten_substition_map();
     };
 
+    /**
+     * @brief Noodles of one noodlification for which the solving states were not created yet.
+     *
+     * Instead of creating the solving states for all noodles at once, the decision procedure puts into the worklist
+     * one state holding the pending noodles (see SolvingState::pending_noodles). Whenever this state is taken from
+     * the worklist, the solving state of the next noodle is created and the rest of the noodles is put back to the
+     * same place, so the states are explored in the same order as if they were all created at once.
+     */
+    struct PendingNoodles {
+        // the solving state in which the inclusion was noodlified (already without the inclusion)
+        SolvingState state;
+        // the noodlified inclusion
+        Predicate inclusion;
+        // divisions of the right side of the inclusion into the parts that were noodlified
+        std::vector<std::vector<BasicTerm>> right_side_division;
+        // whether the noodlified inclusion was on cycle
+        bool is_on_cycle;
+        // the new variables of the noodlification, the i-th segment of each noodle is assigned to new_vars[i]
+        std::vector<BasicTerm> new_vars;
+        // the noodles in the order in which their solving states are created
+        std::vector<Mata::Strings::SegNfa::Noodle> noodles;
+        // index of the next noodle whose solving state is created
+        size_t next_noodle = 0;
+
+        bool has_next() const { return next_noodle < noodles.size(); }
+    };
+
+    /**
+     * @brief Statistics of the decision procedure reported through theory_str_noodler::collect_statistics().
+     *
+     * The counters are atomic, as they are updated also by the workers of ParallelWorklist. One object can be
+     * shared by several decision procedures (see DecisionProcedure::set_stats()), so that the statistics of all
+     * the instances solved by the theory are accumulated.
+     */
+    struct DecisionProcedureStats {
+        std::atomic<unsigned> num_preprocessings{ 0 };
+        std::atomic<unsigned> num_states{ 0 };
+        std::atomic<unsigned> max_worklist_size{ 0 };
+        std::atomic<unsigned> num_inclusion_tests{ 0 };
+        std::atomic<unsigned> num_noodlifications{ 0 };
+        std::atomic<unsigned> num_noodles{ 0 };
+        std::atomic<unsigned> num_word_lengths{ 0 };
+        // sums of the numbers of states of the automata in the initial assignments before/after their reduction
+        std::atomic<uint64_t> aut_states_before_reduce{ 0 };
+        std::atomic<uint64_t> aut_states_after_reduce{ 0 };
+        // reductions of the automata that grew during the noodlification (see DecisionProcedure::reduce_if_grown()),
+        // the sums of the numbers of states of the automata before/after these reductions show how much they save
+        std::atomic<unsigned> num_size_reductions{ 0 };
+        std::atomic<unsigned> num_size_reduction_cache_hits{ 0 };
+        std::atomic<uint64_t> size_reduction_states_before{ 0 };
+        std::atomic<uint64_t> size_reduction_states_after{ 0 };
+        // times in microseconds
+        std::atomic<uint64_t> preprocess_time{ 0 };
+        std::atomic<uint64_t> inclusion_time{ 0 };
+        std::atomic<uint64_t> noodlify_time{ 0 };
+        std::atomic<uint64_t> word_lengths_time{ 0 };
+        std::atomic<uint64_t> size_reduction_time{ 0 };
+
+        /**
+         * @brief Adds the time spent in its scope (in microseconds) to the given timer.
+         */
+        class ScopedTimer {
+        public:
+            explicit ScopedTimer(std::atomic<uint64_t>& timer) : timer(timer), start(std::chrono::steady_clock::now()) {}
+            ~ScopedTimer() {
+                timer += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+            }
+        private:
+            std::atomic<uint64_t>& timer;
+            std::chrono::steady_clock::time_point start;
+        };
+
+        void update_max_worklist_size(size_t size) {
+            unsigned current = max_worklist_size;
+            while (size > current && !max_worklist_size.compare_exchange_weak(current, static_cast<unsigned>(size))) {}
+        }
+
+        void collect_statistics(::statistics& st) const;
+    };
+
+    /**
+     * @brief Worklist of solving states explored by several worker threads.
+     *
+     * Each worker has its own deque of solving states which it processes in the same (BFS/DFS) order as the sequential
+     * decision procedure does with its worklist. Workers without work steal states from the back of the deques of the
+     * other workers. Solving states that are solutions are queued and taken one by one by next_solution() (which is
+     * called from the main thread, where the length constraints of the solutions are checked). The workers are stopped
+     * when the worklist is destroyed.
+     *
+     * Concurrency guarantees: solving states are moved between the threads only under the mutex, so each state is owned
+     * by one thread at a time. Different states can still share data:
+     *  - automata (shared_ptr<Nfa>) are never modified after they are created, the threads only pass them as const
+     *    arguments to Mata operations, which do not modify their arguments;
+     *  - the other parts are shared through CowPtr and SubstitutionMap, which copy a value before it is modified
+     *    (see CowPtr::mut() for the synchronization with the copies owned by other threads);
+     *  - the caches of DecisionProcedure used by the workers are protected by their own mutexes and the statistics
+     *    are atomic.
+     * The results (satisfiability and the set of solutions) are hence the same as with one thread, only the order in
+     * which the solutions are found can differ.
+     */
+    class ParallelWorklist {
+    public:
+        // function that pushes a new solving state to the front (second argument is false) or back (true) of a deque
+        using PushFunction = std::function<void(SolvingState&&, bool)>;
+        // function that processes a solving state, returns true if the solving state is a solution
+        using ProcessFunction = std::function<bool(SolvingState&, const PushFunction&)>;
+
+        /**
+         * @param stats Statistics in which the maximal size of the worklist is recorded (can be nullptr)
+         */
+        ParallelWorklist(unsigned num_of_workers, ProcessFunction process, std::deque<SolvingState> init_states,
+                         DecisionProcedureStats* stats = nullptr);
+        ~ParallelWorklist();
+
+        ParallelWorklist(const ParallelWorklist&) = delete;
+        ParallelWorklist& operator=(const ParallelWorklist&) = delete;
+
+        /**
+         * @brief Wait for the next solution found by the workers.
+         *
+         * @param[out] solution The found solution
+         * @return False if there are no solving states left (and no solution was found), true otherwise
+         */
+        bool next_solution(SolvingState& solution);
+
+    private:
+        void run_worker(unsigned worker);
+        bool has_work() const;
+        SolvingState take_state(unsigned worker);
+
+        DecisionProcedureStats* stats;
+        // number of the solving states in all the deques
+        size_t num_of_states = 0;
+
+        ProcessFunction process;
+        std::mutex mutex;
+        std::condition_variable cond;
+        // deque of solving states for each worker
+        std::vector<std::deque<SolvingState>> deques;
+        // found solutions that were not taken by next_solution() yet
+        std::deque<SolvingState> solutions;
+        // workers stop processing new states if there are this many solutions waiting
+        size_t max_waiting_solutions;
+        unsigned busy_workers = 0;
+        bool stopped = false;
+        // exception thrown by some worker, it is rethrown in next_solution()
+        std::exception_ptr error;
+        std::vector<std::thread> workers;
+    };
+
     class DecisionProcedure : public AbstractDecisionProcedure {
     protected:
         // prefix of newly created vars during the procedure
@@ -268,13 +535,27 @@ namespace smt::noodler {
         const std::string VAR_PREFIX = "tmp";
         // counter of noodlifications, so that newly created variables will have unique names per noodlification
         // by for example setting the name to VAR_PREFIX + "_" + noodlification_no + "_" + index_in_the_noodle
+        // (noodlifications can run in parallel, see ParallelWorklist, so it is protected by noodle_vars_mutex)
         unsigned noodlification_no = 0;
+        // taking the number of a noodlification and interning the names of its new variables happen together under
+        // this mutex, so that the IDs of the names (and hence the order of the new variables) follow the numbers of
+        // noodlifications also if the noodlifications run in parallel
+        std::mutex noodle_vars_mutex;
+
+        /**
+         * Take the number of the next noodlification and create its @p num_of_vars new variables (with names
+         * VAR_PREFIX + "_" + noodlification_no + "_" + index_in_the_noodle).
+         */
+        std::vector<BasicTerm> create_noodle_vars(size_t num_of_vars);
 
         FormulaPreprocess prep_handler;
 
         // a deque containing states of decision procedure, each of them can lead to a solution
         std::deque<SolvingState> worklist;
 
+        // statistics of the procedure, possibly shared with other decision procedures (see set_stats())
+        std::shared_ptr<DecisionProcedureStats> stats = std::make_shared<DecisionProcedureStats>();
+
         /// State of a found satisfiable solution set when one is computed using
         ///  'DecisionProcedure::compute_next_solution()'.
         SolvingState solution;
@@ -310,7 +591,53 @@ namespace smt::noodler {
                                                   std::map<zstring, zstring>& converted_str_literals);
 
 
-        expr_ref mk_len_aut_constr(const expr_ref& var, int v1, int v2);
+        // cache of the length abstractions of automata (see get_aut_lengths()), the automata are kept alive by the
+        // cache, so that their addresses cannot be reused by other automata
+        std::unordered_map<const Mata::Nfa::Nfa*, std::pair<std::shared_ptr<Mata::Nfa::Nfa>, std::set<std::pair<int, int>>>> aut_lengths_cache;
+
+        /**
+         * Get lengths of words of the automaton @p aut as a set of lassos <handle, loop> without the subsumed lassos
+         * (see remove_subsumed_lassos()). The lengths are cached for each automaton, as the automata are shared
+         * between the solving states.
+         */
+        const std::set<std::pair<int, int>>& get_aut_lengths(const std::shared_ptr<Mata::Nfa::Nfa>& aut);
+
+        // maximal number of automata in reduce_cache
+        static constexpr size_t MAX_REDUCE_CACHE_SIZE = 4096;
+        // cache of the reductions made by reduce_if_grown(), maps an automaton to its reduction (both are kept alive
+        // by the cache, so that their addresses cannot be reused by other automata); the automata of the noodles
+        // are shared by the noodles of one noodlification, so their reductions are reused
+        std::unordered_map<const Mata::Nfa::Nfa*, std::pair<std::shared_ptr<Mata::Nfa::Nfa>, std::shared_ptr<Mata::Nfa::Nfa>>> reduce_cache;
+        // reduce_if_grown() can be called by the workers of ParallelWorklist
+        std::mutex reduce_cache_mutex;
+
+        /**
+         * Reduce @p aut (by the simulation-based reduction) if it grew too much compared to the automata it was
+         * built from, i.e., if it has at least m_reduce_min_states states and more than m_reduce_growth times
+         * @p input_states (the number of states of the biggest automaton it was built from). Otherwise, @p aut is
+         * returned.
+         *
+         * @param use_cache Whether the reduction is cached (useless for automata that are not shared)
+         */
+        std::shared_ptr<Mata::Nfa::Nfa> reduce_if_grown(const std::shared_ptr<Mata::Nfa::Nfa>& aut, size_t input_states, bool use_cache = true);
+
+        /**
+         * Process the solving state @p element_to_process. If it has no inclusions to process, it is a solution and
+         * true is returned. Otherwise, one of its inclusions is processed (i.e. noodlified) and the resulting solving
+         * states are passed to @p push_state (together with the flag whether they should be pushed to the back of the
+         * worklist, i.e. BFS, or to its front, i.e. DFS). The states of the noodles are created lazily, see
+         * PendingNoodles. Does not access the worklist, so it can be called from
+         * several threads at once.
+         *
+         * @return True if @p element_to_process is a solution
+         */
+        bool process_state(SolvingState& element_to_process, const ParallelWorklist::PushFunction& push_state);
+
+        /**
+         * Create the solving state for the next noodle of @p pending (i.e. substitute the variables of the noodlified
+         * inclusion by the new variables of the noodle and add the new inclusions).
+         */
+        SolvingState create_next_noodle_state(PendingNoodles& pending);
         
 
         /**
@@ -349,6 +676,16 @@ namespace smt::noodler {
          */
         expr_ref len_diseqs(const std::map<BasicTerm, expr_ref>& variable_map, const SolvingState &state);
 
+        /**
+         * Split @p word into the words of the terms of @p side, where the words of literals and of the variables
+         * in @p values are fixed and the other variables get words of their automata in @p aut_ass.
+         *
+         * @param[in,out] values Words of the variables, the split words are added to it
+         * @return False if there is no such split
+         */
+        static bool split_word(const Mata::Word& word, const std::vector<BasicTerm>& side, const AutAssignment& aut_ass,
+                               std::map<BasicTerm, Mata::Word>& values);
+
     public:
         DecisionProcedure(ast_manager& m, seq_util& m_util_s, arith_util& m_util_a, const theory_str_noodler_params& par);
 
@@ -389,14 +726,57 @@ namespace smt::noodler {
          * @return expr_ref Length formula describing all solutions
          */
         expr_ref get_lengths(const std::map<BasicTerm, expr_ref>& variable_map) override;
+
+        /**
+         * @brief Get words of the variables of the current solution.
+         *
+         * The variables that are not substituted get words of their automata whose lengths are taken from the model
+         * @p mod of the length formula of the solution (see get_lengths()), or shortest words if the model does not
+         * give their lengths. Substituted variables get the concatenations of the words of their substitutions and
+         * the variables on the right sides of the remaining inclusions get the corresponding parts of the words of
+         * the left sides.
+         *
+         * @param variable_map Mapping of BasicTerm variables to the corresponding z3 variables
+         * @param mod Model of the length formula of the solution (can be null)
+         * @param[out] values Words of the variables
+         * @return False if some variable could not get a word
+         */
+        bool get_model(const std::map<BasicTerm, expr_ref>& variable_map, const model_ref& mod, std::map<BasicTerm, Mata::Word>& values);
+        /**
+         * @brief Get words of the variables of the solution @p state of some decision procedure (which does not have
+         * to exist anymore), see get_model() above.
+         */
+        static bool get_model(const SolvingState& state, const std::map<BasicTerm, expr_ref>& variable_map, const model_ref& mod,
+                              ast_manager& m, seq_util& m_util_s, arith_util& m_util_a, std::map<BasicTerm, Mata::Word>& values);
+        /**
+         * @brief Get the current solution (the last one found by compute_next_solution()).
+         */
+        const SolvingState& get_solution() const { return solution; }
         void init_computation() override;
 
         void preprocess(PreprocessType opt = PreprocessType::PLAIN) override;
 
-        expr_ref mk_len_aut(const expr_ref& var, std::set<std::pair<int, int>>& aut_constr);
+        expr_ref mk_len_aut(const expr_ref& var, const std::set<std::pair<int, int>>& aut_constr);
+
+        /**
+         * @brief Remove lassos <handle, loop> from @p aut_constr whose lengths are all lengths of some other lasso.
+         */
+        static std::set<std::pair<int, int>> remove_subsumed_lassos(const std::set<std::pair<int, int>>& aut_constr);
 
         std::unordered_set<BasicTerm> &get_init_length_vars() { return init_length_sensitive_vars; }
 
+        /**
+         * @brief Set the statistics to which the procedure contributes (e.g. statistics shared by all the decision
+         * procedures of the theory).
+         */
+        void set_stats(std::shared_ptr<DecisionProcedureStats> new_stats) { stats = std::move(new_stats); }
+        const DecisionProcedureStats& get_stats() const { return *stats; }
+
+    private:
+        // worklist shared by worker threads if the states are explored in parallel (see theory_str_noodler_params),
+        // created lazily by compute_next_solution(); declared as the last member, so that the workers are stopped
+        // before anything they use is destroyed
+        std::unique_ptr<ParallelWorklist> parallel_worklist;
     };
 }
 
@@ -30,86 +30,102 @@ Eternal glory to Yu-Fang.
 
 
 namespace smt::noodler {
+    /**
+     * @brief Persistent length oracle used by the final check.
+     *
+     * The underlying kernel stays alive across noodles and final checks. Asserted formulas of the
+     * context are added once at the base level of the kernel. Relevant assignments of the current
+     * final check and each length formula are guarded by fresh literals which are used as assumptions,
+     * so the kernel never leaves its base level and learned clauses are shared between all length
+     * checks. Guards are disabled by unit clauses at the start of the next final check.
+     */
     class int_expr_solver:expr_solver{
-        bool unsat_core=false;
+        // parameters of m_kernel; the kernel keeps a reference to them, so they have to be declared before it
+        smt_params m_params;
         kernel m_kernel;
         ast_manager& m;
-        bool initialized;
-        expr_ref_vector erv;
-    public:
-        int_expr_solver(ast_manager& m, smt_params fp):
-                m_kernel(m, fp), m(m),erv(m){
+        // formulas asserted at the base level of m_kernel (prefix of the asserted formulas of the context)
+        expr_ref_vector m_asserted;
+        // guard of the assignments of the current final check (null before the first call of initialize())
+        expr_ref m_assignments_guard;
+        // guards used since the last call of initialize(), disabled by the next one
+        expr_ref_vector m_guards;
+        // model of the last satisfiable check
+        model_ref m_model;
+
+        static smt_params without_string_solver(smt_params fp) {
             fp.m_string_solver = symbol("none");
-            initialized=false;
-       }
+            return fp;
+        }
+    public:
+        int_expr_solver(ast_manager& m, const smt_params& fp):
+                m_params(without_string_solver(fp)), m_kernel(m, m_params), m(m), m_asserted(m),
+                m_assignments_guard(m), m_guards(m) { }
 
+        /**
+         * @brief Check satisfiability of @p e together with the context passed to initialize().
+         *
+         * The formula is guarded by a fresh literal which is assumed only in this check, so it does
+         * not influence subsequent checks.
+         */
         lbool check_sat(expr* e) override {
-                bool on_screen =false;
-    //        m_kernel.push();
-            erv.push_back(e);
-            lbool r = m_kernel.check(erv);
-            erv.pop_back();
-
-            if(on_screen && r==lbool::l_false){
-                std::cout<< "UNSAT core:\n";
-                for(unsigned i=0;i<m_kernel.get_unsat_core_size();i++){
-                    std::cout<<mk_pp(m_kernel.get_unsat_core_expr(i),m)<<std::endl;
-                }
+            expr_ref guard(m.mk_fresh_const("len_guard", m.mk_bool_sort()), m);
+            m_guards.push_back(guard);
+            m_kernel.assert_expr(m.mk_implies(guard, e));
+            expr* const assumptions[2] = { guard.get(), m_assignments_guard.get() };
+            lbool r = m_kernel.check(m_assignments_guard ? 2 : 1, assumptions);
+            m_model = nullptr;
+            if(r == l_true) {
+                m_kernel.get_model(m_model);
             }
-
-    //        m_kernel.pop(1);
             return r;
         }
 
-        void initialize(context& ctx) {
-            bool on_screen =false;
-            bool include_ass = true;
-            if(!initialized){
-                initialized=true;
-                expr_ref_vector Assigns(m),Literals(m);
-                ctx.get_guessed_literals(Literals);
-                ctx.get_assignments(Assigns);
-                for (unsigned i = 0; i < ctx.get_num_asserted_formulas(); ++i) {
-                    if(on_screen) std::cout<<"check_sat context from asserted:"<<mk_pp(ctx.get_asserted_formula(i),m)<<std::endl;
-                    assert_expr(ctx.get_asserted_formula(i));
+        /**
+         * @brief Get the model of the last check_sat() (null if it was not satisfiable).
+         */
+        void get_model(model_ref& mod) { mod = m_model; }
 
+        /**
+         * @brief Synchronize the solver with the current state of the context @p ctx. Supposed to
+         * be called once per final check (before the first call of check_sat).
+         */
+        void initialize(context& ctx) {
+            // asserted formulas of the context usually only grow; if they do not (e.g., after a user pop),
+            // we start from scratch
+            const unsigned num_asserted = ctx.get_num_asserted_formulas();
+            bool is_prefix = num_asserted >= m_asserted.size();
+            for (unsigned i = 0; is_prefix && i < m_asserted.size(); ++i) {
+                is_prefix = ctx.get_asserted_formula(i) == m_asserted.get(i);
+            }
+            if(!is_prefix) {
+                m_kernel.reset();
+                m_asserted.reset();
+            } else {
+                // the guards of the previous final check are not assumed anymore, disabling them
+                // lets the kernel simplify away the clauses they guard
+                for (expr* g : m_guards) {
+                    m_kernel.assert_expr(m.mk_not(g));
                 }
-                for (auto & e : Assigns){
-                    if(ctx.is_relevant(e) && include_ass) {
-                        if(on_screen) std::cout << "check_sat context from assign:" << mk_pp(e, m) << std::endl;
-                        assert_expr(e);
-                    }
-                    // if(on_screen) std::cout << "is relevant: " << ctx.is_relevant(e) << " get_assignment: "<<ctx.get_assignment(e)<<std::endl;
-                }
-            //    for (auto & e : Literals){
-            //        if(ctx.is_relevant(e)) {
-            //            if (on_screen) std::cout << "check_sat context from guess:" << mk_pp(e, m) << std::endl;
-            //            assert_expr(e);
-            //        }
-            //        if(on_screen) std::cout << "is relevant: " << ctx.is_relevant(e) << " get_assignment: "<<ctx.get_assignment(e)<<std::endl;
-
-            //    }
-
             }
-        }
-
-        void assert_expr(expr * e) {
-            if(!unsat_core){
-                erv.push_back(e);
-                // m_kernel.assert_expr(e);
+            m_guards.reset();
+            for (unsigned i = m_asserted.size(); i < num_asserted; ++i) {
+                expr* f = ctx.get_asserted_formula(i);
+                m_asserted.push_back(f);
+                m_kernel.assert_expr(f);
+            }
 
-            } else {
-                erv.push_back(e);
-                lbool r = m_kernel.check(erv);
-                if(r==lbool::l_false){
-                    std::cout<< "UNSAT core:\n";
-                    for(unsigned i=0;i<m_kernel.get_unsat_core_size();i++){
-                        std::cout<<mk_pp(m_kernel.get_unsat_core_expr(i),m)<<std::endl;
-                    }
+            m_assignments_guard = m.mk_fresh_const("assignments_guard", m.mk_bool_sort());
+            m_guards.push_back(m_assignments_guard);
+            expr_ref_vector assigns(m);
+            ctx.get_assignments(assigns);
+            for (expr* e : assigns) {
+                if(ctx.is_relevant(e)) {
+                    m_kernel.assert_expr(m.mk_implies(m_assignments_guard, e));
                 }
             }
         }
     };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -1,7 +1,167 @@
 
+#include <atomic>
+#include <mutex>
+
 #include "formula.h"
+#include "util/util.h"
 
 namespace smt::noodler {
+    namespace {
+        struct ZstringHash {
+            size_t operator()(const zstring& str) const { return str.hash(); }
+        };
+
+        /**
+         * Names are stored in chunks of doubling sizes (the chunk k holds FIRST_CHUNK_SIZE * 2^k names), so stored
+         * names never move and the chunks of a name can be found without taking the lock. Interning, registering
+         * scopes and clearing the table are synchronized by the mutex.
+         */
+        struct NameTable {
+            static constexpr unsigned FIRST_CHUNK_BITS = 6;
+            static constexpr unsigned FIRST_CHUNK_SIZE = 1u << FIRST_CHUNK_BITS;
+            static constexpr unsigned NUM_CHUNKS = 32 - FIRST_CHUNK_BITS;
+
+            std::mutex mutex;
+            std::unordered_map<zstring, unsigned, ZstringHash> ids;
+            std::atomic<zstring*> chunks[NUM_CHUNKS];
+            unsigned num_names = 0;
+            unsigned num_scopes = 0;
+
+            NameTable() {
+                for (auto& chunk : chunks) {
+                    chunk.store(nullptr, std::memory_order_relaxed);
+                }
+                add(zstring());
+            }
+
+            ~NameTable() { clear(); }
+
+            static unsigned chunk_of(unsigned id, unsigned& offset) {
+                unsigned pos = id + FIRST_CHUNK_SIZE;
+                unsigned k = log2(pos);
+                offset = pos - (1u << k);
+                return k - FIRST_CHUNK_BITS;
+            }
+
+            const zstring& get(unsigned id) const {
+                unsigned offset;
+                unsigned k = chunk_of(id, offset);
+                return chunks[k].load(std::memory_order_acquire)[offset];
+            }
+
+            unsigned add(const zstring& name) {
+                unsigned id = num_names;
+                unsigned offset;
+                unsigned k = chunk_of(id, offset);
+                zstring* chunk = chunks[k].load(std::memory_order_relaxed);
+                if (chunk == nullptr) {
+                    chunk = new zstring[FIRST_CHUNK_SIZE << k];
+                    chunks[k].store(chunk, std::memory_order_release);
+                }
+                chunk[offset] = name;
+                ids.emplace(name, id);
+                ++num_names;
+                return id;
+            }
+
+            void clear() {
+                for (auto& chunk : chunks) {
+                    delete[] chunk.exchange(nullptr);
+                }
+                ids.clear();
+                num_names = 0;
+            }
+        };
+
+        NameTable& name_table() {
+            static NameTable table;
+            return table;
+        }
+    }
+
+    unsigned TermNameTable::intern(const zstring& name) {
+        if (name.empty()) {
+            return 0;
+        }
+        NameTable& table = name_table();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        auto it = table.ids.find(name);
+        if (it != table.ids.end()) {
+            return it->second;
+        }
+        return table.add(name);
+    }
+
+    const zstring& TermNameTable::get_name(unsigned id) {
+        // the chunk of the name was published before the ID was handed out, no lock is needed
+        return name_table().get(id);
+    }
+
+    unsigned TermNameTable::size() {
+        NameTable& table = name_table();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        return table.num_names;
+    }
+
+    TermNameTable::Scope::Scope() {
+        NameTable& table = name_table();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        ++table.num_scopes;
+    }
+
+    TermNameTable::Scope::~Scope() {
+        NameTable& table = name_table();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        if (--table.num_scopes == 0) {
+            table.clear();
+            table.add(zstring());
+        }
+    }
+
+    LenNodeManager::~LenNodeManager() {
+        // the memory of the nodes is freed with the region, only their members need to be destroyed
+        for (LenNode* node : nodes) {
+            node->~LenNode();
+        }
+    }
+
+    size_t LenNodeManager::NodeHash::operator()(const LenNode* node) const {
+        size_t res = std::hash<LenFormulaType>()(node->type);
+        auto combine = [&res](size_t hash) { res ^= hash + 0x9e3779b9 + (res << 6) + (res >> 2); };
+        combine(BasicTerm::HashFunction()(node->atom_val));
+        for (const LenNode* succ : node->succ) {
+            combine(std::hash<const LenNode*>()(succ));
+        }
+        return res;
+    }
+
+    LenNode* LenNodeManager::mk_node(LenFormulaType type, const BasicTerm& atom_val, const std::vector<LenNode*>& succ) {
+        LenNode tmp(type, atom_val, succ);
+        auto it = nodes.find(&tmp);
+        if (it != nodes.end()) {
+            return *it;
+        }
+        LenNode* node = new (nodes_region.allocate(sizeof(LenNode))) LenNode(std::move(tmp));
+        nodes.insert(node);
+        return node;
+    }
+
+    expr* LenNodeManager::get_expr(const LenNode* node, const void* variable_map) const {
+        if (variable_map != exprs_variable_map) {
+            return nullptr;
+        }
+        auto it = exprs.find(node);
+        return it != exprs.end() ? it->second.get() : nullptr;
+    }
+
+    void LenNodeManager::set_expr(const LenNode* node, const void* variable_map, const expr_ref& e) {
+        if (variable_map != exprs_variable_map) {
+            exprs.clear();
+            exprs_variable_map = variable_map;
+        }
+        exprs.emplace(node, e);
+    }
+
     std::set<BasicTerm> Predicate::get_vars() const {
         assert(is_eq_or_ineq());
         std::set<BasicTerm> vars;
@@ -151,6 +311,7 @@ namespace smt::noodler {
     }
 
     std::string BasicTerm::to_string() const {
+        const zstring& name = get_name();
         switch (type) {
             case BasicTermType::Literal: {
                 std::string result{};
@@ -24,6 +24,8 @@
 #include <unordered_set>
 #include <iostream>
 #include "util/zstring.h"
+#include "util/region.h"
+#include "ast/ast.h"
 
 namespace smt::noodler {
     enum struct PredicateType {
@@ -78,21 +80,66 @@ namespace smt::noodler {
         throw std::runtime_error("Unhandled basic term type passed to to_string().");
     }
 
+    /**
+     * @brief Table interning names of basic terms.
+     *
+     * Each distinct name gets a dense 32-bit ID (the empty name has always ID 0). Basic terms store only the ID of their
+     * name, hence they are compared, ordered and hashed using integer operations. Names are resolved back only when they
+     * are really needed (printing, conversion to z3 expressions). The table is shared by all solver instances; interning
+     * is synchronized, resolving a name is lock-free.
+     *
+     * Users of the table (the string theory) keep a Scope alive. When the last scope is closed, the table is cleared, so
+     * names do not accumulate across solver instances. Basic terms must hence not outlive the scope they were created in
+     * (terms created outside of any scope live until the end of the run or the closing of the next scope).
+     */
+    class TermNameTable {
+    public:
+        /**
+         * @brief Registration of a user of the table, the table is cleared when the last scope is destroyed.
+         */
+        class Scope {
+        public:
+            Scope();
+            ~Scope();
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+        };
+
+        /**
+         * @brief Get ID of @p name (a fresh ID is assigned to names that were not seen before).
+         */
+        static unsigned intern(const zstring& name);
+
+        /**
+         * @brief Get name with ID @p id. The returned reference stays valid until the table is cleared.
+         */
+        static const zstring& get_name(unsigned id);
+
+        /**
+         * @brief Get number of interned names.
+         */
+        static unsigned size();
+    };
+
     class BasicTerm {
     public:
-        explicit BasicTerm(BasicTermType type): type(type) {}
-        BasicTerm(BasicTermType type, zstring name): type(type), name(std::move(name)) {}
+        explicit BasicTerm(BasicTermType type): type(type), name_id(0) {}
+        BasicTerm(BasicTermType type, const zstring& name): type(type), name_id(TermNameTable::intern(name)) {}
 
         [[nodiscard]] BasicTermType get_type() const { return type; }
         [[nodiscard]] bool is_variable() const { return type == BasicTermType::Variable; }
         [[nodiscard]] bool is_literal() const { return type == BasicTermType::Literal; }
         [[nodiscard]] bool is(BasicTermType term_type) const { return type == term_type; }
 
-        [[nodiscard]] zstring get_name() const { return name; }
-        void set_name(zstring new_name) { name = std::move(new_name); }
+        [[nodiscard]] const zstring& get_name() const { return TermNameTable::get_name(name_id); }
+        void set_name(const zstring& new_name) { name_id = TermNameTable::intern(new_name); }
+        /**
+         * @brief Get ID of the name of the term (see TermNameTable).
+         */
+        [[nodiscard]] unsigned get_name_id() const { return name_id; }
 
         [[nodiscard]] bool equals(const BasicTerm& other) const {
-            return type == other.get_type() && name == other.get_name();
+            return type == other.type && name_id == other.name_id;
         }
 
         [[nodiscard]] std::string to_string() const;
@@ -100,14 +147,14 @@ namespace smt::noodler {
         struct HashFunction {
             size_t operator() (const BasicTerm& basic_term) const {
                 size_t row_hash = std::hash<BasicTermType>()(basic_term.type);
-                size_t col_hash = basic_term.name.hash() << 1;
+                size_t col_hash = std::hash<unsigned>()(basic_term.name_id) << 1;
                 return row_hash ^ col_hash;
             }
         };
 
     private:
         BasicTermType type;
-        zstring name;
+        unsigned name_id;
     }; // Class BasicTerm.
 
     [[nodiscard]] static std::string to_string(const BasicTerm& basic_term) {
@@ -116,6 +163,13 @@ namespace smt::noodler {
 
     static bool operator==(const BasicTerm& lhs, const BasicTerm& rhs) { return lhs.equals(rhs); }
     static bool operator!=(const BasicTerm& lhs, const BasicTerm& rhs) { return !(lhs == rhs); }
+    /**
+     * Terms are ordered by their type and then by the IDs of their names, i.e., in the order in which the names were
+     * interned (not lexicographically). IDs are assigned deterministically in sequential runs. The new variables of
+     * noodlifications are interned in the order of the noodlifications (see DecisionProcedure::create_noodle_vars()),
+     * which only parallel runs (Noodler's parallel_threads > 1) may change, so only they may explore states in
+     * different orders.
+     */
     static bool operator<(const BasicTerm& lhs, const BasicTerm& rhs) {
         if (lhs.get_type() < rhs.get_type()) {
             return true;
@@ -123,10 +177,7 @@ namespace smt::noodler {
             return false;
         }
         // Types are equal. Compare names.
-        if (lhs.get_name() < rhs.get_name()) {
-            return true;
-        }
-        return false;
+        return lhs.get_name_id() < rhs.get_name_id();
     }
     static bool operator>(const BasicTerm& lhs, const BasicTerm& rhs) { return !(lhs < rhs); }
 
@@ -143,6 +194,9 @@ namespace smt::noodler {
         FALSE,
     };
 
+    /**
+     * @brief Node of a length formula. Nodes are created and owned by LenNodeManager.
+     */
     struct LenNode {
         LenFormulaType type;
         BasicTerm atom_val;
@@ -150,22 +204,58 @@ namespace smt::noodler {
 
         LenNode(LenFormulaType tp, const BasicTerm& val, const std::vector<struct LenNode*>& s) : type(tp), atom_val(val), succ(s) { };
         LenNode(LenFormulaType tp, const std::vector<struct LenNode*>& s) : type(tp), atom_val(BasicTerm(BasicTermType::Length)), succ(s) { };
+    };
 
-        ~LenNode() { // as a matter of fact do not clean the whole formula (root is not cleaned; but I don't care)
-            for(size_t i = 0; i < succ.size(); i++) {
-                delete succ[i];
-            }
+    /**
+     * @brief Manager of the nodes of length formulas.
+     *
+     * Nodes are allocated in a region and freed all at once with the manager. Structurally equal nodes are
+     * hash-consed, i.e., the manager creates each node only once (the successors are compared by their
+     * addresses, as they are hash-consed too). The manager also keeps the translations of the nodes to z3
+     * expressions (see util::len_to_expr()), so that each node is translated only once.
+     */
+    class LenNodeManager {
+    public:
+        LenNodeManager() = default;
+        LenNodeManager(const LenNodeManager&) = delete;
+        LenNodeManager& operator=(const LenNodeManager&) = delete;
+        ~LenNodeManager();
+
+        LenNode* mk_node(LenFormulaType type, const BasicTerm& atom_val, const std::vector<LenNode*>& succ);
+        LenNode* mk_node(LenFormulaType type, const std::vector<LenNode*>& succ) {
+            return mk_node(type, BasicTerm(BasicTermType::Length), succ);
         }
-    };
+        /// Leaf representing the length of the variable @p var
+        LenNode* mk_leaf(const BasicTerm& var) { return mk_node(LenFormulaType::LEAF, var, {}); }
+        /// Leaf representing the number @p num
+        LenNode* mk_num(int num) { return mk_node(LenFormulaType::LEAF, BasicTerm(BasicTermType::Length, std::to_string(num)), {}); }
+
+        /// Number of (distinct) nodes created by the manager
+        size_t size() const { return nodes.size(); }
+
+        /**
+         * @brief Get the translation of @p node to z3 expression created using the variable map @p variable_map,
+         * or nullptr if there is none. The translations are kept only for one variable map at once.
+         */
+        expr* get_expr(const LenNode* node, const void* variable_map) const;
+        void set_expr(const LenNode* node, const void* variable_map, const expr_ref& e);
 
-    class LenFormula {
     private:
-        LenNode* root;
+        struct NodeHash {
+            size_t operator()(const LenNode* node) const;
+        };
+        struct NodeEqual {
+            bool operator()(const LenNode* n1, const LenNode* n2) const {
+                return n1->type == n2->type && n1->atom_val == n2->atom_val && n1->succ == n2->succ;
+            }
+        };
 
-    public:
-        LenFormula(LenNode* rt) : root(rt) { };
-        ~LenFormula() { delete this->root; };
+        region nodes_region;
+        std::unordered_set<LenNode*, NodeHash, NodeEqual> nodes;
 
+        // variable map for which the translations in exprs were created
+        const void* exprs_variable_map = nullptr;
+        std::unordered_map<const LenNode*, expr_ref> exprs;
     };
 
     //----------------------------------------------------------------------------------------------------------------------------------
@@ -269,32 +359,32 @@ namespace smt::noodler {
          * @brief Get the length formula of the equation. For an equation X1 X2 X3 ... = Y1 Y2 Y3 ...
          * creates a formula |X1|+|X2|+|X3|+ ... = |Y1|+|Y2|+|Y3|+ ...
          *
+         * @param manager Manager creating the nodes of the formula
          * @return LenNode* Root of the length formula
          */
-        LenNode* get_formula_eq() const {
+        LenNode* get_formula_eq(LenNodeManager& manager) const {
             LenNode* left, *right;
 
             auto plus_chain = [&](const std::vector<BasicTerm>& side) {
                 std::vector<LenNode*> ops;
                 if(side.size() == 0) {
-                    return new LenNode(LenFormulaType::LEAF, BasicTerm(BasicTermType::Length, "0"), {});
+                    return manager.mk_num(0);
                 }
                 if(side.size() == 1) {
-                    return new LenNode(LenFormulaType::LEAF, side[0], {});
+                    return manager.mk_leaf(side[0]);
                 }
                 for(const BasicTerm& t : side) {
-                    LenNode *n = new LenNode(LenFormulaType::LEAF, t, {});
-                    ops.push_back(n);
+                    ops.push_back(manager.mk_leaf(t));
                 }
-                return new LenNode(LenFormulaType::PLUS, ops);
+                return manager.mk_node(LenFormulaType::PLUS, ops);
             };
 
             left = plus_chain(this->params[0]);
             right = plus_chain(this->params[1]);
-            LenNode* eq = new LenNode(LenFormulaType::EQ, {left, right});
+            LenNode* eq = manager.mk_node(LenFormulaType::EQ, {left, right});
 
             if(is_inequation()) {
-                eq =  new LenNode(LenFormulaType::NOT, {eq});
+                eq = manager.mk_node(LenFormulaType::NOT, {eq});
             }
 
             return eq;
@@ -394,17 +484,20 @@ namespace smt::noodler {
 
         struct HashFunction {
             size_t operator()(const Predicate& predicate) const {
-                size_t res{};
-                size_t row_hash = std::hash<PredicateType>()(predicate.type);
-                for (const auto& term: predicate.get_left_side()) {
-                    size_t col_hash = BasicTerm::HashFunction()(term) << 1;
-                    res ^= col_hash;
+                size_t res = std::hash<PredicateType>()(predicate.type);
+                if (!predicate.is_eq_or_ineq()) {
+                    // other predicates are equal whenever their types are equal
+                    return res;
                 }
-                for (const auto& term: predicate.get_right_side()) {
-                    size_t col_hash = BasicTerm::HashFunction()(term) << 1;
-                    res ^= col_hash;
+                // sides are hashed as sequences, so that, e.g., "x y = z", "y x = z" and "z = x y" have different hashes
+                auto combine = [&res](size_t hash) { res ^= hash + 0x9e3779b9 + (res << 6) + (res >> 2); };
+                for (const auto& side: predicate.params) {
+                    for (const auto& term: side) {
+                        combine(BasicTerm::HashFunction()(term));
+                    }
+                    combine(side.size());
                 }
-                return row_hash ^ res;
+                return res;
             }
         };
 
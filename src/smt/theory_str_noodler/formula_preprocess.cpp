@@ -384,7 +384,7 @@ namespace smt::noodler {
             assert(eq.get_left_side().size() == 1 && eq.get_right_side().size() == 1);
             BasicTerm v_left = eq.get_left_side()[0]; // X
             update_reg_constr(v_left, eq.get_right_side()); // L(X) = L(X) cap L(Y)
-            this->len_formulae.push_back(eq.get_formula_eq()); // add len constraint |X| = |Y|
+            this->len_formulae.push_back(eq.get_formula_eq(*this->len_nodes)); // add len constraint |X| = |Y|
             // propagate len variables: if Y is in len_variables, include also X
             if(this->len_variables.find(eq.get_right_side()[0]) != this->len_variables.end()) {
                 this->len_variables.insert(v_left);
@@ -662,7 +662,7 @@ namespace smt::noodler {
             if(pr.first.is_variable() && is_var_eps(pr.first)) {
                 res.insert(pr.first);
             }
-            if(pr.first.is_literal() && pr.first.get_name() == "") {
+            if(pr.first.is_literal() && pr.first.get_name_id() == 0) {
                 res.insert(pr.first);
             }
             if(pr.first.is_literal() && this->aut_ass.is_epsilon(pr.first) ) {
@@ -725,7 +725,7 @@ namespace smt::noodler {
             }
             this->formula.replace(Concat({t}), Concat());
             // add len constraint |X| = 0
-            this->len_formulae.push_back(Predicate(PredicateType::Equation, {Concat({t}), Concat()}).get_formula_eq());
+            this->len_formulae.push_back(Predicate(PredicateType::Equation, {Concat({t}), Concat()}).get_formula_eq(*this->len_nodes));
         }
         this->formula.clean_predicates();
 
@@ -1165,10 +1165,10 @@ namespace smt::noodler {
             for(const BasicTerm& var : pred.get_vars()) {
                 int ln = 0;
                 if(this->aut_ass.is_co_finite(var, ln) && ln >= 0) {
-                    LenNode* right = new LenNode(LenFormulaType::LEAF, BasicTerm(BasicTermType::Length, std::to_string(ln)), {});
-                    LenNode* left = new LenNode(LenFormulaType::LEAF, var, {});
-                    LenNode* eq = new LenNode(LenFormulaType::EQ, {left, right});
-                    this->len_formulae.push_back(new LenNode(LenFormulaType::NOT, {eq}));
+                    LenNode* right = this->len_nodes->mk_num(ln);
+                    LenNode* left = this->len_nodes->mk_leaf(var);
+                    LenNode* eq = this->len_nodes->mk_node(LenFormulaType::EQ, {left, right});
+                    this->len_formulae.push_back(this->len_nodes->mk_node(LenFormulaType::NOT, {eq}));
                     this->aut_ass[var] = std::make_shared<Mata::Nfa::Nfa>(this->aut_ass.sigma_star_automaton());
                 }
             }
@@ -1271,7 +1271,7 @@ namespace smt::noodler {
                     this->dis_len.insert({
                         {a1, a2},
                         // represents (|a1| == |a2|, |a1| != |a2|), must be (true, false) as a1 and a2 have the same length 1
-                        {new LenNode(LenFormulaType::TRUE, {}), new LenNode(LenFormulaType::FALSE, {})} 
+                        {this->len_nodes->mk_node(LenFormulaType::TRUE, {}), this->len_nodes->mk_node(LenFormulaType::FALSE, {})} 
                     });
                     continue;;
                 }
@@ -1305,12 +1305,12 @@ namespace smt::noodler {
             for(const auto& t : pr.second.get_vars()) {
                 this->len_variables.insert(t);
             }
-            auto len2 = pr.second.get_formula_eq();
+            auto len2 = pr.second.get_formula_eq(*this->len_nodes);
 
             // we want |x1| == |x2|, making x1 and x2 length ones
             this->len_variables.insert(x1);
             this->len_variables.insert(x2);
-            auto len1 = Predicate(PredicateType::Equation, {Concat({x1}), Concat({x2})}).get_formula_eq();
+            auto len1 = Predicate(PredicateType::Equation, {Concat({x1}), Concat({x2})}).get_formula_eq(*this->len_nodes);
 
             // we are going to check that a1 and a2 contain different symbols, we need exact languages, so we make them length
             this->len_variables.insert(a1);
@@ -1321,6 +1321,45 @@ namespace smt::noodler {
         }
     }
 
+    std::vector<std::vector<size_t>> FormulaPreprocess::split_components(const std::vector<std::set<BasicTerm>>& item_vars) {
+        // union-find of the variables, the root of a variable is the representative of its component
+        std::map<BasicTerm, BasicTerm> parent;
+        std::function<BasicTerm(const BasicTerm&)> find = [&](const BasicTerm& var) -> BasicTerm {
+            auto it = parent.find(var);
+            if(it == parent.end() || it->second == var) {
+                return var;
+            }
+            BasicTerm root = find(it->second);
+            it->second = root;
+            return root;
+        };
+        for(const auto& vars : item_vars) {
+            if(vars.empty()) {
+                continue;
+            }
+            BasicTerm first_root = find(*vars.begin());
+            for(const BasicTerm& var : vars) {
+                BasicTerm root = find(var);
+                if(root != first_root) {
+                    parent.insert_or_assign(root, first_root);
+                }
+            }
+        }
 
+        std::vector<std::vector<size_t>> components;
+        std::map<BasicTerm, size_t> root_to_component;
+        for(size_t i = 0; i < item_vars.size(); i++) {
+            if(item_vars[i].empty()) {
+                components.push_back({i});
+                continue;
+            }
+            auto [it, inserted] = root_to_component.emplace(find(*item_vars[i].begin()), components.size());
+            if(inserted) {
+                components.emplace_back();
+            }
+            components[it->second].push_back(i);
+        }
+        return components;
+    }
 
 } // Namespace smt::noodler.
@@ -143,7 +143,7 @@ namespace smt::noodler {
         };
 
 
-        bool is_init(const BasicTerm& t) const { return t.get_name() == ""; };
+        bool is_init(const BasicTerm& t) const { return t.get_name_id() == 0; }; // empty name has always ID 0
 
         /**
          * @brief Special node s (variable with empty name) denoting beginning and end of a concatenation. If there is
@@ -300,6 +300,8 @@ namespace smt::noodler {
         FormulaVar formula;
         unsigned fresh_var_cnt;
         AutAssignment aut_ass;
+        // manager of the nodes of the length formulae (shared by the copies of the preprocessor)
+        std::shared_ptr<LenNodeManager> len_nodes;
         std::vector<LenNode*> len_formulae;
         // contains pairs ((a1, a2), (len1, len2)) where we want formula (len2 or (len1 and (a1 != a2))) to hold, see replace_disequalities
         std::map<std::pair<BasicTerm, BasicTerm>,std::pair<LenNode*, LenNode*>> dis_len;
@@ -329,6 +331,7 @@ namespace smt::noodler {
             formula(conj),
             fresh_var_cnt(0),
             aut_ass(ass),
+            len_nodes(std::make_shared<LenNodeManager>()),
             len_variables(lv),
             m_params(par),
             dependency() { };
@@ -340,7 +343,8 @@ namespace smt::noodler {
         const AutAssignment& get_aut_assignment() const { return this->aut_ass; }
         const Dependency& get_dependency() const { return this->dependency; }
         Dependency get_flat_dependency() const;
-        const LenNode* get_len_formula() const { return new LenNode(LenFormulaType::AND, this->len_formulae); }
+        const LenNode* get_len_formula() const { return this->len_nodes->mk_node(LenFormulaType::AND, this->len_formulae); }
+        LenNodeManager& get_len_node_manager() const { return *this->len_nodes; }
         const std::unordered_set<BasicTerm>& get_len_variables() const { return this->len_variables; }
         const std::map<std::pair<BasicTerm, BasicTerm>,std::pair<LenNode*, LenNode*>> get_diseq_len() const {return this->dis_len;} 
 
@@ -362,6 +366,16 @@ namespace smt::noodler {
         void reduce_diseqalities();
         void replace_disequalities();
 
+        /**
+         * @brief Split items (predicates, atoms, ...) into connected components of items (transitively) sharing
+         * variables. Variable-disjoint components can be solved independently. Items without variables form their
+         * own components.
+         *
+         * @param item_vars Variables of each item
+         * @return Indices of the items of each component
+         */
+        static std::vector<std::vector<size_t>> split_components(const std::vector<std::set<BasicTerm>>& item_vars);
+
         /**
          * @brief Replace all occurrences of find with replace. Warning: do not modify the automata assignment.
          *
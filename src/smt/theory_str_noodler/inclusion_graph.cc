@@ -149,6 +149,8 @@ void smt::noodler::Graph::substitute_vars(const std::unordered_map<BasicTerm, st
     for (const auto &node : out_deleted_nodes) {
         nodes.erase(node);
     }
+    // predicates of the nodes were changed
+    rebuild_node_index();
 }
 
 Graph smt::noodler::Graph::create_inclusion_graph(const Formula& formula, std::deque<std::shared_ptr<GraphNode>> &out_node_order) {
@@ -236,7 +238,7 @@ Graph smt::noodler::Graph::create_inclusion_graph(Graph& simplified_splitting_gr
 
         for (auto& node: simplified_splitting_graph.get_nodes()) {
             if (simplified_splitting_graph.inverse_edges.count(node) == 0) {
-                inclusion_graph.nodes.insert(node);
+                inclusion_graph.insert_node(node);
                 STRACE("str", tout << "Added node " << node->get_predicate() << " to the graph without the reversed inclusion." << std::endl;);
                 inclusion_graph.nodes_not_on_cycle.insert(node); // the inserted node cannot be on the cycle, because it is either initial or all nodes leading to it were not on cycle
 
@@ -249,8 +251,8 @@ Graph smt::noodler::Graph::create_inclusion_graph(Graph& simplified_splitting_gr
                 simplified_splitting_graph.remove_edges_with(switched_node);
 
                 // we can erase nodes, because we are breaking from the for loop (so no problem with invalidating iterators)
-                simplified_splitting_graph.nodes.erase(node);
-                simplified_splitting_graph.nodes.erase(switched_node);
+                simplified_splitting_graph.erase_node(node);
+                simplified_splitting_graph.erase_node(switched_node);
 
                 splitting_graph_changed = true;
                 break;
@@ -263,7 +265,11 @@ Graph smt::noodler::Graph::create_inclusion_graph(Graph& simplified_splitting_gr
         out_node_order.push_back(node);
         STRACE("str", tout << "Added node " << node->get_predicate() << " to the graph with its reversed inclusion." << std::endl;);
     }
-    inclusion_graph.nodes.merge(simplified_splitting_graph.nodes);
+    for (auto& node: simplified_splitting_graph.get_nodes()) {
+        inclusion_graph.insert_node(node);
+    }
+    simplified_splitting_graph.nodes.clear();
+    simplified_splitting_graph.node_index.clear();
 
     inclusion_graph.add_inclusion_graph_edges();
 
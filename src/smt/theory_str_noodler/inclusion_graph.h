@@ -61,6 +61,35 @@ namespace smt::noodler {
         // set of nodes that are NOT on some cycle
         // it is guaranteed to be correct ONLY after creating inclusion graph???
         std::unordered_set<std::shared_ptr<GraphNode>> nodes_not_on_cycle;
+        // nodes indexed by their predicates (there can be more nodes with the same predicate), it is updated by all
+        // functions of the graph, but not when the predicate of some node is changed from outside of the graph
+        std::unordered_multimap<Predicate, std::shared_ptr<GraphNode>> node_index;
+
+        void insert_node(const std::shared_ptr<GraphNode> &node) {
+            if (nodes.insert(node).second) {
+                node_index.emplace(node->get_predicate(), node);
+            }
+        }
+
+        void erase_node(const std::shared_ptr<GraphNode> &node) {
+            if (nodes.erase(node) == 0) {
+                return;
+            }
+            auto range = node_index.equal_range(node->get_predicate());
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == node) {
+                    node_index.erase(it);
+                    return;
+                }
+            }
+        }
+
+        void rebuild_node_index() {
+            node_index.clear();
+            for (const auto &node : nodes) {
+                node_index.emplace(node->get_predicate(), node);
+            }
+        }
 
         void remove_edge_from_edges(std::shared_ptr<GraphNode> source, std::shared_ptr<GraphNode> target) {
             if (edges.count(source) == 0) {
@@ -151,9 +180,13 @@ namespace smt::noodler {
         }
 
         std::shared_ptr<GraphNode> get_node(const Predicate& predicate) {
-            auto node = std::find_if(nodes.begin(), nodes.end(), [&predicate](const std::shared_ptr<GraphNode> &el){ return (el->get_predicate() == predicate);});
-            if (node == nodes.end()) { return nullptr; }
-            return *node;
+            auto range = node_index.equal_range(predicate);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second->get_predicate() == predicate) {
+                    return it->second;
+                }
+            }
+            return nullptr;
         }
 
         /**
@@ -164,7 +197,7 @@ namespace smt::noodler {
         std::shared_ptr<GraphNode> add_node(const Predicate& predicate) {
             // TODO check if added node already does not exists??? by calling get_node?
             std::shared_ptr<GraphNode> new_node = std::make_shared<GraphNode>(predicate);
-            nodes.insert(new_node);
+            insert_node(new_node);
             return new_node;
         }
 
@@ -179,7 +212,7 @@ namespace smt::noodler {
 
         void remove_node(const std::shared_ptr<GraphNode> node) {
             remove_edges_with(node);
-            nodes.erase(node);
+            erase_node(node);
         }
 
         bool is_on_cycle(const std::shared_ptr<GraphNode> &node) {
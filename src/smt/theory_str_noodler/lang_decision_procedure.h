@@ -58,7 +58,7 @@ namespace smt::noodler {
 
         void preprocess(PreprocessType opt = PreprocessType::PLAIN) override;
 
-        expr_ref mk_len_aut(const expr_ref& var, std::set<std::pair<int, int>>& aut_constr);
+        expr_ref mk_len_aut(const expr_ref& var, const std::set<std::pair<int, int>>& aut_constr);
 
     };
 }
@@ -0,0 +1,166 @@
+/**
+ * @brief Persistent (copy-on-write) data structures used by the solving states of the decision procedure.
+ *
+ * Solving states are copied for each noodle, but a child state usually changes only a small part of its parent.
+ * The structures here allow the child to share the unchanged parts with its parent.
+ */
+
+#ifndef _NOODLER_PERSISTENT_H_
+#define _NOODLER_PERSISTENT_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "formula.h"
+
+namespace smt::noodler {
+
+    /**
+     * @brief Copy-on-write pointer to a value of type @p T.
+     *
+     * Copies of CowPtr share the same value, which is copied only if it is going to be modified (see mut()) while
+     * it is still shared with some other CowPtr.
+     */
+    template<typename T>
+    class CowPtr {
+    public:
+        CowPtr() : ptr(std::make_shared<T>()) {}
+        CowPtr(T value) : ptr(std::make_shared<T>(std::move(value))) {}
+
+        const T& operator*() const { return *ptr; }
+        const T* operator->() const { return ptr.get(); }
+        operator const T&() const { return *ptr; }
+
+        /**
+         * @brief Get modifiable value, detaching it from the other copies of this pointer if needed.
+         *
+         * Copies can be owned by different threads (see ParallelWorklist). use_count() is only a relaxed load, so if
+         * the value is not shared anymore, the acquire fence is needed to synchronize with the release of the other
+         * copies (done by the decrement of the reference count) before the value is modified.
+         */
+        T& mut() {
+            if (ptr.use_count() > 1) {
+                ptr = std::make_shared<T>(*ptr);
+            } else {
+                std::atomic_thread_fence(std::memory_order_acquire);
+            }
+            return *ptr;
+        }
+
+        /**
+         * @brief Check whether this pointer shares its value with @p other.
+         */
+        bool shares_with(const CowPtr<T>& other) const { return ptr == other.ptr; }
+
+    private:
+        std::shared_ptr<T> ptr;
+    };
+
+    /**
+     * @brief Persistent map from variables to the vectors of variables by which they were substituted.
+     *
+     * The map is a chain of layers where each layer points to the layer of its parent. Copying the map is therefore
+     * constant and merging new substitutions creates only a new layer containing them. As a variable is substituted
+     * at most once, the layers are always disjoint. If the chain gets too long, it is squashed into one layer so
+     * that the lookups stay fast.
+     */
+    class SubstitutionMap {
+    public:
+        using Map = std::unordered_map<BasicTerm, std::vector<BasicTerm>>;
+
+        SubstitutionMap() = default;
+
+        /**
+         * @brief Get the substitution of @p var or nullptr if @p var is not substituted.
+         */
+        const std::vector<BasicTerm>* find(const BasicTerm& var) const {
+            for (const Layer* layer = top.get(); layer != nullptr; layer = layer->parent.get()) {
+                auto it = layer->map.find(var);
+                if (it != layer->map.end()) {
+                    return &it->second;
+                }
+            }
+            return nullptr;
+        }
+
+        size_t count(const BasicTerm& var) const { return find(var) != nullptr ? 1 : 0; }
+
+        const std::vector<BasicTerm>& at(const BasicTerm& var) const {
+            const std::vector<BasicTerm>* subst = find(var);
+            if (subst == nullptr) {
+                throw std::out_of_range("variable " + var.to_string() + " is not substituted");
+            }
+            return *subst;
+        }
+
+        size_t size() const { return top ? top->size : 0; }
+        bool empty() const { return size() == 0; }
+
+        /**
+         * @brief Add substitutions from @p substitutions. Substitutions of variables that are already substituted
+         * are ignored (similarly as in std::unordered_map::merge).
+         */
+        void merge(const Map& substitutions) {
+            auto layer = std::make_shared<Layer>();
+            for (const auto& subst : substitutions) {
+                if (find(subst.first) == nullptr) {
+                    layer->map.insert(subst);
+                }
+            }
+            if (layer->map.empty()) {
+                return;
+            }
+            if (top && top->depth + 1 >= MAX_DEPTH) {
+                // squash the chain so that the lookups do not have to go through too many layers
+                for_each([&layer](const BasicTerm& var, const std::vector<BasicTerm>& subst) { layer->map.emplace(var, subst); });
+            } else {
+                layer->parent = top;
+                layer->depth = top ? top->depth + 1 : 0;
+            }
+            layer->size = layer->map.size() + (layer->parent ? layer->parent->size : 0);
+            top = std::move(layer);
+        }
+
+        /**
+         * @brief Call @p fun(var, substitution) for each substituted variable.
+         */
+        template<typename F>
+        void for_each(F fun) const {
+            for (const Layer* layer = top.get(); layer != nullptr; layer = layer->parent.get()) {
+                for (const auto& subst : layer->map) {
+                    fun(subst.first, subst.second);
+                }
+            }
+        }
+
+        /**
+         * @brief Get the substitutions as one (non-persistent) map.
+         */
+        Map to_map() const {
+            Map ret;
+            for_each([&ret](const BasicTerm& var, const std::vector<BasicTerm>& subst) { ret.emplace(var, subst); });
+            return ret;
+        }
+
+    private:
+        // maximal number of layers in the chain
+        static constexpr size_t MAX_DEPTH = 8;
+
+        struct Layer {
+            Map map;
+            std::shared_ptr<const Layer> parent;
+            // number of the layers below this one
+            size_t depth = 0;
+            // number of substitutions in this layer and all the layers below
+            size_t size = 0;
+        };
+
+        std::shared_ptr<const Layer> top;
+    };
+
+} // Namespace smt::noodler.
+
+#endif //_NOODLER_PERSISTENT_H_
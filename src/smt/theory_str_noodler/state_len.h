@@ -43,6 +43,28 @@ namespace smt::noodler {
         return true;
     } 
 
+    /**
+     * @brief Hash of an instance (set of expressions) that does not depend on the order of its elements.
+     * Equal instances (see obj_hashtable_equal) have the same hash.
+     */
+    struct InstanceHash {
+        size_t operator()(const Instance& inst) const {
+            size_t res = inst.size();
+            for(expr* const e : inst) {
+                // ids are mixed before summing them, so that instances with the same sum of ids do not collide
+                uint64_t h = static_cast<uint64_t>(e->get_id()) * 0x9e3779b97f4a7c15ULL;
+                res += static_cast<size_t>(h ^ (h >> 32));
+            }
+            return res;
+        }
+    };
+
+    struct InstanceEqual {
+        bool operator()(const Instance& inst1, const Instance& inst2) const {
+            return obj_hashtable_equal(inst1, inst2);
+        }
+    };
+
     /**
      * @brief Class representing the map Set(expr) -> T. Used for storing sets of processed 
      * conjunctions of string atoms. It can be used for storing the current state of computation 
@@ -53,41 +75,37 @@ namespace smt::noodler {
     template<typename T>
     class StateLen {
     private:
-        vector<std::pair<obj_hashtable<expr>, T>> state_visited;
+        std::unordered_map<Instance, T, InstanceHash, InstanceEqual> state_visited;
 
     public:
         StateLen() : state_visited() { }
 
-        bool contains(const obj_hashtable<expr>& state) {
-            for(const auto& st : this->state_visited) {
-                if(obj_hashtable_equal(st.first, state))
-                    return true;
-            }            
-            return false;
+        bool contains(const obj_hashtable<expr>& state) const {
+            return this->state_visited.find(state) != this->state_visited.end();
         }
 
         void add(const obj_hashtable<expr>& state, const T& def) {
-            if(!contains(state)){
-                this->state_visited.push_back({state, def});
-            }
+            this->state_visited.emplace(state, def);
         }
 
         const T& get_val(const Instance& inst) const {
-            for(const auto& st : this->state_visited) {
-                if(obj_hashtable_equal(st.first, inst))
-                    return st.second;
-            }            
-            UNREACHABLE();
+            auto it = this->state_visited.find(inst);
+            if(it == this->state_visited.end()) {
+                UNREACHABLE();
+            }
+            return it->second;
         }
 
         void update_val(const Instance& inst, const T& val) {
-            for(auto& st : this->state_visited) {
-                if(obj_hashtable_equal(st.first, inst)) {
-                    st.second = val;   
-                    return;
-                }
-            } 
+            auto it = this->state_visited.find(inst);
+            if(it != this->state_visited.end()) {
+                it->second = val;
+            }
         }
+
+        size_t size() const { return this->state_visited.size(); }
+
+        void clear() { this->state_visited.clear(); }
     };
 }
 
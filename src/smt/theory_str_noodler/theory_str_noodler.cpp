@@ -7,7 +7,9 @@ Eternal glory to Yu-Fang.
 #include <sstream>
 #include <iostream>
 #include <cmath>
+#include <optional>
 #include "ast/ast_pp.h"
+#include "ast/rewriter/expr_safe_replace.h"
 #include "smt/theory_str_noodler/theory_str_noodler.h"
 #include "smt/smt_context.h"
 #include "smt/smt_model_generator.h"
@@ -34,13 +36,27 @@ namespace smt::noodler {
         m_util_a(m),
         m_util_s(m),
         state_len(),
-        m_length(m) {
+        m_length(m),
+        m_aut_cache(m),
+        m_model_literals(m) {
     }
 
     void theory_str_noodler::display(std::ostream &os) const {
         os << "theory_str display" << std::endl;
     }
 
+    void theory_str_noodler::collect_statistics(::statistics& st) const {
+        st.update("noodler final checks", m_stats.m_final_checks);
+        st.update("noodler final check time", m_final_check_time.get_seconds());
+        st.update("noodler solved instance hits", m_stats.m_solved_instance_hits);
+        st.update("noodler bounded search sat", m_stats.m_bounded_search_sat);
+        st.update("noodler underapprox sat", m_stats.m_underapprox_sat);
+        st.update("noodler len checks", m_stats.m_len_checks);
+        st.update("noodler len check time", m_len_check_time.get_seconds());
+        st.update("noodler split instances", m_stats.m_split_instances);
+        m_dp_stats->collect_statistics(st);
+    }
+
     void theory_str_noodler::init() {
         theory::init();
         STRACE("str", if (!IN_CHECK_FINAL) tout << "init\n";);
@@ -714,6 +730,14 @@ namespace smt::noodler {
         for(const auto& we : m_lang_diseq_todo) {
             this->m_lang_eq_todo_rel.push_back({we.first, we.second, false});
         }
+
+        this->m_not_contains_todo_rel.clear();
+        for(const auto& we : m_not_contains_todo) {
+            app_ref cont(m_util_s.str.mk_contains(we.first, we.second), m);
+            if(ctx.is_relevant(cont.get()) && !this->m_not_contains_todo_rel.contains(we)) {
+                this->m_not_contains_todo_rel.push_back(we);
+            }
+        }
     }
 
     /*
@@ -721,16 +745,15 @@ namespace smt::noodler {
     */
     final_check_status theory_str_noodler::final_check_eh() {
         TRACE("str", tout << "final_check starts\n";);
+        scoped_watch _sw(m_final_check_time);
+        ++m_stats.m_final_checks;
 
         remove_irrelevant_constr();
+        this->m_len_solver_ready = false;
+        this->m_model_values.clear();
 
         STRACE("str", tout << "eq: " << this->m_word_eq_todo_rel.size() << " diseq: " << this->m_word_diseq_todo_rel.size() << " res: " << this->m_membership_todo_rel.size() << std::endl);
 
-        // difficult not(contains) predicates -> unknown
-        if(!this->m_not_contains_todo.empty()) {
-            return FC_GIVEUP;
-        }
-
         expr* fls = nullptr; // false term
         obj_hashtable<expr> conj;
         obj_hashtable<app> conj_instance;
@@ -788,21 +811,63 @@ namespace smt::noodler {
         }
 
         // Get symbols in the whole formula.
+        util::SymbolClasses symbol_classes;
         std::set<uint32_t> symbols_in_formula{ util::get_symbols_for_formula(
-                m_word_eq_todo_rel, m_word_diseq_todo_rel, m_membership_todo_rel, m_lang_eq_todo_rel, m_util_s, m
+                m_word_eq_todo_rel, m_word_diseq_todo_rel, m_membership_todo_rel, m_lang_eq_todo_rel, m_util_s, m,
+                &symbol_classes
         )};
+        for (const auto& nc : this->m_not_contains_todo_rel) {
+            util::extract_symbols(nc.first, m_util_s, m, symbols_in_formula, &symbol_classes);
+            util::extract_symbols(nc.second, m_util_s, m, symbols_in_formula, &symbol_classes);
+        }
+        // symbols from ranges that the formula cannot distinguish are represented by the few symbols that the negated
+        // constraints can require to be distinct
+        size_t num_representatives = new_symbs + this->m_not_contains_todo_rel.size() + 1;
+        for (const auto& lang_eq : this->m_lang_eq_todo_rel) {
+            if (!std::get<2>(lang_eq)) {
+                ++num_representatives;
+            }
+        }
+        symbols_in_formula = symbol_classes.get_alphabet(symbols_in_formula, num_representatives);
 
         // Add dummy symbols for all disequations.
         // FIXME: we can possibly create more dummy symbols than the size of alphabet (196607 - from string theory standard), but it is edge-case that is nearly impossible to happen
-        std::set<uint32_t> dummy_symbols{ util::get_dummy_symbols(std::max(new_symbs, size_t(3)), symbols_in_formula) };
+        std::set<uint32_t> dummy_symbols{ util::get_dummy_symbols(std::max(new_symbs, size_t(3)), symbols_in_formula, &symbol_classes) };
         // Create automata assignment for the formula.
         AutAssignment aut_assignment{util::create_aut_assignment_for_formula(
-                instance, m_membership_todo_rel, this->var_name, m_util_s, m, symbols_in_formula
+                instance, m_membership_todo_rel, this->var_name, m_util_s, m, symbols_in_formula, &this->m_aut_cache
         ) };
+        // not(contains) predicates become regular constraints; those that cannot be expressed exactly are dropped,
+        // so the instance is overapproximated and a solution of it does not have to be a solution of the original one
+        const final_check_status sat_status = add_not_contains_constrs(aut_assignment);
 
         expr_ref lengths(m);
         std::unordered_set<BasicTerm> init_length_sensitive_vars{ get_init_length_vars(aut_assignment) };
 
+        // the same instance was solved in a previous final check, try to decide it using the remembered solutions
+        auto solved = std::make_shared<SolvedInstance>(m);
+        Instance solved_key = get_instance_atoms(init_length_sensitive_vars, solved->atoms);
+        if(this->m_solved_instances.contains(solved_key)) {
+            // the bounded search is not tried again for an instance for which it already failed
+            solved->bounded_search_failed = this->m_solved_instances.get_val(solved_key)->bounded_search_failed;
+            lbool res = check_solved_instance(*this->m_solved_instances.get_val(solved_key));
+            if(res != l_undef) {
+                ++m_stats.m_solved_instance_hits;
+            }
+            if(res == l_true) {
+                // the model is built from the remembered solutions
+                std::map<BasicTerm, Mata::Word> values;
+                if(get_context().get_fparams().m_model && get_model_words(*this->m_solved_instances.get_val(solved_key),
+                        instance, aut_assignment, values)) {
+                    set_model_values(std::move(values), instance, aut_assignment);
+                }
+                return sat_status;
+            } else if(res == l_false) {
+                IN_CHECK_FINAL = false;
+                return FC_CONTINUE;
+            }
+        }
+
         AutAssignment lang_aut_ass;
         Formula lang_instance = conv_lang_instance(symbols_in_formula, lang_aut_ass);
         LangDecisionProcedure lang_proc{ lang_instance, lang_aut_ass, init_length_sensitive_vars, m, m_util_s, m_util_a, m_params };
@@ -812,21 +877,59 @@ namespace smt::noodler {
             return FC_DONE;
         }
 
+        // try to find a short solution first
+        if(m_params.m_bounded_search_timeout > 0 && !solved->bounded_search_failed) {
+            if(solve_bounded(instance, aut_assignment, init_length_sensitive_vars) == l_true) {
+                STRACE("str", tout << "bounded search sat \n";);
+                ++m_stats.m_bounded_search_sat;
+                return sat_status;
+            }
+            solved->bounded_search_failed = true;
+        }
+
+        // remember the results for this instance (also if it is split into components, so that the failure of the
+        // bounded search is remembered)
+        if(this->m_solved_instances.size() >= MAX_SOLVED_INSTANCES) {
+            this->m_solved_instances.clear();
+        }
+        if(this->m_solved_instances.contains(solved_key)) {
+            this->m_solved_instances.update_val(solved_key, solved);
+        } else {
+            this->m_solved_instances.add(solved_key, solved);
+        }
+
         // use underapproximation to solve
         if(m_params.m_underapproximation && solve_underapprox(instance, aut_assignment, init_length_sensitive_vars) == l_true) {
             STRACE("str", tout << "underapprox sat \n";);
-            return FC_DONE;
+            ++m_stats.m_underapprox_sat;
+            return sat_status;
+        }
+
+        // variable-disjoint components of the instance are solved separately, so that the decision procedure does not
+        // explore the cross product of their solutions
+        std::vector<InstanceComponent> components = get_instance_components(aut_assignment, init_length_sensitive_vars);
+        if(components.size() > 1) {
+            ++m_stats.m_split_instances;
+            if(solve_components(components, instance, aut_assignment) == l_true) {
+                return sat_status;
+            }
+            IN_CHECK_FINAL = false;
+            return FC_CONTINUE;
         }
 
         DecisionProcedure dec_proc = DecisionProcedure{ instance, aut_assignment, 
             init_length_sensitive_vars, m, m_util_s, m_util_a, 
             this->var_eqs.get_equivalence_bt(), m_params };
+        dec_proc.set_stats(m_dp_stats);
         dec_proc.preprocess();
+
+        solved->block_with_lengths = dec_proc.get_init_length_vars().size() > 0;
         
         model_ref mod;
         if(init_length_sensitive_vars.size() > 0) {
             // check if the initial assignment is len unsat
             lengths = dec_proc.get_lengths(this->var_name);
+            solved->init_lengths = lengths;
             if(check_len_sat(lengths, mod) == l_false) {
                 block_curr_len(lengths);
                 return FC_DONE;
@@ -837,15 +940,21 @@ namespace smt::noodler {
         dec_proc.init_computation();
         while(dec_proc.compute_next_solution()) {
             lengths = dec_proc.get_lengths(this->var_name);
+            solved->solution_lengths.push_back(lengths);
+            if(get_context().get_fparams().m_model) {
+                solved->solutions.push_back(dec_proc.get_solution());
+            }
             if(check_len_sat(lengths, mod) == l_true) {
                 STRACE("str", tout << "len sat " << mk_pp(lengths, m) << std::endl;);
-                return FC_DONE;
+                store_model(dec_proc, lengths, instance, aut_assignment);
+                return sat_status;
             }
             if(dec_proc.get_init_length_vars().size() > 0) {
                 block_len = m.mk_or(block_len, lengths);
             }
             STRACE("str", tout << "len unsat" <<  mk_pp(lengths, m) << std::endl;);
         }
+        solved->complete = true;
 
         // all len solutions are unsat, we block the current assignment
         block_curr_len(block_len);
@@ -867,6 +976,7 @@ namespace smt::noodler {
         DecisionProcedure dec_proc = DecisionProcedure{ instance, aut_assignment, 
             init_length_sensitive_vars, m, m_util_s, m_util_a, 
             this->var_eqs.get_equivalence_bt(), m_params };
+        dec_proc.set_stats(m_dp_stats);
         dec_proc.preprocess(PreprocessType::UNDERAPPROX);
         
         expr_ref lengths(m);
@@ -875,22 +985,337 @@ namespace smt::noodler {
         while(dec_proc.compute_next_solution()) {
             lengths = dec_proc.get_lengths(this->var_name);
             if(check_len_sat(lengths, mod) == l_true) {
+                store_model(dec_proc, lengths, instance, aut_assignment);
                 return l_true;
             }
         }
         return l_false;
     }
 
+    /**
+     * @brief Solve the given constraint by the bounded-length search for short solutions (see BoundedWordSearch).
+     *
+     * @param instance Formula
+     * @param aut_assignment Initial automata assignment
+     * @param init_length_sensitive_vars Length sensitive variables
+     * @return l_true if a solution whose lengths satisfy the length constraints was found, l_undef otherwise
+     */
+    lbool theory_str_noodler::solve_bounded(const Formula& instance, const AutAssignment& aut_assignment, const std::unordered_set<BasicTerm>& init_length_sensitive_vars) {
+        BoundedWordSearch search(instance, aut_assignment, m_params.m_bounded_search_timeout);
+        model_ref mod;
+        // solutions with the same lengths of the length-sensitive variables are checked only once
+        std::set<std::vector<size_t>> checked_lengths;
+        auto accept = [&](const BoundedWordSearch::WordAssignment& words) {
+            expr_ref_vector len_constr(m);
+            std::vector<size_t> lengths;
+            for(const BasicTerm& var : init_length_sensitive_vars) {
+                auto word_it = words.find(var);
+                auto var_it = this->var_name.find(var);
+                if(word_it == words.end() || var_it == this->var_name.end()) {
+                    continue;
+                }
+                lengths.push_back(word_it->second.size());
+                len_constr.push_back(m.mk_eq(m_util_s.str.mk_length(var_it->second), m_util_a.mk_int(static_cast<unsigned>(word_it->second.size()))));
+            }
+            if(!checked_lengths.insert(lengths).second) {
+                return false;
+            }
+            return check_len_sat(expr_ref(m.mk_and(len_constr), m), mod) == l_true;
+        };
+        std::optional<BoundedWordSearch::WordAssignment> solution = search.search(m_params.m_bounded_search_max_length, accept);
+        if(!solution.has_value()) {
+            return l_undef;
+        }
+        if(get_context().get_fparams().m_model) {
+            set_model_values(std::move(*solution), instance, aut_assignment);
+        }
+        return l_true;
+    }
+
+    void theory_str_noodler::store_model(DecisionProcedure& dec_proc, const expr_ref& lengths, const Formula& instance, const AutAssignment& aut_assignment) {
+        if(!get_context().get_fparams().m_model) {
+            return;
+        }
+        std::map<BasicTerm, Mata::Word> values;
+        if(get_model_words(dec_proc.get_solution(), lengths, values)) {
+            set_model_values(std::move(values), instance, aut_assignment);
+        }
+    }
+
+    bool theory_str_noodler::get_model_words(const SolvingState& solution, const expr_ref& lengths, std::map<BasicTerm, Mata::Word>& values) {
+        // the lengths of the words have to be the lengths from the arithmetic model of the context
+        arith_value arith(m);
+        arith.init(&get_context());
+        expr_ref_vector len_constr(m);
+        len_constr.push_back(lengths);
+        for(expr* const var : this->len_vars) {
+            expr_ref len(m_util_s.str.mk_length(var), m);
+            rational len_val;
+            if(get_context().e_internalized(len) && arith.get_value(len, len_val)) {
+                len_constr.push_back(m.mk_eq(len, m_util_a.mk_int(len_val)));
+            }
+        }
+        model_ref mod;
+        return check_len_sat(expr_ref(m.mk_and(len_constr), m), mod) == l_true
+            && DecisionProcedure::get_model(solution, this->var_name, mod, m, m_util_s, m_util_a, values);
+    }
+
+    bool theory_str_noodler::get_model_words(const SolvedInstance& solved, const Formula& instance, const AutAssignment& aut_assignment,
+            std::map<BasicTerm, Mata::Word>& values) {
+        const std::set<BasicTerm> instance_vars = instance.get_vars();
+        for(size_t i = 0; i < solved.solutions.size(); ++i) {
+            std::map<BasicTerm, Mata::Word> solution_values;
+            if(get_model_words(solved.solutions[i], expr_ref(solved.solution_lengths.get(i), m), solution_values)) {
+                // only the words of the variables of the instance are kept, the variables introduced by the decision
+                // procedure can have the same names in other instances
+                for(auto& [var, word] : solution_values) {
+                    if(var.is_variable() && (aut_assignment.count(var) > 0 || instance_vars.count(var) > 0)) {
+                        values[var] = std::move(word);
+                    }
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void theory_str_noodler::set_model_values(std::map<BasicTerm, Mata::Word> values, const Formula& instance, const AutAssignment& aut_assignment) {
+        // get the word of a side of an equation, nullopt if the word of some of its variables is not known
+        auto get_side_word = [&values](const std::vector<BasicTerm>& side) -> std::optional<Mata::Word> {
+            Mata::Word word;
+            for(const BasicTerm& term : side) {
+                if(term.is_literal()) {
+                    const zstring& lit = term.get_name();
+                    for(unsigned i = 0; i < lit.length(); ++i) {
+                        word.push_back(lit[i]);
+                    }
+                    continue;
+                }
+                auto it = values.find(term);
+                if(it == values.end()) {
+                    return std::nullopt;
+                }
+                word.insert(word.end(), it->second.begin(), it->second.end());
+            }
+            return word;
+        };
+
+        // variables eliminated by the preprocessing get words from the equations where they are the only unknown
+        // variable (occurring once), the remaining ones get shortest words of their languages
+        std::set<BasicTerm> unknown_vars;
+        for(const Predicate& pred : instance.get_predicates()) {
+            for(const BasicTerm& var : pred.get_vars()) {
+                if(values.count(var) == 0) {
+                    unknown_vars.insert(var);
+                }
+            }
+        }
+        for(const auto& [var, aut] : aut_assignment) {
+            if(var.is_variable() && values.count(var) == 0) {
+                unknown_vars.insert(var);
+            }
+        }
+        while(!unknown_vars.empty()) {
+            bool changed = true;
+            while(changed) {
+                changed = false;
+                for(const Predicate& pred : instance.get_predicates()) {
+                    if(!pred.is_equation()) {
+                        continue;
+                    }
+                    for(const auto& [side, other] : { std::make_pair(pred.get_left_side(), pred.get_right_side()), std::make_pair(pred.get_right_side(), pred.get_left_side()) }) {
+                        std::optional<Mata::Word> other_word = get_side_word(other);
+                        if(!other_word.has_value()) {
+                            continue;
+                        }
+                        auto unknown = std::find_if(side.begin(), side.end(), [&values](const BasicTerm& t) { return t.is_variable() && values.count(t) == 0; });
+                        if(unknown == side.end() || std::count(side.begin(), side.end(), *unknown) != 1) {
+                            continue;
+                        }
+                        std::optional<Mata::Word> prefix = get_side_word(std::vector<BasicTerm>(side.begin(), unknown));
+                        std::optional<Mata::Word> suffix = get_side_word(std::vector<BasicTerm>(unknown + 1, side.end()));
+                        if(!prefix.has_value() || !suffix.has_value() || prefix->size() + suffix->size() > other_word->size()) {
+                            continue;
+                        }
+                        values[*unknown] = Mata::Word(other_word->begin() + prefix->size(), other_word->end() - suffix->size());
+                        unknown_vars.erase(*unknown);
+                        changed = true;
+                    }
+                }
+            }
+            if(unknown_vars.empty()) {
+                break;
+            }
+            const BasicTerm var = *unknown_vars.begin();
+            unknown_vars.erase(unknown_vars.begin());
+            Mata::Word word;
+            auto aut_it = aut_assignment.find(var);
+            if(aut_it != aut_assignment.end() && !util::get_shortest_word(*aut_it->second, word)) {
+                return;
+            }
+            values[var] = std::move(word);
+        }
+
+        // check that the words are a solution
+        for(const Predicate& pred : instance.get_predicates()) {
+            if(!pred.is_eq_or_ineq()) {
+                continue;
+            }
+            std::optional<Mata::Word> left = get_side_word(pred.get_left_side());
+            std::optional<Mata::Word> right = get_side_word(pred.get_right_side());
+            if(!left.has_value() || !right.has_value() || (pred.is_equation() != (*left == *right))) {
+                STRACE("str", tout << "model rejected by " << pred.to_string() << std::endl;);
+                return;
+            }
+        }
+        for(const auto& [var, aut] : aut_assignment) {
+            auto it = values.find(var);
+            if(var.is_variable() && (it == values.end() || !util::is_word_accepted(*aut, it->second))) {
+                STRACE("str", tout << "model rejected by the language of " << var.to_string() << std::endl;);
+                return;
+            }
+        }
+        this->m_model_values = std::move(values);
+        for(const auto& nc : this->m_not_contains_todo_rel) {
+            Mata::Word haystack, needle;
+            if(get_model_value(nc.first, haystack) && get_model_value(nc.second, needle)
+                    && std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end()) != haystack.end()) {
+                STRACE("str", tout << "model rejected by not(contains) " << mk_pp(nc.first, m) << " " << mk_pp(nc.second, m) << std::endl;);
+                this->m_model_values.clear();
+                return;
+            }
+        }
+        arith_value arith(m);
+        arith.init(&get_context());
+        for(expr* const var : this->len_vars) {
+            expr_ref len(m_util_s.str.mk_length(var), m);
+            rational len_val;
+            Mata::Word word;
+            if(get_context().e_internalized(len) && arith.get_value(len, len_val) && get_model_value(var, word)
+                    && len_val != rational(static_cast<unsigned>(word.size()))) {
+                STRACE("str", tout << "model rejected by the length of " << mk_pp(var, m) << std::endl;);
+                this->m_model_values.clear();
+                return;
+            }
+        }
+    }
+
+    bool theory_str_noodler::get_model_value(expr* const e, Mata::Word& value) {
+        zstring lit;
+        expr *left = nullptr, *right = nullptr;
+        if(m_util_s.str.is_string(e, lit)) {
+            for(unsigned i = 0; i < lit.length(); ++i) {
+                value.push_back(lit[i]);
+            }
+            return true;
+        }
+        if(m_util_s.str.is_concat(e, left, right)) {
+            return get_model_value(left, value) && get_model_value(right, value);
+        }
+        if(util::is_str_variable(e, m_util_s)) {
+            auto it = this->m_model_values.find(util::get_variable_basic_term(e));
+            if(it == this->m_model_values.end()) {
+                return false;
+            }
+            value.insert(value.end(), it->second.begin(), it->second.end());
+            return true;
+        }
+        // functions replaced by fresh variables in the instance (see predicate_replace)
+        expr* replacement = nullptr;
+        if(this->predicate_replace.find(e, replacement)) {
+            return get_model_value(replacement, value);
+        }
+        return false;
+    }
+
+    Instance theory_str_noodler::get_instance_atoms(const std::unordered_set<BasicTerm>& init_length_sensitive_vars, expr_ref_vector& atoms) {
+        context& ctx = get_context();
+        for (const auto& we : this->m_word_eq_todo_rel) {
+            atoms.push_back(ctx.mk_eq_atom(we.first, we.second));
+        }
+        for (const auto& we : this->m_word_diseq_todo_rel) {
+            atoms.push_back(m.mk_not(ctx.mk_eq_atom(we.first, we.second)));
+        }
+        for (const auto& in : this->m_membership_todo_rel) {
+            app_ref in_app(m_util_s.re.mk_in_re(std::get<0>(in), std::get<1>(in)), m);
+            atoms.push_back(std::get<2>(in) ? in_app.get() : m.mk_not(in_app));
+        }
+        for (const auto& in : this->m_lang_eq_todo_rel) {
+            app_ref eq_app(ctx.mk_eq_atom(std::get<0>(in), std::get<1>(in)), m);
+            atoms.push_back(std::get<2>(in) ? eq_app.get() : m.mk_not(eq_app));
+        }
+        for (const auto& nc : this->m_not_contains_todo_rel) {
+            atoms.push_back(m.mk_not(m_util_s.str.mk_contains(nc.first, nc.second)));
+        }
+        return mk_instance_key(init_length_sensitive_vars, atoms);
+    }
+
+    Instance theory_str_noodler::mk_instance_key(const std::unordered_set<BasicTerm>& length_sensitive_vars, expr_ref_vector& atoms) {
+        // the length formulas depend also on which variables are length-sensitive
+        for (expr* const len : this->len_vars) {
+            if(length_sensitive_vars.count(util::get_variable_basic_term(len)) > 0) {
+                atoms.push_back(len);
+            }
+        }
+
+        Instance res;
+        for (expr* const atom : atoms) {
+            res.insert(atom);
+        }
+        return res;
+    }
+
+    lbool theory_str_noodler::check_solved_instance(const SolvedInstance& solved) {
+        STRACE("str", tout << "reusing solved instance with " << solved.solution_lengths.size() << " solutions" << std::endl;);
+        model_ref mod;
+        if(solved.init_lengths && check_len_sat(solved.init_lengths, mod) == l_false) {
+            block_curr_len(solved.init_lengths);
+            return l_false;
+        }
+
+        expr_ref block_len(m.mk_false(), m);
+        for (expr* const lengths : solved.solution_lengths) {
+            if(check_len_sat(expr_ref(lengths, m), mod) == l_true) {
+                return l_true;
+            }
+            if(solved.block_with_lengths) {
+                block_len = m.mk_or(block_len, lengths);
+            }
+        }
+
+        if(!solved.complete) {
+            // there can be other solutions that were not computed
+            return l_undef;
+        }
+        block_curr_len(block_len);
+        return l_false;
+    }
+
     model_value_proc *theory_str_noodler::mk_value(enode *const n, model_generator &mg) {
         app *const tgt = n->get_expr();
         (void) m;
         STRACE("str", tout << "mk_value: sort is " << mk_pp(tgt->get_sort(), m) << ", "
                            << mk_pp(tgt, m) << '\n';);
+        if(m_util_s.is_string(tgt->get_sort()) && !this->m_model_values.empty()) {
+            // take the word of some term of the equivalence class whose word is known
+            enode* curr = n;
+            do {
+                Mata::Word word;
+                if(get_model_value(curr->get_expr(), word)) {
+                    std::vector<unsigned> chars(word.begin(), word.end());
+                    app* value = m_util_s.str.mk_string(zstring(static_cast<unsigned>(chars.size()), chars.data()));
+                    this->m_model_literals.push_back(value);
+                    return alloc(expr_wrapper_proc, value);
+                }
+                curr = curr->get_next();
+            } while(curr != n);
+        }
         return alloc(expr_wrapper_proc, tgt);
     }
 
     void theory_str_noodler::init_model(model_generator &mg) {
         STRACE("str", if (!IN_CHECK_FINAL) tout << "init_model\n";);
+        this->m_model_literals.reset();
     }
 
     void theory_str_noodler::finalize_model(model_generator &mg) {
@@ -1800,7 +2225,8 @@ namespace smt::noodler {
 
     /**
      * @brief Heuristics for handling not contains: not(contains(s, t)).
-     * So far only the case when t is a string literal is implemented.
+     * If t is a string literal, it is translated to a negated regular constraint. Otherwise, it is
+     * handled in the final check (see add_not_contains_constr).
      *
      * @param e contains term.
      */
@@ -1825,6 +2251,62 @@ namespace smt::noodler {
         }
     }
 
+    final_check_status theory_str_noodler::add_not_contains_constrs(AutAssignment& aut_ass) {
+        bool is_overapprox = false;
+        for (const auto& nc : this->m_not_contains_todo_rel) {
+            if(!add_not_contains_constr(nc.first, nc.second, aut_ass)) {
+                is_overapprox = true;
+            }
+        }
+        return is_overapprox ? FC_GIVEUP : FC_DONE;
+    }
+
+    bool theory_str_noodler::add_not_contains_constr(expr* x, expr* y, AutAssignment& aut_ass) {
+        std::vector<BasicTerm> x_terms, y_terms;
+        util::collect_terms(to_app(x), m, this->m_util_s, this->predicate_replace, this->var_name, x_terms);
+        if(x_terms.size() != 1 || !x_terms[0].is_variable()) {
+            return false;
+        }
+        util::collect_terms(to_app(y), m, this->m_util_s, this->predicate_replace, this->var_name, y_terms);
+
+        Mata::Nfa::Nfa sigma_star = aut_ass.sigma_star_automaton();
+        Mata::Nfa::Nfa y_aut = Mata::Nfa::create_empty_string_nfa();
+        for(const BasicTerm& t : y_terms) {
+            if(t.is_literal()) {
+                y_aut = Mata::Nfa::concatenate(y_aut, util::create_word_nfa(t.get_name()));
+            } else if(aut_ass.count(t) > 0) {
+                y_aut = Mata::Nfa::concatenate(y_aut, *aut_ass.at(t));
+            } else {
+                y_aut = Mata::Nfa::concatenate(y_aut, sigma_star);
+            }
+        }
+        y_aut = Mata::Nfa::minimize(y_aut);
+        if(Mata::Nfa::is_lang_empty(y_aut)) {
+            // y has no value, the instance is unsatisfiable anyway
+            return true;
+        }
+        // y has a single value iff its (minimal) automaton is a path accepting words of one length
+        auto y_lengths = Mata::Strings::get_word_lengths(y_aut);
+        if(y_lengths.size() != 1 || y_lengths.begin()->second != 0 || y_aut.size() != y_aut.get_num_of_trans() + 1) {
+            STRACE("str", tout << "not(contains) overapproximated: " << mk_pp(x, m) << " " << mk_pp(y, m) << std::endl;);
+            return false;
+        }
+
+        Mata::OnTheFlyAlphabet mata_alphabet{};
+        for (const auto& symbol : aut_ass.get_alphabet()) {
+            mata_alphabet.add_new_symbol(std::to_string(symbol), symbol);
+        }
+        Mata::Nfa::Nfa contains_y = Mata::Nfa::concatenate(Mata::Nfa::concatenate(sigma_star, y_aut), sigma_star);
+        Mata::Nfa::Nfa not_contains_y = Mata::Nfa::complement(contains_y, mata_alphabet);
+
+        const BasicTerm& x_var = x_terms[0];
+        if(aut_ass.count(x_var) > 0) {
+            not_contains_y = Mata::Nfa::intersection(*aut_ass.at(x_var), not_contains_y);
+        }
+        aut_ass[x_var] = std::make_shared<Mata::Nfa::Nfa>(Mata::Nfa::reduce(not_contains_y));
+        return true;
+    }
+
     void theory_str_noodler::handle_in_re(expr *const e, const bool is_true) {
         expr *s = nullptr, *re = nullptr;
         VERIFY(m_util_s.str.is_in_re(e, s, re));
@@ -1971,6 +2453,12 @@ namespace smt::noodler {
             //STRACE("str", tout << wi.first << " != " << wi.second << '\n';);
         }
 
+        // not(contains) predicates restrict the automata assignment, so they are part of the refinement too
+        for (const auto& nc : this->m_not_contains_todo_rel) {
+            expr_ref not_cont(m.mk_not(m_util_s.str.mk_contains(nc.first, nc.second)), m);
+            refinement = refinement == nullptr ? not_cont : m.mk_and(refinement, not_cont);
+        }
+
         if (refinement != nullptr) {
             add_axiom(m.mk_or(m.mk_not(refinement), len_formula));
         }
@@ -1978,6 +2466,244 @@ namespace smt::noodler {
 
     }
 
+    void theory_str_noodler::block_atoms_len(const expr_ref_vector& atoms, expr* len_formula) {
+        if(atoms.empty()) {
+            return;
+        }
+        add_axiom(m.mk_or(m.mk_not(m.mk_and(atoms)), len_formula));
+    }
+
+    std::vector<theory_str_noodler::InstanceComponent> theory_str_noodler::get_instance_components(const AutAssignment& aut_assignment,
+            const std::unordered_set<BasicTerm>& init_length_sensitive_vars) {
+        context& ctx = get_context();
+
+        // string atoms of the current instance with their predicates (none for memberships) and string variables
+        expr_ref_vector atoms(m);
+        std::vector<std::optional<Predicate>> atom_preds;
+        std::vector<std::set<BasicTerm>> atom_vars;
+        for (const auto& we : this->m_word_eq_todo_rel) {
+            app_ref atom(ctx.mk_eq_atom(we.first, we.second), m);
+            atom_preds.emplace_back(conv_eq_pred(atom));
+            atom_vars.push_back(atom_preds.back()->get_vars());
+            atoms.push_back(atom);
+        }
+        for (const auto& we : this->m_word_diseq_todo_rel) {
+            app_ref atom(m.mk_not(ctx.mk_eq_atom(we.first, we.second)), m);
+            atom_preds.emplace_back(conv_eq_pred(atom));
+            atom_vars.push_back(atom_preds.back()->get_vars());
+            atoms.push_back(atom);
+        }
+        for (const auto& in : this->m_membership_todo_rel) {
+            app_ref in_app(m_util_s.re.mk_in_re(std::get<0>(in), std::get<1>(in)), m);
+            atom_preds.emplace_back(std::nullopt);
+            atom_vars.push_back({ BasicTerm(BasicTermType::Variable, to_app(std::get<0>(in))->get_decl()->get_name().str()) });
+            atoms.push_back(std::get<2>(in) ? in_app.get() : m.mk_not(in_app));
+        }
+        for (const auto& nc : this->m_not_contains_todo_rel) {
+            obj_hashtable<expr> vars;
+            util::get_str_variables(nc.first, m_util_s, m, vars);
+            util::get_str_variables(nc.second, m_util_s, m, vars);
+            atom_preds.emplace_back(std::nullopt);
+            atom_vars.emplace_back();
+            for (expr* const v : vars) {
+                atom_vars.back().insert(BasicTerm(BasicTermType::Variable, to_app(v)->get_name().str()));
+            }
+            atoms.push_back(m.mk_not(m_util_s.str.mk_contains(nc.first, nc.second)));
+        }
+
+        std::vector<InstanceComponent> components;
+        for (const auto& comp : FormulaPreprocess::split_components(atom_vars)) {
+            InstanceComponent& res = components.emplace_back(m);
+            std::unordered_set<BasicTerm> comp_vars;
+            for (size_t i : comp) {
+                if(atom_preds[i].has_value()) {
+                    res.instance.add_predicate(*atom_preds[i]);
+                }
+                comp_vars.insert(atom_vars[i].begin(), atom_vars[i].end());
+                res.atoms.push_back(atoms.get(i));
+            }
+            res.aut_ass = aut_assignment;
+            for (const BasicTerm& var : aut_assignment.get_keys()) {
+                if(comp_vars.count(var) == 0) {
+                    res.aut_ass.erase(var);
+                }
+            }
+            for (const BasicTerm& var : init_length_sensitive_vars) {
+                if(comp_vars.count(var) > 0) {
+                    res.length_vars.insert(var);
+                }
+            }
+        }
+        return components;
+    }
+
+    lbool theory_str_noodler::solve_components(std::vector<InstanceComponent>& components, const Formula& instance, const AutAssignment& aut_assignment) {
+        // solving of a single component
+        struct ComponentState {
+            // results of the component, possibly remembered from some previous final check
+            std::shared_ptr<SolvedInstance> solved;
+            // decision procedure of the component (null if all the needed solutions are in solved)
+            std::unique_ptr<DecisionProcedure> dec_proc;
+            // disjunction of the length formulas of the solutions found so far (with fresh variables renamed apart)
+            expr_ref lengths;
+
+            ComponentState(ast_manager& m) : lengths(m.mk_false(), m) {}
+        };
+        model_ref mod;
+
+        // a solution without length constraints subsumes all the other solutions of the component
+        auto add_solution = [this](ComponentState& state, expr* lengths) {
+            expr_ref simp_lengths(lengths, m);
+            m_rewrite(simp_lengths);
+            if(m.is_true(simp_lengths)) {
+                state.lengths = m.mk_true();
+                state.solved->complete = true;
+                state.dec_proc = nullptr;
+            } else {
+                state.lengths = m.mk_or(state.lengths, rename_len_vars_apart(simp_lengths));
+            }
+        };
+
+        std::vector<ComponentState> states;
+        for (InstanceComponent& comp : components) {
+            ComponentState& state = states.emplace_back(m);
+            expr_ref_vector key_atoms(comp.atoms);
+            Instance key = mk_instance_key(comp.length_vars, key_atoms);
+            if(this->m_solved_instances.contains(key) && this->m_solved_instances.get_val(key)->complete) {
+                ++m_stats.m_solved_instance_hits;
+                state.solved = this->m_solved_instances.get_val(key);
+                if(state.solved->init_lengths && check_len_sat(state.solved->init_lengths, mod) == l_false) {
+                    block_atoms_len(comp.atoms, state.solved->init_lengths);
+                    return l_false;
+                }
+                for (expr* const lengths : state.solved->solution_lengths) {
+                    add_solution(state, lengths);
+                }
+            } else {
+                state.solved = std::make_shared<SolvedInstance>(m);
+                state.solved->atoms.append(key_atoms);
+                state.dec_proc = std::make_unique<DecisionProcedure>(comp.instance, comp.aut_ass,
+                    comp.length_vars, m, m_util_s, m_util_a,
+                    this->var_eqs.get_equivalence_bt(), m_params);
+                state.dec_proc->set_stats(m_dp_stats);
+                state.dec_proc->preprocess();
+                state.solved->block_with_lengths = state.dec_proc->get_init_length_vars().size() > 0;
+
+                if(this->m_solved_instances.size() >= MAX_SOLVED_INSTANCES) {
+                    this->m_solved_instances.clear();
+                }
+                if(this->m_solved_instances.contains(key)) {
+                    this->m_solved_instances.update_val(key, state.solved);
+                } else {
+                    this->m_solved_instances.add(key, state.solved);
+                }
+
+                if(comp.length_vars.size() > 0) {
+                    // the lemma is added next to the lemmas of other components, so the fresh variables are renamed apart
+                    expr_ref lengths = rename_len_vars_apart(state.dec_proc->get_lengths(this->var_name));
+                    state.solved->init_lengths = lengths;
+                    if(check_len_sat(lengths, mod) == l_false) {
+                        block_atoms_len(comp.atoms, lengths);
+                        return l_false;
+                    }
+                }
+                state.dec_proc->init_computation();
+            }
+        }
+
+        // in each round, the next solution of each component is computed and the instance is length satisfiable if
+        // the length formulas of some solutions of all the components are satisfiable together
+        while(true) {
+            bool all_done = true;
+            bool all_have_solution = true;
+            for (unsigned i = 0; i < states.size(); ++i) {
+                ComponentState& state = states[i];
+                if(state.dec_proc) {
+                    if(state.dec_proc->compute_next_solution()) {
+                        expr_ref lengths = state.dec_proc->get_lengths(this->var_name);
+                        state.solved->solution_lengths.push_back(lengths);
+                        if(get_context().get_fparams().m_model) {
+                            state.solved->solutions.push_back(state.dec_proc->get_solution());
+                        }
+                        add_solution(state, lengths);
+                    } else {
+                        state.solved->complete = true;
+                        state.dec_proc = nullptr;
+                    }
+                }
+                if(state.solved->complete && state.solved->solution_lengths.empty()) {
+                    // the component alone has no solution
+                    STRACE("str", tout << "component without solution: " << components[i].instance.to_string() << std::endl;);
+                    block_atoms_len(components[i].atoms, m.mk_false());
+                    return l_false;
+                }
+                all_done = all_done && !state.dec_proc;
+                all_have_solution = all_have_solution && !state.solved->solution_lengths.empty();
+            }
+
+            if(all_have_solution) {
+                expr_ref_vector comp_lens(m);
+                for (const ComponentState& state : states) {
+                    comp_lens.push_back(state.lengths);
+                }
+                if(check_len_sat(expr_ref(m.mk_and(comp_lens), m), mod) == l_true) {
+                    if(get_context().get_fparams().m_model) {
+                        // the model is built from the remembered solutions of the components
+                        std::map<BasicTerm, Mata::Word> values;
+                        bool has_words = true;
+                        for (unsigned i = 0; i < states.size() && has_words; ++i) {
+                            has_words = get_model_words(*states[i].solved, components[i].instance, components[i].aut_ass, values);
+                        }
+                        if(has_words) {
+                            set_model_values(std::move(values), instance, aut_assignment);
+                        }
+                    }
+                    return l_true;
+                }
+            }
+            if(all_done) {
+                break;
+            }
+        }
+
+        // no combination of the solutions is length satisfiable, the lemmas of the components block the instance together
+        for (unsigned i = 0; i < states.size(); ++i) {
+            if(!m.is_true(states[i].lengths)) {
+                block_atoms_len(components[i].atoms, states[i].lengths);
+            }
+        }
+        return l_false;
+    }
+
+    expr_ref theory_str_noodler::rename_len_vars_apart(expr* len_formula) {
+        // the fresh (integer) variables of the decision procedures are named the same in all instances, so we
+        // rename them apart (each of them then occurs only in one lemma, as if it was existentially quantified);
+        // they are the integer skolem constants created by util::mk_int_var(), the lengths of the string variables
+        // of the theory are str.len terms and are kept
+        expr_safe_replace rename(m);
+        ptr_vector<expr> todo;
+        ast_mark visited;
+        todo.push_back(len_formula);
+        while(!todo.empty()) {
+            expr* e = todo.back();
+            todo.pop_back();
+            if(visited.is_marked(e)) {
+                continue;
+            }
+            visited.mark(e, true);
+            if(m_util_s.is_skolem(e) && to_app(e)->get_num_args() == 0 && m_util_a.is_int(e)) {
+                rename.insert(e, m.mk_fresh_const(to_app(e)->get_decl()->get_name().str(), e->get_sort()));
+            } else if(is_app(e)) {
+                for(expr* arg : *to_app(e)) {
+                    todo.push_back(arg);
+                }
+            }
+        }
+        expr_ref res(len_formula, m);
+        rename(res);
+        return res;
+    }
+
     void theory_str_noodler::block_curr_lang() {
         context& ctx = get_context();
         expr *refinement = nullptr;
@@ -2184,15 +2910,13 @@ namespace smt::noodler {
         int cnt = 0;
 
         for(const auto& item : this->m_lang_eq_todo_rel) {
-            Mata::Nfa::Nfa nfa1 = util::conv_to_nfa(to_app(std::get<0>(item)), m_util_s, m, alphabet, false );
-            Mata::Nfa::Nfa nfa2 = util::conv_to_nfa(to_app(std::get<1>(item)), m_util_s, m, alphabet, false );
             PredicateType tp = std::get<2>(item) ? PredicateType::Equation : PredicateType::Inequation;
 
             BasicTerm t1(BasicTermType::Lang, "__lang__tmp" + std::to_string(cnt++));
             BasicTerm t2(BasicTermType::Lang, "__lang__tmp" + std::to_string(cnt++));
 
-            out[t1] = std::make_shared<Mata::Nfa::Nfa>(nfa1);
-            out[t2] = std::make_shared<Mata::Nfa::Nfa>(nfa2);
+            out[t1] = this->m_aut_cache.get_nfa(to_app(std::get<0>(item)), m_util_s, alphabet);
+            out[t2] = this->m_aut_cache.get_nfa(to_app(std::get<1>(item)), m_util_s, alphabet);
             res.add_predicate(Predicate(tp, {Concat({t1}), Concat({t2})}));
         }
 
@@ -2230,9 +2954,18 @@ namespace smt::noodler {
      * @return lbool Sat
      */
     lbool theory_str_noodler::check_len_sat(expr_ref len_formula, model_ref &mod) {
-        int_expr_solver m_int_solver(get_manager(), get_context().get_fparams());
-        m_int_solver.initialize(get_context());
-        auto ret = m_int_solver.check_sat(len_formula);
-        return ret;
+        scoped_watch _sw(m_len_check_time);
+        ++m_stats.m_len_checks;
+        if(!this->m_len_solver) {
+            this->m_len_solver = alloc(int_expr_solver, get_manager(), get_context().get_fparams());
+        }
+        // the context is asserted into the solver only once per final check
+        if(!this->m_len_solver_ready) {
+            this->m_len_solver->initialize(get_context());
+            this->m_len_solver_ready = true;
+        }
+        lbool res = this->m_len_solver->check_sat(len_formula);
+        this->m_len_solver->get_model(mod);
+        return res;
     }
 }
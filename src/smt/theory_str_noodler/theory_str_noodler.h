@@ -25,6 +25,7 @@ Eternal glory to Yu-Fang.
 #include "smt/smt_arith_value.h"
 #include "util/scoped_vector.h"
 #include "util/union_find.h"
+#include "util/stopwatch.h"
 #include "ast/rewriter/seq_rewriter.h"
 #include "ast/rewriter/th_rewriter.h"
 
@@ -34,6 +35,7 @@ Eternal glory to Yu-Fang.
 #include "inclusion_graph.h"
 #include "decision_procedure.h"
 #include "lang_decision_procedure.h"
+#include "bounded_search.h"
 #include "expr_solver.h"
 #include "util.h"
 #include "var_union_find.h"
@@ -43,6 +45,9 @@ namespace smt::noodler {
     class theory_str_noodler : public theory {
     protected:
 
+        // keeps the names of basic terms interned while the theory exists (declared first, so it is destroyed last)
+        TermNameTable::Scope m_name_scope;
+
         int m_scope_level = 0;
         static bool is_over_approximation;
         const theory_str_noodler_params& m_params;
@@ -91,6 +96,76 @@ namespace smt::noodler {
         vector<expr_pair> m_word_diseq_todo_rel;
         vector<expr_pair_flag> m_lang_eq_todo_rel;
         vector<expr_pair_flag> m_membership_todo_rel;
+        vector<expr_pair> m_not_contains_todo_rel;
+
+        // automata of regexes from membership constraints (shared across final checks)
+        util::RegexAutCache m_aut_cache;
+
+        /**
+         * Results of the decision procedure for an instance (set of string atoms together with its length-sensitive
+         * variables) from some previous final check. If the same instance comes again (e.g., after pop and push),
+         * the length formulas are checked directly, without preprocessing and noodlification.
+         */
+        struct SolvedInstance {
+            // atoms of the instance, kept alive so that the instance (key) cannot refer to deleted expressions
+            expr_ref_vector atoms;
+            // length formula of the preprocessed instance (null if the instance has no length-sensitive variables)
+            expr_ref init_lengths;
+            // length formulas of the solutions of the decision procedure in the order in which they were found
+            expr_ref_vector solution_lengths;
+            // the solutions with the length formulas solution_lengths, kept only if models are generated (the model
+            // is then built from them, see get_model_words())
+            std::vector<SolvingState> solutions;
+            // whether the length formulas of the solutions are used for blocking the instance
+            bool block_with_lengths = false;
+            // whether solution_lengths contains all solutions of the decision procedure
+            bool complete = false;
+            // whether the bounded search (see BoundedWordSearch) did not find any solution of the instance
+            bool bounded_search_failed = false;
+
+            SolvedInstance(ast_manager& m) : atoms(m), init_lengths(m), solution_lengths(m) {}
+        };
+        // maximal number of solved instances that are remembered
+        static constexpr size_t MAX_SOLVED_INSTANCES = 1024;
+        StateLen<std::shared_ptr<SolvedInstance>> m_solved_instances;
+
+        /**
+         * Connected component of the current instance, i.e., atoms (transitively) sharing string variables together
+         * with the part of the instance they induce.
+         */
+        struct InstanceComponent {
+            expr_ref_vector atoms;
+            Formula instance;
+            AutAssignment aut_ass;
+            std::unordered_set<BasicTerm> length_vars;
+
+            InstanceComponent(ast_manager& m) : atoms(m) {}
+        };
+
+        // length solver kept alive across noodles and final checks (created lazily)
+        scoped_ptr<int_expr_solver> m_len_solver;
+        // was m_len_solver synchronized with the context in the current final check?
+        bool m_len_solver_ready = false;
+
+        struct stats {
+            unsigned m_final_checks = 0;
+            unsigned m_solved_instance_hits = 0;
+            unsigned m_bounded_search_sat = 0;
+            unsigned m_underapprox_sat = 0;
+            unsigned m_len_checks = 0;
+            unsigned m_split_instances = 0;
+        };
+        stats m_stats;
+        stopwatch m_final_check_time;
+        stopwatch m_len_check_time;
+        // statistics shared by all the decision procedures created by the theory
+        std::shared_ptr<DecisionProcedureStats> m_dp_stats = std::make_shared<DecisionProcedureStats>();
+
+        // words of the string variables of the last satisfiable instance, used by mk_value() (empty if the words
+        // are not known, e.g., if they do not agree with the arithmetic model)
+        std::map<BasicTerm, Mata::Word> m_model_values;
+        // string literals created by mk_value(), kept alive until the next model
+        expr_ref_vector m_model_literals;
 
     public:
         char const * get_name() const override { return "noodler"; }
@@ -116,6 +191,7 @@ namespace smt::noodler {
         model_value_proc *mk_value(enode *n, model_generator& mg) override;
         void init_model(model_generator& m) override;
         void finalize_model(model_generator& mg) override;
+        void collect_statistics(::statistics& st) const override;
         lbool validate_unsat_core(expr_ref_vector& unsat_core) override;
 
         void add_length_axiom(expr* n);
@@ -168,6 +244,85 @@ namespace smt::noodler {
         bool is_variable(const expr* expression) const;
 
         lbool solve_underapprox(const Formula& instance, const AutAssignment& aut_ass, const std::unordered_set<BasicTerm>& init_length_sensitive_vars);
+        lbool solve_bounded(const Formula& instance, const AutAssignment& aut_ass, const std::unordered_set<BasicTerm>& init_length_sensitive_vars);
+
+        /**
+         * Remember the words of the variables of the current solution of @p dec_proc with the length formula
+         * @p lengths as the model of the string variables (see set_model_values()). The lengths of the words are
+         * taken from a model of @p lengths that agrees with the lengths in the arithmetic model of the context.
+         */
+        void store_model(DecisionProcedure& dec_proc, const expr_ref& lengths, const Formula& instance, const AutAssignment& aut_ass);
+        /**
+         * Get the words @p values of the variables of the solution @p solution of a decision procedure with the
+         * length formula @p lengths whose lengths agree with the arithmetic model of the context.
+         * @return False if there are no such words
+         */
+        bool get_model_words(const SolvingState& solution, const expr_ref& lengths, std::map<BasicTerm, Mata::Word>& values);
+        /**
+         * Get the words of the string variables of @p instance with the automata @p aut_ass (added to @p values) for
+         * the model when the instance was decided without its decision procedure (see check_solved_instance() and
+         * solve_components()). The words are taken from the first solution remembered in @p solved whose words agree
+         * with the arithmetic model of the context, the instance is not solved again.
+         * @return False if there is no such solution
+         */
+        bool get_model_words(const SolvedInstance& solved, const Formula& instance, const AutAssignment& aut_ass,
+                             std::map<BasicTerm, Mata::Word>& values);
+        /**
+         * Remember the words @p values of the variables of a solution of @p instance as the model of the string
+         * variables. The variables eliminated by the preprocessing get words from the equations of @p instance.
+         * The words are then checked against all string constraints of the final check (and the lengths in the
+         * arithmetic model of the context); if they are not a solution, no model is remembered.
+         */
+        void set_model_values(std::map<BasicTerm, Mata::Word> values, const Formula& instance, const AutAssignment& aut_ass);
+        /**
+         * Get the word of the string term @p e (concatenation of literals and variables) from m_model_values.
+         * @return False if the word of some variable of @p e is not known
+         */
+        bool get_model_value(expr* e, Mata::Word& value);
+
+        /**
+         * Collect the atoms of the current instance (relevant string atoms and the length-sensitive variables
+         * @p init_length_sensitive_vars) into @p atoms.
+         * @return The atoms as a key for m_solved_instances
+         */
+        Instance get_instance_atoms(const std::unordered_set<BasicTerm>& init_length_sensitive_vars, expr_ref_vector& atoms);
+        /**
+         * Add the length terms of @p length_sensitive_vars to @p atoms of some instance.
+         * @return The atoms as a key for m_solved_instances
+         */
+        Instance mk_instance_key(const std::unordered_set<BasicTerm>& length_sensitive_vars, expr_ref_vector& atoms);
+
+        /**
+         * Split the current instance into connected components (see FormulaPreprocess::split_components()).
+         */
+        std::vector<InstanceComponent> get_instance_components(const AutAssignment& aut_assignment,
+                                                               const std::unordered_set<BasicTerm>& init_length_sensitive_vars);
+        /**
+         * Solve the current instance consisting of several variable-disjoint @p components. Each component is solved
+         * by its own decision procedure (or by the results remembered for it in m_solved_instances). The solutions
+         * of the components are computed in rounds, and the length formula of the instance is the conjunction of the
+         * disjunctions of the length formulas of the solutions found so far for each component, so the cross product
+         * of the solutions is never enumerated.
+         *
+         * The model of the string variables is built from the components of @p instance with the automata
+         * @p aut_ass (see set_model_values()).
+         *
+         * @return l_true if some combination of solutions is length satisfiable, l_false otherwise (then the instance
+         *  is blocked by lemmas over the atoms of the components)
+         */
+        lbool solve_components(std::vector<InstanceComponent>& components, const Formula& instance, const AutAssignment& aut_ass);
+        /**
+         * Rename the fresh integer variables of the decision procedures (integer skolem constants, see
+         * util::mk_int_var()) in the length formula @p len_formula to fresh constants.
+         */
+        expr_ref rename_len_vars_apart(expr* len_formula);
+
+        /**
+         * Decide the current instance using the results @p solved from a previous final check.
+         * @return l_true/l_false if some solution is length satisfiable/all solutions are not (and the instance is
+         *  blocked), l_undef if the instance needs to be solved again by the decision procedure
+         */
+        lbool check_solved_instance(const SolvedInstance& solved);
 
         expr_ref mk_sub(expr *a, expr *b);
         zstring print_word_term(expr * a) const;
@@ -190,10 +345,30 @@ namespace smt::noodler {
         void handle_not_suffix(expr *e);
         void handle_contains(expr *e);
         void handle_not_contains(expr *e);
+        /**
+         * Express not(contains(x, y)) by a regular constraint x notin Σ*·L(y)·Σ* in the automata assignment
+         * @p aut_ass. The constraint is exact only if x is a variable and y has a single possible value (given by
+         * its literals and the automata of its variables), otherwise nothing is added.
+         *
+         * @return True if the constraint was expressed exactly, false if it was dropped (overapproximated)
+         */
+        bool add_not_contains_constr(expr* x, expr* y, AutAssignment& aut_ass);
+        /**
+         * Express the not(contains) predicates of the current instance by regular constraints in @p aut_ass (see
+         * add_not_contains_constr()).
+         *
+         * @return FC_DONE if all the constraints are exact, FC_GIVEUP if some were dropped (then a solution of the
+         *  instance does not have to satisfy the not(contains) predicates)
+         */
+        final_check_status add_not_contains_constrs(AutAssignment& aut_ass);
         void handle_in_re(expr *e, bool is_true);
         void set_conflict(const literal_vector& ls);
         void block_curr_assignment();
         void block_curr_len(expr_ref len_formula);
+        /**
+         * Block the conjunction of @p atoms unless @p len_formula holds.
+         */
+        void block_atoms_len(const expr_ref_vector& atoms, expr* len_formula);
         void block_curr_lang();
         void dump_assignments() const;
         void string_theory_propagation(expr * ex);
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <mata/re2parser.hh>
 
@@ -9,6 +10,7 @@
 
 namespace {
     using Mata::Nfa::Nfa;
+    using Mata::Nfa::State;
 }
 
 namespace smt::noodler::util {
@@ -23,7 +25,8 @@ namespace smt::noodler::util {
 #endif
     }
 
-    void extract_symbols(expr* const ex, const seq_util& m_util_s, const ast_manager& m, std::set<uint32_t>& alphabet) {
+    void extract_symbols(expr* const ex, const seq_util& m_util_s, const ast_manager& m, std::set<uint32_t>& alphabet,
+                         SymbolClasses* classes) {
         if (m_util_s.str.is_string(ex)) {
             auto ex_app{ to_app(ex) };
             SASSERT(ex_app->get_num_parameters() == 1);
@@ -48,14 +51,14 @@ namespace smt::noodler::util {
             if (!m_util_s.str.is_string(arg)) { // if to_re has something other than string literal
                 throw_error("we support only string literals in str.to_re");
             }
-            extract_symbols(to_app(arg), m_util_s, m, alphabet);
+            extract_symbols(to_app(arg), m_util_s, m, alphabet, classes);
             return;
         } else if (m_util_s.re.is_concat(ex_app) // Handle regex concatenation.
                 || m_util_s.str.is_concat(ex_app) // Handle string concatenation.
                 || m_util_s.re.is_intersection(ex_app) // Handle intersection.
             ) {
             for (unsigned int i = 0; i < ex_app->get_num_args(); ++i) {
-                extract_symbols(to_app(ex_app->get_arg(i)), m_util_s, m, alphabet);
+                extract_symbols(to_app(ex_app->get_arg(i)), m_util_s, m, alphabet, classes);
             }
             return;
         } else if (m_util_s.re.is_antimirov_union(ex_app)) { // Handle Antimirov union.
@@ -64,7 +67,7 @@ namespace smt::noodler::util {
             SASSERT(ex_app->get_num_args() == 1);
             const auto child{ ex_app->get_arg(0) };
             SASSERT(is_app(child));
-            extract_symbols(to_app(child), m_util_s, m, alphabet);
+            extract_symbols(to_app(child), m_util_s, m, alphabet, classes);
             return;
         } else if (m_util_s.re.is_derivative(ex_app)) { // Handle derivative.
             throw_error("derivative is unsupported");
@@ -93,7 +96,7 @@ namespace smt::noodler::util {
             SASSERT(ex_app->get_num_args() == 1);
             const auto child{ ex_app->get_arg(0) };
             SASSERT(is_app(child));
-            extract_symbols(to_app(child), m_util_s, m, alphabet);
+            extract_symbols(to_app(child), m_util_s, m, alphabet, classes);
             return;
         } else if (m_util_s.re.is_range(ex_app)) { // Handle range.
             SASSERT(ex_app->get_num_args() == 2);
@@ -104,6 +107,10 @@ namespace smt::noodler::util {
             const auto range_begin_value{ to_app(range_begin)->get_parameter(0).get_zstring()[0] };
             const auto range_end_value{ to_app(range_end)->get_parameter(0).get_zstring()[0] };
 
+            if (classes != nullptr) {
+                classes->add_range(range_begin_value, range_end_value);
+                return;
+            }
             auto current_value{ range_begin_value };
             while (current_value <= range_end_value) {
                 alphabet.insert(current_value);
@@ -117,8 +124,8 @@ namespace smt::noodler::util {
             const auto right{ ex_app->get_arg(1) };
             SASSERT(is_app(left));
             SASSERT(is_app(right));
-            extract_symbols(to_app(left), m_util_s, m, alphabet);
-            extract_symbols(to_app(right), m_util_s, m, alphabet);
+            extract_symbols(to_app(left), m_util_s, m, alphabet, classes);
+            extract_symbols(to_app(right), m_util_s, m, alphabet, classes);
             return;
         } else if(is_variable(ex_app, m_util_s)) { // Handle variable.
             throw_error("variable should not occur here");
@@ -128,7 +135,7 @@ namespace smt::noodler::util {
             for(unsigned i = 0; i < ex_app->get_num_args(); i++) {
                 SASSERT(is_app(ex_app->get_arg(i)));
                 app *arg = to_app(ex_app->get_arg(i));
-                extract_symbols(arg, m_util_s, m, alphabet);
+                extract_symbols(arg, m_util_s, m, alphabet, classes);
             }
         }
     }
@@ -198,12 +205,62 @@ namespace smt::noodler::util {
         return false;
     }
 
-    std::set<uint32_t> get_dummy_symbols(size_t new_symb_num, std::set<uint32_t>& symbols_to_append_to) {
+    std::set<uint32_t> SymbolClasses::get_alphabet(const std::set<uint32_t>& symbols, size_t num_representatives) const {
+        std::set<uint32_t> alphabet{ symbols };
+        if (this->ranges.empty()) {
+            return alphabet;
+        }
+
+        // the symbols between two consecutive bounds are in the same ranges and none of them is from a string literal
+        std::set<uint64_t> bounds;
+        for (const auto& [begin, end] : this->ranges) {
+            bounds.insert(begin);
+            bounds.insert(uint64_t(end) + 1);
+        }
+        for (const uint32_t symbol : symbols) {
+            bounds.insert(symbol);
+            bounds.insert(uint64_t(symbol) + 1);
+        }
+
+        // signature of a class are the indices of the ranges containing it
+        std::map<std::vector<size_t>, size_t> signature_to_num_representatives;
+        for (auto it = bounds.begin(); std::next(it) != bounds.end(); ++it) {
+            const uint32_t first = static_cast<uint32_t>(*it);
+            if (symbols.count(first) > 0) {
+                continue;
+            }
+            std::vector<size_t> signature;
+            for (size_t i = 0; i < this->ranges.size(); ++i) {
+                if (this->ranges[i].first <= first && first <= this->ranges[i].second) {
+                    signature.push_back(i);
+                }
+            }
+            if (signature.empty()) {
+                continue;
+            }
+            // the class can consist of several intervals, take its smallest symbols
+            size_t& num_taken = signature_to_num_representatives[signature];
+            for (uint64_t symbol = first; symbol < *std::next(it) && num_taken < num_representatives; ++symbol) {
+                alphabet.insert(static_cast<uint32_t>(symbol));
+                ++num_taken;
+            }
+        }
+        return alphabet;
+    }
+
+    bool SymbolClasses::is_covered(uint32_t symbol) const {
+        return std::any_of(this->ranges.begin(), this->ranges.end(), [symbol](const std::pair<uint32_t, uint32_t>& range) {
+            return range.first <= symbol && symbol <= range.second;
+        });
+    }
+
+    std::set<uint32_t> get_dummy_symbols(size_t new_symb_num, std::set<uint32_t>& symbols_to_append_to, const SymbolClasses* classes) {
         std::set<uint32_t> dummy_symbols{};
         uint32_t dummy_symbol{ 0 };
         const size_t disequations_number{ new_symb_num };
         for (size_t diseq_index{ 0 }; diseq_index < disequations_number; ++diseq_index) {
-            while (symbols_to_append_to.find(dummy_symbol) != symbols_to_append_to.end()) { ++dummy_symbol; }
+            while (symbols_to_append_to.find(dummy_symbol) != symbols_to_append_to.end()
+                   || (classes != nullptr && classes->is_covered(dummy_symbol))) { ++dummy_symbol; }
             dummy_symbols.insert(dummy_symbol);
             ++dummy_symbol;
         }
@@ -221,26 +278,27 @@ namespace smt::noodler::util {
             const vector<expr_pair_flag>& regexes,
             const vector<expr_pair_flag>& lang_regexes,
             const seq_util& m_util_s,
-            const ast_manager& m
+            const ast_manager& m,
+            SymbolClasses* classes
     ) {
         std::set<uint32_t> symbols_in_formula{};
         for (const auto &word_equation: equations) {
-            util::extract_symbols(word_equation.first, m_util_s, m, symbols_in_formula);
-            util::extract_symbols(word_equation.second, m_util_s, m, symbols_in_formula);
+            util::extract_symbols(word_equation.first, m_util_s, m, symbols_in_formula, classes);
+            util::extract_symbols(word_equation.second, m_util_s, m, symbols_in_formula, classes);
         }
 
         for (const auto &word_equation: disequations) {
-            util::extract_symbols(word_equation.first, m_util_s, m, symbols_in_formula);
-            util::extract_symbols(word_equation.second, m_util_s, m, symbols_in_formula);
+            util::extract_symbols(word_equation.first, m_util_s, m, symbols_in_formula, classes);
+            util::extract_symbols(word_equation.second, m_util_s, m, symbols_in_formula, classes);
         }
 
         for (const auto &word_equation: regexes) {
-            util::extract_symbols(std::get<1>(word_equation), m_util_s, m, symbols_in_formula);
+            util::extract_symbols(std::get<1>(word_equation), m_util_s, m, symbols_in_formula, classes);
         }
 
         for (const auto &lang_eq: lang_regexes) {
-            util::extract_symbols(std::get<0>(lang_eq), m_util_s, m, symbols_in_formula);
-            util::extract_symbols(std::get<1>(lang_eq), m_util_s, m, symbols_in_formula);
+            util::extract_symbols(std::get<0>(lang_eq), m_util_s, m, symbols_in_formula, classes);
+            util::extract_symbols(std::get<1>(lang_eq), m_util_s, m, symbols_in_formula, classes);
         }
         return symbols_in_formula;
     }
@@ -251,7 +309,8 @@ namespace smt::noodler::util {
             std::map<BasicTerm, expr_ref>& var_name,
             const seq_util& m_util_s,
             const ast_manager& m,
-            const std::set<uint32_t>& noodler_alphabet
+            const std::set<uint32_t>& noodler_alphabet,
+            RegexAutCache* aut_cache
     ) {
         // Find all variables in the whole formula.
         std::unordered_set<BasicTerm> variables_in_formula{};
@@ -275,15 +334,21 @@ namespace smt::noodler::util {
             const BasicTerm variable_term{ BasicTermType::Variable, variable_name };
             // If the regular constraint is in a negative form, create a complement of the regular expression instead.
             const bool make_complement{ !std::get<2>(word_equation) };
-            Nfa nfa{ conv_to_nfa(to_app(std::get<1>(word_equation)), m_util_s, m, noodler_alphabet, make_complement) };
+            std::shared_ptr<Nfa> nfa;
+            if (aut_cache != nullptr) {
+                nfa = aut_cache->get_nfa(to_app(std::get<1>(word_equation)), m_util_s, noodler_alphabet, make_complement);
+            } else {
+                nfa = std::make_shared<Nfa>(conv_to_nfa(to_app(std::get<1>(word_equation)), m_util_s, m, noodler_alphabet, make_complement));
+            }
             auto aut_ass_it{ aut_assignment.find(variable_term) };
             if (aut_ass_it != aut_assignment.end()) {
                 // This variable already has some regular constraints. Hence, we create an intersection of the new one
                 //  with the previously existing.
                 aut_ass_it->second = std::make_shared<Nfa>(
-                        Mata::Nfa::intersection(nfa, *aut_ass_it->second));
+                        Mata::Nfa::intersection(*nfa, *aut_ass_it->second));
             } else { // We create a regular constraint for the current variable for the first time.
-                aut_assignment[variable_term] = std::make_shared<Nfa>(std::forward<Nfa>(std::move(nfa)));
+                // automata in the assignment are shared (e.g., with the cache), they are never modified in place
+                aut_assignment[variable_term] = nfa;
                 var_name.insert({variable_term, variable});
             }
         }
@@ -550,10 +615,9 @@ namespace smt::noodler::util {
 
             nfa.initial.add(0);
             nfa.final.add(1);
-            auto current_value{ range_begin_value };
-            while (current_value <= range_end_value) {
-                nfa.delta.add(0, current_value, 1);
-                ++current_value;
+            // the alphabet contains the representatives of the symbols of the range (see SymbolClasses)
+            for (auto it = alphabet.lower_bound(range_begin_value); it != alphabet.end() && *it <= range_end_value; ++it) {
+                nfa.delta.add(0, *it, 1);
             }
         } else if (m_util_s.re.is_reverse(expression)) { // Handle reverse.
             throw_error("reverse is unsupported");
@@ -617,6 +681,43 @@ namespace smt::noodler::util {
         return nfa;
     }
 
+    std::shared_ptr<Nfa> RegexAutCache::get_nfa(const app *expression, const seq_util& m_util_s,
+                                                 const std::set<uint32_t>& alphabet, bool make_complement) {
+        auto entry_it = std::find_if(this->entries.begin(), this->entries.end(),
+                                     [&alphabet](const AlphabetEntry& entry) { return entry.alphabet == alphabet; });
+        if (entry_it == this->entries.end()) {
+            if (this->entries.size() >= MAX_ALPHABETS) {
+                this->entries.pop_back();
+            }
+            this->entries.emplace_front(this->m, alphabet);
+        } else if (entry_it != this->entries.begin()) {
+            this->entries.splice(this->entries.begin(), this->entries, entry_it);
+        }
+        AlphabetEntry& entry = this->entries.front();
+
+        auto& cached = entry.automata[make_complement ? 1 : 0];
+        std::shared_ptr<Nfa> nfa;
+        if (cached.find(const_cast<app*>(expression), nfa)) {
+            return nfa;
+        }
+        nfa = std::make_shared<Nfa>(Mata::Nfa::reduce(conv_to_nfa(expression, m_util_s, this->m, alphabet, make_complement)));
+        entry.pinned.push_back(const_cast<app*>(expression));
+        cached.insert(const_cast<app*>(expression), nfa);
+        return nfa;
+    }
+
+    void RegexAutCache::reset() {
+        this->entries.clear();
+    }
+
+    unsigned RegexAutCache::size() const {
+        unsigned res = 0;
+        for (const AlphabetEntry& entry : this->entries) {
+            res += entry.automata[0].size() + entry.automata[1].size();
+        }
+        return res;
+    }
+
     Nfa create_word_nfa(const zstring& word) {
         const size_t word_length{ word.length() };
         Mata::OnTheFlyAlphabet* mata_alphabet{ new Mata::OnTheFlyAlphabet{} };
@@ -633,6 +734,93 @@ namespace smt::noodler::util {
         return nfa;
     }
 
+    bool get_word_of_length(const Nfa& nfa, size_t length, Mata::Word& word) {
+        // layers[i] maps the states reachable by words of length i to their predecessor and the symbol read
+        std::vector<std::unordered_map<State, std::pair<State, Mata::Symbol>>> layers(1);
+        for (State state : nfa.initial) {
+            layers[0].emplace(state, std::make_pair(state, Mata::Symbol{}));
+        }
+        for (size_t i{ 0 }; i < length && !layers.back().empty(); ++i) {
+            std::unordered_map<State, std::pair<State, Mata::Symbol>> next;
+            for (const auto& [state, pred] : layers.back()) {
+                for (const auto& move : nfa.delta[state]) {
+                    for (State target : move.targets) {
+                        next.emplace(target, std::make_pair(state, move.symbol));
+                    }
+                }
+            }
+            layers.push_back(std::move(next));
+        }
+        if (layers.size() != length + 1) {
+            return false;
+        }
+
+        for (const auto& [state, pred] : layers.back()) {
+            if (!nfa.final[state]) {
+                continue;
+            }
+            word.assign(length, Mata::Symbol{});
+            State current{ state };
+            for (size_t i{ length }; i > 0; --i) {
+                const auto& [prev, symbol] = layers[i].at(current);
+                word[i - 1] = symbol;
+                current = prev;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    bool get_shortest_word(const Nfa& nfa, Mata::Word& word) {
+        // predecessor of each visited state and the symbol read
+        std::unordered_map<State, std::pair<State, Mata::Symbol>> visited;
+        std::queue<State> queue;
+        for (State state : nfa.initial) {
+            if (visited.emplace(state, std::make_pair(state, Mata::Symbol{})).second) {
+                queue.push(state);
+            }
+        }
+        while (!queue.empty()) {
+            State state{ queue.front() };
+            queue.pop();
+            if (nfa.final[state]) {
+                word.clear();
+                // only the initial states are their own predecessors
+                for (State current{ state }; visited.at(current).first != current; ) {
+                    const auto& [prev, symbol] = visited.at(current);
+                    word.push_back(symbol);
+                    current = prev;
+                }
+                std::reverse(word.begin(), word.end());
+                return true;
+            }
+            for (const auto& move : nfa.delta[state]) {
+                for (State target : move.targets) {
+                    if (visited.emplace(target, std::make_pair(state, move.symbol)).second) {
+                        queue.push(target);
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    bool is_word_accepted(const Nfa& nfa, const Mata::Word& word) {
+        std::set<State> current(nfa.initial.begin(), nfa.initial.end());
+        for (Mata::Symbol symbol : word) {
+            std::set<State> next;
+            for (State state : current) {
+                for (const auto& move : nfa.delta[state]) {
+                    if (move.symbol == symbol) {
+                        next.insert(move.targets.begin(), move.targets.end());
+                    }
+                }
+            }
+            current = std::move(next);
+        }
+        return std::any_of(current.begin(), current.end(), [&nfa](State state) { return nfa.final[state]; });
+    }
+
     void collect_terms(app* const ex, ast_manager& m, const seq_util& m_util_s, obj_map<expr, expr*>& pred_replace,
                        std::map<BasicTerm, expr_ref>& var_name, std::vector<BasicTerm>& terms) {
 
@@ -76,23 +76,65 @@ namespace smt::noodler::util {
      */
     void get_variable_names(expr* ex, const seq_util& m_util_s, const ast_manager& m, std::unordered_set<std::string>& res);
 
+    /**
+     * @brief Classes of the symbols from ranges of regexes that a formula cannot distinguish (minterms).
+     *
+     * Ranges (e.g., [a-z] or the ranges of Unicode characters) would make the alphabet of the automata huge. Instead,
+     * symbols that are in the same ranges and that do not occur in string literals (which have their own classes) form
+     * one class, represented by its smallest symbols. The automata are built over the representatives only, so that
+     * range [a, b] is the union of the classes whose representatives are in [a, b]. As each representative is a
+     * member of its class, the words of the automata are also words of the original languages (no translation is
+     * needed when models are generated).
+     *
+     * One representative is not enough when the formula can require distinct symbols of a class: x != y with
+     * x, y in [a-z] is satisfiable, but not over the alphabet {a}. Each disequation, negated membership or language
+     * equation and not(contains) can require a symbol different from the others, hence the classes are represented
+     * by as many symbols as there are such constraints, plus one.
+     */
+    class SymbolClasses {
+    public:
+        void add_range(uint32_t begin, uint32_t end) { this->ranges.emplace_back(begin, end); }
+
+        /**
+         * Get the alphabet consisting of the symbols @p symbols (from string literals) and of the representatives of
+         * the classes of the symbols in the ranges.
+         *
+         * @param num_representatives Number of the smallest symbols of each class that represent it (all symbols of
+         *  smaller classes are taken).
+         */
+        std::set<uint32_t> get_alphabet(const std::set<uint32_t>& symbols, size_t num_representatives = 1) const;
+
+        /**
+         * Check whether @p symbol is in some range (i.e., it is in some class).
+         */
+        bool is_covered(uint32_t symbol) const;
+
+    private:
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    };
+
     /**
      * Extract symbols from a given expression @p ex. Append to the output parameter @p alphabet.
      * @param[in] ex Expression to be checked for symbols.
      * @param[in] m_util_s Seq util for AST.
      * @param[in] m AST manager.
      * @param[out] alphabet A set of symbols with where found symbols are appended to.
+     * @param[out] classes If not nullptr, ranges are added to @p classes instead of adding all their symbols to
+     *  @p alphabet.
      */
-    void extract_symbols(expr * ex, const seq_util& m_util_s, const ast_manager& m, std::set<uint32_t>& alphabet);
+    void extract_symbols(expr * ex, const seq_util& m_util_s, const ast_manager& m, std::set<uint32_t>& alphabet,
+                         SymbolClasses* classes = nullptr);
 
     /**
      * Get dummy symbols.
      *
      * @param[in] new_symb_num Number of added symbols.
      * @param[out] symbols_to_append_to Set of symbols where dummy symbols are appended to.
+     * @param[in] classes If not nullptr, dummy symbols are not taken from the classes of symbols.
      * @return Set of dummy symbols.
      */
-    std::set<uint32_t> get_dummy_symbols(size_t new_symb_num, std::set<uint32_t>& symbols_to_append_to);
+    std::set<uint32_t> get_dummy_symbols(size_t new_symb_num, std::set<uint32_t>& symbols_to_append_to,
+                                         const SymbolClasses* classes = nullptr);
 
     /**
      * Get symbols for formula.
@@ -101,6 +143,7 @@ namespace smt::noodler::util {
      * @param[in] regexes Vector of regexes in formula to get symbols from.
      * @param[in] m_util_s Seq util for AST.
      * @param[in] m AST manager.
+     * @param[out] classes If not nullptr, ranges are collected in @p classes (see extract_symbols()).
      * @return Set of symbols in the whole formula.
      *
      * TODO: Test.
@@ -111,9 +154,56 @@ namespace smt::noodler::util {
             const vector<expr_pair_flag>& regexes,
             const vector<expr_pair_flag>& lang_regexes,
             const seq_util& m_util_s,
-            const ast_manager& m
+            const ast_manager& m,
+            SymbolClasses* classes = nullptr
     );
 
+    /**
+     * @brief Cache of automata built from regexes by conv_to_nfa().
+     *
+     * Automata are keyed by the alphabet, by the (hash-consed) regex expression and by the complement flag, so that
+     * repeated membership constraints (also across final checks) share one reduced automaton. The alphabet of a final
+     * check depends on the number of negated constraints (see SymbolClasses::get_alphabet()), so the automata of the
+     * last MAX_ALPHABETS alphabets are kept; the automata of the least recently used alphabet are dropped when
+     * another alphabet is requested.
+     */
+    class RegexAutCache {
+    public:
+        // maximal number of alphabets whose automata are cached
+        static constexpr size_t MAX_ALPHABETS = 8;
+
+    private:
+        // automata over one alphabet
+        struct AlphabetEntry {
+            std::set<uint32_t> alphabet;
+            // keeps the cached regexes alive
+            expr_ref_vector pinned;
+            // automata of the regexes (index 0) and of their complements (index 1)
+            obj_map<expr, std::shared_ptr<Mata::Nfa::Nfa>> automata[2];
+
+            AlphabetEntry(ast_manager& m, const std::set<uint32_t>& alphabet) : alphabet(alphabet), pinned(m) { }
+        };
+
+        ast_manager& m;
+        // entries in the order of their last use (the most recently used first)
+        std::list<AlphabetEntry> entries;
+
+    public:
+        RegexAutCache(ast_manager& m) : m(m) { }
+
+        /**
+         * Get the (reduced) NFA of the regex @p expression, see conv_to_nfa() for the parameters.
+         */
+        std::shared_ptr<Mata::Nfa::Nfa> get_nfa(const app *expression, const seq_util& m_util_s,
+                                                const std::set<uint32_t>& alphabet, bool make_complement = false);
+
+        void reset();
+        /**
+         * Get the number of cached automata (over all alphabets).
+         */
+        unsigned size() const;
+    };
+
     /**
      * Get automata assignment for formula.
      * @param[in] equations Vector of equations in formula to get symbols from.
@@ -122,6 +212,8 @@ namespace smt::noodler::util {
      * @param[in] regexes Vector of regexes in formula to get symbols from.
      * @param[in] m_util_s Seq util for AST.
      * @param[in] m AST manager.
+     * @param[in] alphabet Alphabet of the formula.
+     * @param[in] aut_cache Cache of regex automata to be used (if not nullptr).
      * @return Automata assignment for the whole formula.
      *
      * TODO: Test.
@@ -132,7 +224,8 @@ namespace smt::noodler::util {
             std::map<BasicTerm, expr_ref>& var_name,
             const seq_util& m_util_s,
             const ast_manager& m,
-            const std::set<uint32_t>& alphabet
+            const std::set<uint32_t>& alphabet,
+            RegexAutCache* aut_cache = nullptr
     );
 
     /**
@@ -165,6 +258,26 @@ namespace smt::noodler::util {
      */
     Mata::Nfa::Nfa create_word_nfa(const zstring& word);
 
+    /**
+     * Get some word of length @p length accepted by @p nfa. The states reachable by words of length 0, 1, ...,
+     * @p length are computed layer by layer, so the time is linear in @p length (times the size of @p nfa).
+     * @param[out] word The found word.
+     * @return False if @p nfa accepts no word of length @p length.
+     */
+    bool get_word_of_length(const Mata::Nfa::Nfa& nfa, size_t length, Mata::Word& word);
+
+    /**
+     * Get some shortest word accepted by @p nfa (found by a breadth-first search).
+     * @param[out] word The found word.
+     * @return False if the language of @p nfa is empty.
+     */
+    bool get_shortest_word(const Mata::Nfa::Nfa& nfa, Mata::Word& word);
+
+    /**
+     * Check whether @p nfa accepts @p word.
+     */
+    bool is_word_accepted(const Mata::Nfa::Nfa& nfa, const Mata::Word& word);
+
     /**
      * Collect basic terms (vars, literals) from a concatenation @p ex. Append the basic terms to the output parameter
      *  @p terms.
@@ -248,9 +361,16 @@ namespace smt::noodler::util {
      * @param m ast manager
      * @param m_util_s string ast util
      * @param m_util_a arith ast util
+     * @param manager manager of @p node keeping the translations of nodes (if null, nodes are always translated)
      * @return expr_ref
      */
-    static expr_ref len_to_expr(const LenNode * node, const std::map<BasicTerm, expr_ref>& variable_map, ast_manager &m, seq_util& m_util_s, arith_util& m_util_a) {
+    static expr_ref len_to_expr(const LenNode * node, const std::map<BasicTerm, expr_ref>& variable_map, ast_manager &m, seq_util& m_util_s, arith_util& m_util_a, LenNodeManager* manager = nullptr);
+
+    /**
+     * @brief Convert the top node of length formula @p node to z3 length formula (the successors are converted by
+     * len_to_expr()).
+     */
+    static expr_ref len_node_to_expr(const LenNode * node, const std::map<BasicTerm, expr_ref>& variable_map, ast_manager &m, seq_util& m_util_s, arith_util& m_util_a, LenNodeManager* manager) {
         switch(node->type) {
         case LenFormulaType::LEAF:
             if(node->atom_val.get_type() == BasicTermType::Length)
@@ -268,39 +388,39 @@ namespace smt::noodler::util {
 
         case LenFormulaType::PLUS: {
             assert(node->succ.size() >= 2);
-            expr_ref plus = len_to_expr(node->succ[0], variable_map, m, m_util_s, m_util_a);
+            expr_ref plus = len_to_expr(node->succ[0], variable_map, m, m_util_s, m_util_a, manager);
             for(size_t i = 1; i < node->succ.size(); i++) {
-                plus = m_util_a.mk_add(plus, len_to_expr(node->succ[i], variable_map, m, m_util_s, m_util_a));
+                plus = m_util_a.mk_add(plus, len_to_expr(node->succ[i], variable_map, m, m_util_s, m_util_a, manager));
             }
             return plus;
         }
 
         case LenFormulaType::EQ: {
             assert(node->succ.size() == 2);
-            expr_ref left = len_to_expr(node->succ[0], variable_map, m, m_util_s, m_util_a);
-            expr_ref right = len_to_expr(node->succ[1], variable_map, m, m_util_s, m_util_a);
+            expr_ref left = len_to_expr(node->succ[0], variable_map, m, m_util_s, m_util_a, manager);
+            expr_ref right = len_to_expr(node->succ[1], variable_map, m, m_util_s, m_util_a, manager);
             return expr_ref(m_util_a.mk_eq(left, right), m);
         }
 
         case LenFormulaType::LEQ: {
             assert(node->succ.size() == 2);
-            expr_ref left = len_to_expr(node->succ[0], variable_map, m, m_util_s, m_util_a);
-            expr_ref right = len_to_expr(node->succ[1], variable_map, m, m_util_s, m_util_a);
+            expr_ref left = len_to_expr(node->succ[0], variable_map, m, m_util_s, m_util_a, manager);
+            expr_ref right = len_to_expr(node->succ[1], variable_map, m, m_util_s, m_util_a, manager);
             return expr_ref(m_util_a.mk_le(left, right), m);
         }
 
         case LenFormulaType::NOT: {
             assert(node->succ.size() == 1);
-            expr_ref left = len_to_expr(node->succ[0], variable_map, m, m_util_s, m_util_a);
+            expr_ref left = len_to_expr(node->succ[0], variable_map, m, m_util_s, m_util_a, manager);
             return expr_ref(m.mk_not(left), m);
         }
 
         case LenFormulaType::AND: {
             if(node->succ.size() == 0)
                 return expr_ref(m.mk_true(), m);
-            expr_ref andref = len_to_expr(node->succ[0], variable_map, m, m_util_s, m_util_a);
+            expr_ref andref = len_to_expr(node->succ[0], variable_map, m, m_util_s, m_util_a, manager);
             for(size_t i = 1; i < node->succ.size(); i++) {
-                andref = m.mk_and(andref, len_to_expr(node->succ[i], variable_map, m, m_util_s, m_util_a));
+                andref = m.mk_and(andref, len_to_expr(node->succ[i], variable_map, m, m_util_s, m_util_a, manager));
             }
             return andref;
         }
@@ -318,6 +438,19 @@ namespace smt::noodler::util {
         assert(false);
         return {{}, m};
     }
+
+    static expr_ref len_to_expr(const LenNode * node, const std::map<BasicTerm, expr_ref>& variable_map, ast_manager &m, seq_util& m_util_s, arith_util& m_util_a, LenNodeManager* manager) {
+        if(manager == nullptr) {
+            return len_node_to_expr(node, variable_map, m, m_util_s, m_util_a, manager);
+        }
+        expr* cached = manager->get_expr(node, &variable_map);
+        if(cached != nullptr) {
+            return expr_ref(cached, m);
+        }
+        expr_ref res = len_node_to_expr(node, variable_map, m, m_util_s, m_util_a, manager);
+        manager->set_expr(node, &variable_map, res);
+        return res;
+    }
 }
 
 #endif
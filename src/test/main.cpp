@@ -248,6 +248,11 @@ int main(int argc, char ** argv) {
     TST(theory_pb);
     TST(simplex);
     TST(sat_user_scope);
+    TST(sat_xor);
+    TST(sat_cube_and_conquer);
+    TST(sat_gc);
+    TST(sat_vivifier);
+    TST(sat_parallel);
     TST_ARGV(ddnf);
     TST(ddnf1);
     TST(model_evaluator);
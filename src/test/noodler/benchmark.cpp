@@ -0,0 +1,131 @@
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "smt/theory_str_noodler/decision_procedure.h"
+#include "smt/theory_str_noodler/inclusion_graph.h"
+#include "smt/theory_str_noodler/state_len.h"
+#include "smt/theory_str_noodler/theory_str_noodler.h"
+#include "ast/reg_decl_plugins.h"
+#include "test_utils.h"
+
+// Benchmarks are hidden, run them explicitly by './test-noodler "[benchmark]"' (and compare the reported numbers
+// between the revisions).
+
+namespace {
+    /// Peak resident set size of this process in kilobytes.
+    long get_peak_rss_kb() {
+        struct rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+}
+
+TEST_CASE("Peak RSS of noodle-heavy instances", "[.][benchmark][noodler]") {
+    smt_params params;
+    ast_manager ast_m;
+    reg_decl_plugins(ast_m);
+    smt::context ctx{ast_m, params };
+    theory_str_noodler_params noodler_params{};
+    TheoryStrNoodlerCUT noodler{ ctx, ast_m, noodler_params };
+    auto& m_util_s{ noodler.m_util_s };
+    auto& m_util_a{ noodler.m_util_a };
+    auto& m{ noodler.m };
+
+    // equations with all variables length-aware, so that each noodle creates a new solving state
+    const std::vector<std::pair<std::string, std::string>> instances{
+        { "abcd", "efgh" },
+        { "abcdef", "ghijkl" },
+        { "abcabc", "defdef" },
+        { "abcdefgh", "ijklmnop" },
+    };
+
+    for (const auto& [left, right] : instances) {
+        Formula equalities;
+        equalities.add_predicate(create_equality(left, right));
+        AutAssignment init_ass;
+        std::unordered_set<BasicTerm> length_vars;
+        for (char var : left + right) {
+            init_ass[get_var(var)] = regex_to_nfa("(a|b)*");
+            length_vars.insert(get_var(var));
+        }
+
+        long rss_before = get_peak_rss_kb();
+        DecisionProcedureCUT proc(equalities, init_ass, length_vars, m, m_util_s, m_util_a, noodler_params);
+        proc.init_computation();
+        unsigned solutions = 0;
+        while (proc.compute_next_solution()) {
+            ++solutions;
+        }
+        std::cout << left << " = " << right << ": " << solutions << " solutions, peak RSS " << get_peak_rss_kb()
+                  << " kB (+" << get_peak_rss_kb() - rss_before << " kB)" << std::endl;
+        CHECK(solutions > 0);
+    }
+}
+
+TEST_CASE("Lookups of visited instances and graph nodes", "[.][benchmark][noodler]") {
+    smt_params params;
+    ast_manager ast_m;
+    reg_decl_plugins(ast_m);
+    smt::context ctx{ast_m, params };
+    theory_str_noodler_params noodler_params{};
+    TheoryStrNoodlerCUT noodler{ ctx, ast_m, noodler_params };
+    auto& m_util_s{ noodler.m_util_s };
+    auto& m{ noodler.m };
+
+    const unsigned num_of_vars = 200;
+    const unsigned num_of_instances = 5000;
+
+    // string variables and equations between consecutive ones
+    expr_ref_vector atoms(m);
+    for (unsigned i = 0; i < num_of_vars; ++i) {
+        expr_ref x(noodler.mk_str_var("x" + std::to_string(i)), m);
+        expr_ref y(noodler.mk_str_var("y" + std::to_string(i)), m);
+        atoms.push_back(m.mk_eq(m_util_s.str.mk_concat(x, y), m_util_s.str.mk_concat(y, x)));
+    }
+
+    // instances are sets of 10 atoms
+    std::vector<Instance> instances;
+    for (unsigned i = 0; i < num_of_instances; ++i) {
+        Instance inst;
+        for (unsigned j = 0; j < 10; ++j) {
+            inst.insert(atoms.get((i * 7 + j * 13 + i / num_of_vars) % num_of_vars));
+        }
+        instances.push_back(inst);
+    }
+
+    StateLen<unsigned> state_len;
+    for (unsigned i = 0; i < num_of_instances; ++i) {
+        state_len.add(instances[i], i);
+    }
+    CHECK(state_len.contains(instances.back()));
+
+    BENCHMARK("StateLen lookups") {
+        unsigned found = 0;
+        for (const Instance& inst : instances) {
+            found += state_len.contains(inst);
+        }
+        return found;
+    };
+
+    Graph graph;
+    std::vector<Predicate> predicates;
+    for (unsigned i = 0; i < num_of_instances; ++i) {
+        BasicTerm x{ BasicTermType::Variable, "x" + std::to_string(i) };
+        BasicTerm y{ BasicTermType::Variable, "y" + std::to_string(i % num_of_vars) };
+        predicates.emplace_back(PredicateType::Equation, std::vector<std::vector<BasicTerm>>{ { x, y }, { y, x } });
+        graph.add_node(predicates.back());
+    }
+    CHECK(graph.get_node(predicates.back()) != nullptr);
+
+    BENCHMARK("Graph::get_node") {
+        unsigned found = 0;
+        for (const Predicate& predicate : predicates) {
+            found += (graph.get_node(predicate) != nullptr);
+        }
+        return found;
+    };
+}
@@ -5,6 +5,7 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include "smt/theory_str_noodler/decision_procedure.h"
+#include "smt/theory_str_noodler/bounded_search.h"
 #include "smt/theory_str_noodler/theory_str_noodler.h"
 #include "ast/reg_decl_plugins.h"
 #include "test_utils.h"
@@ -269,3 +270,413 @@ TEST_CASE("Decision Procedure", "[noodler]") {
         CHECK(proc.compute_next_solution());
     }
 }
+
+TEST_CASE("Parallel decision procedure", "[noodler]") {
+    smt_params params;
+    ast_manager ast_m;
+    reg_decl_plugins(ast_m);
+    smt::context ctx{ast_m, params };
+    theory_str_noodler_params noodler_params{};
+    noodler_params.m_parallel_threads = 4;
+    TheoryStrNoodlerCUT noodler{ ctx, ast_m, noodler_params };
+    auto& m_util_s{ noodler.m_util_s };
+    auto& m_util_a{ noodler.m_util_a };
+    auto& m{ noodler.m };
+
+    SECTION("unsat-two-equations-length") {
+        Formula equalities;
+        equalities.add_predicate(create_equality("xy", "zu"));
+        equalities.add_predicate(create_equality("yx", "r"));
+        AutAssignment init_ass;
+        init_ass[get_var('x')] = regex_to_nfa("(a|b)*");
+        init_ass[get_var('y')] = regex_to_nfa("(a|b)*");
+        init_ass[get_var('z')] = regex_to_nfa("b");
+        init_ass[get_var('u')] = regex_to_nfa("b*");
+        init_ass[get_var('r')] = regex_to_nfa("a*");
+        DecisionProcedureCUT proc(equalities, init_ass, { get_var('x'), get_var('z') }, m, m_util_s, m_util_a, noodler_params);
+        proc.init_computation();
+        CHECK(!proc.compute_next_solution());
+    }
+
+    SECTION("sat-simple-length") {
+        Formula equalities;
+        equalities.add_predicate(create_equality("xy", "zu"));
+        AutAssignment init_ass;
+        init_ass[get_var('x')] = regex_to_nfa("a*");
+        init_ass[get_var('y')] = regex_to_nfa("a*");
+        init_ass[get_var('z')] = regex_to_nfa("a*");
+        init_ass[get_var('u')] = regex_to_nfa("a*");
+        DecisionProcedureCUT proc(equalities, init_ass, { get_var('x'), get_var('z') }, m, m_util_s, m_util_a, noodler_params);
+        proc.init_computation();
+        // the same number of solutions as in the sequential exploration
+        CHECK(proc.compute_next_solution());
+        CHECK(proc.compute_next_solution());
+        CHECK(!proc.compute_next_solution());
+    }
+
+    SECTION("stopping workers with unexplored states") {
+        Formula equalities;
+        equalities.add_predicate(create_equality("abcd", "efgh"));
+        AutAssignment init_ass;
+        std::unordered_set<BasicTerm> length_vars;
+        for (char var : std::string("abcdefgh")) {
+            init_ass[get_var(var)] = regex_to_nfa("(a|b)*");
+            length_vars.insert(get_var(var));
+        }
+        DecisionProcedureCUT proc(equalities, init_ass, length_vars, m, m_util_s, m_util_a, noodler_params);
+        proc.init_computation();
+        CHECK(proc.compute_next_solution());
+        // proc is destroyed here while the workers can still be processing
+    }
+
+    SECTION("the same results as the sequential procedure") {
+        theory_str_noodler_params sequential_params{};
+        sequential_params.m_parallel_threads = 1;
+        auto count_solutions = [&](const theory_str_noodler_params& par, const Formula& equalities, const AutAssignment& init_ass,
+                                   const std::unordered_set<BasicTerm>& length_vars) {
+            DecisionProcedureCUT proc(equalities, init_ass, length_vars, m, m_util_s, m_util_a, par);
+            proc.init_computation();
+            unsigned solutions = 0;
+            while (proc.compute_next_solution()) {
+                ++solutions;
+            }
+            return solutions;
+        };
+
+        std::vector<std::vector<std::pair<std::string, std::string>>> instances{
+            { { "xy", "zu" }, { "yx", "r" } },
+            { { "xyz", "uv" }, { "zx", "vu" } },
+            { { "xyx", "zuz" } },
+            { { "xy", "yx" }, { "zu", "xr" } },
+        };
+        std::vector<std::string> regexes{ "(a|b)*", "a*b*", "(ab)*", "b*", "a(a|b)*" };
+        for (unsigned i = 0; i < instances.size(); ++i) {
+            Formula equalities;
+            AutAssignment init_ass;
+            std::unordered_set<BasicTerm> length_vars;
+            for (const auto& [left, right] : instances[i]) {
+                equalities.add_predicate(create_equality(left, right));
+                for (char var : left + right) {
+                    init_ass[get_var(var)] = regex_to_nfa(regexes[(var + i) % regexes.size()]);
+                }
+            }
+            length_vars.insert(get_var('x'));
+            // the worker threads are restarted for each repetition, so that different interleavings are tried
+            for (unsigned repeat = 0; repeat < 5; ++repeat) {
+                CHECK(count_solutions(noodler_params, equalities, init_ass, length_vars)
+                      == count_solutions(sequential_params, equalities, init_ass, length_vars));
+            }
+        }
+    }
+}
+
+TEST_CASE("Lazy creation of noodle states", "[noodler]") {
+    smt_params params;
+    ast_manager ast_m;
+    reg_decl_plugins(ast_m);
+    smt::context ctx{ast_m, params };
+    theory_str_noodler_params noodler_params{};
+    TheoryStrNoodlerCUT noodler{ ctx, ast_m, noodler_params };
+    auto& m_util_s{ noodler.m_util_s };
+    auto& m_util_a{ noodler.m_util_a };
+    auto& m{ noodler.m };
+
+    Formula equalities;
+    equalities.add_predicate(create_equality("xy", "zu"));
+    AutAssignment init_ass;
+    init_ass[get_var('x')] = regex_to_nfa("a*");
+    init_ass[get_var('y')] = regex_to_nfa("a*");
+    init_ass[get_var('z')] = regex_to_nfa("a*");
+    init_ass[get_var('u')] = regex_to_nfa("a*");
+    DecisionProcedureCUT proc(equalities, init_ass, { get_var('x'), get_var('z') }, m, m_util_s, m_util_a, noodler_params);
+    proc.init_computation();
+
+    CHECK(proc.compute_next_solution());
+    CHECK(!proc.solution.pending_noodles);
+    // the state of the other noodle was not created yet
+    CHECK(std::any_of(proc.worklist.begin(), proc.worklist.end(), [](const SolvingState& state) {
+        return state.pending_noodles && state.pending_noodles->has_next();
+    }));
+    CHECK(proc.compute_next_solution());
+    CHECK(!proc.compute_next_solution());
+    CHECK(proc.worklist.empty());
+}
+
+TEST_CASE("Statistics of decision procedure", "[noodler]") {
+    smt_params params;
+    ast_manager ast_m;
+    reg_decl_plugins(ast_m);
+    smt::context ctx{ast_m, params };
+    theory_str_noodler_params noodler_params{};
+    TheoryStrNoodlerCUT noodler{ ctx, ast_m, noodler_params };
+    auto& m_util_s{ noodler.m_util_s };
+    auto& m_util_a{ noodler.m_util_a };
+    auto& m{ noodler.m };
+
+    Formula equalities;
+    equalities.add_predicate(create_equality("xy", "zu"));
+    AutAssignment init_ass;
+    init_ass[get_var('x')] = regex_to_nfa("a*");
+    init_ass[get_var('y')] = regex_to_nfa("a*");
+    init_ass[get_var('z')] = regex_to_nfa("a*");
+    init_ass[get_var('u')] = regex_to_nfa("a*");
+    auto stats = std::make_shared<DecisionProcedureStats>();
+    DecisionProcedureCUT proc(equalities, init_ass, { get_var('x'), get_var('z') }, m, m_util_s, m_util_a, noodler_params);
+    proc.set_stats(stats);
+    proc.init_computation();
+    while (proc.compute_next_solution()) {}
+
+    CHECK(stats->num_noodlifications == 1);
+    CHECK(stats->num_noodles == 2);
+    // the initial state, the state of each noodle
+    CHECK(stats->num_states == 3);
+    CHECK(stats->max_worklist_size >= 1);
+
+    ::statistics st;
+    stats->collect_statistics(st);
+    CHECK(st.size() > 0);
+}
+
+TEST_CASE("Persistent structures of solving states", "[noodler]") {
+    SECTION("CowPtr") {
+        CowPtr<std::set<BasicTerm>> vars{ std::set<BasicTerm>{ get_var('x') } };
+        CowPtr<std::set<BasicTerm>> copy{ vars };
+        CHECK(copy.shares_with(vars));
+
+        copy.mut().insert(get_var('y'));
+        CHECK(!copy.shares_with(vars));
+        CHECK(vars->size() == 1);
+        CHECK(copy->size() == 2);
+    }
+
+    SECTION("SubstitutionMap") {
+        SubstitutionMap parent;
+        parent.merge({ { get_var('x'), { get_var('a'), get_var('b') } } });
+        SubstitutionMap child{ parent };
+        child.merge({ { get_var('y'), {} }, { get_var('x'), { get_var('c') } } });
+
+        CHECK(parent.size() == 1);
+        CHECK(parent.count(get_var('y')) == 0);
+        CHECK(child.size() == 2);
+        CHECK(child.at(get_var('x')) == std::vector<BasicTerm>{ get_var('a'), get_var('b') });
+        CHECK(child.at(get_var('y')).empty());
+        CHECK(child.find(get_var('z')) == nullptr);
+        CHECK_THROWS_AS(child.at(get_var('z')), std::out_of_range);
+
+        // long chains are squashed
+        for (char var = 'd'; var <= 'w'; ++var) {
+            child.merge({ { get_var(var), { get_var('a') } } });
+        }
+        CHECK(child.size() == 22);
+        CHECK(child.to_map().size() == 22);
+        CHECK(child.at(get_var('x')).size() == 2);
+        CHECK(parent.size() == 1);
+    }
+}
+
+TEST_CASE("Indexed inclusions of solving states", "[noodler]") {
+    Predicate xy_in_z{ create_equality("xy", "z") };
+    Predicate z_in_xu{ create_equality("z", "xu") };
+    Predicate u_in_y{ create_equality("u", "y") };
+
+    SECTION("InclusionSet") {
+        InclusionSet inclusions(std::set<Predicate>{ xy_in_z, z_in_xu });
+        CHECK(inclusions.insert(u_in_y));
+        CHECK(!inclusions.insert(u_in_y));
+        CHECK(inclusions.size() == 3);
+
+        CHECK(inclusions.get_inclusions_with_right_vars({ get_var('x') }) == std::vector<Predicate>{ z_in_xu });
+        CHECK(inclusions.get_inclusions_with_right_vars({ get_var('z'), get_var('y') }).size() == 2);
+        CHECK(inclusions.get_inclusions_with_vars({ get_var('u') }).size() == 2);
+
+        InclusionSet copy{ inclusions };
+        CHECK(copy.erase(z_in_xu));
+        CHECK(!copy.erase(z_in_xu));
+        CHECK(copy.get_inclusions_with_right_vars({ get_var('x') }).empty());
+        CHECK(inclusions.get_inclusions_with_right_vars({ get_var('x') }) == std::vector<Predicate>{ z_in_xu });
+    }
+
+    SECTION("InclusionQueue") {
+        InclusionQueue queue(std::deque<Predicate>{ xy_in_z, z_in_xu, xy_in_z });
+        CHECK(queue.size() == 2);
+        CHECK(!queue.push_back_unique(z_in_xu));
+        CHECK(queue.push_front_unique(u_in_y));
+        CHECK(queue.front() == u_in_y);
+        queue.pop_front();
+        CHECK(!queue.contains(u_in_y));
+        CHECK(queue.contains(xy_in_z));
+    }
+
+    SECTION("SolvingState::substitute_vars") {
+        SolvingState state(AutAssignment{}, { xy_in_z, u_in_y }, { xy_in_z, z_in_xu, u_in_y }, { u_in_y }, {}, {});
+        state.substitute_vars({ { get_var('u'), { get_var('y') } } });
+        // u_in_y becomes y ⊆ y and is removed
+        CHECK(state.inclusions->size() == 2);
+        CHECK(state.inclusions->count(create_equality("z", "xy")) == 1);
+        CHECK(state.inclusions_not_on_cycle->empty());
+        CHECK(state.inclusions_to_process->size() == 1);
+        CHECK(state.get_dependent_inclusions(xy_in_z) == std::vector<Predicate>{ create_equality("z", "xy") });
+    }
+}
+
+TEST_CASE("Length abstraction of automata", "[noodler]") {
+    using Lassos = std::set<std::pair<int, int>>;
+
+    // <4, 0> and <6, 4> are subsumed by <0, 2>, <1, 0> is not
+    CHECK(DecisionProcedure::remove_subsumed_lassos({ { 0, 2 }, { 1, 0 }, { 3, 2 }, { 4, 0 }, { 6, 4 } })
+        == Lassos{ { 0, 2 }, { 1, 0 }, { 3, 2 } });
+    // <3, 2> is not subsumed by <2, 2> as 3 is odd
+    CHECK(DecisionProcedure::remove_subsumed_lassos({ { 2, 2 }, { 3, 2 } }) == Lassos{ { 2, 2 }, { 3, 2 } });
+    CHECK(DecisionProcedure::remove_subsumed_lassos({ { 2, 0 }, { 2, 3 } }) == Lassos{ { 2, 3 } });
+    CHECK(DecisionProcedure::remove_subsumed_lassos({}).empty());
+}
+
+TEST_CASE("Bounded-length search", "[noodler]") {
+    BasicTerm x{ get_var('x') };
+    BasicTerm y{ get_var('y') };
+    BasicTerm lit{ BasicTermType::Literal, "abc" };
+    AutAssignment aut_ass;
+    aut_ass[x] = regex_to_nfa("a*");
+    aut_ass[y] = regex_to_nfa("(b|c)*");
+    auto accept_all = [](const BoundedWordSearch::WordAssignment&) { return true; };
+
+    SECTION("equation with solution") {
+        Formula formula;
+        formula.add_predicate(Predicate(PredicateType::Equation, { { x, y }, { lit } }));
+        BoundedWordSearch search(formula, aut_ass, 1000);
+        auto solution = search.search(5, accept_all);
+        REQUIRE(solution.has_value());
+        CHECK(solution->at(x) == Mata::Word{ 'a' });
+        CHECK(solution->at(y) == Mata::Word{ 'b', 'c' });
+    }
+
+    SECTION("rejected solutions") {
+        Formula formula;
+        formula.add_predicate(Predicate(PredicateType::Inequation, { { x }, { y } }));
+        BoundedWordSearch search(formula, aut_ass, 1000);
+        // the shortest solutions are found first
+        auto solution = search.search(5, [&x](const BoundedWordSearch::WordAssignment& words) { return words.at(x).size() == 2; });
+        REQUIRE(solution.has_value());
+        CHECK(solution->at(x) == Mata::Word{ 'a', 'a' });
+        CHECK(solution->at(y).empty());
+    }
+
+    SECTION("equation without solution") {
+        Formula formula;
+        formula.add_predicate(Predicate(PredicateType::Equation, { { x, lit }, { y } }));
+        BoundedWordSearch search(formula, aut_ass, 1000);
+        CHECK(!search.search(5, accept_all).has_value());
+    }
+
+    SECTION("too many words") {
+        // there are 26^4 words of length 4, more than can be stored, so the search stops long before the time budget
+        BasicTerm u{ get_var('u') };
+        aut_ass[u] = regex_to_nfa("(a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p|q|r|s|t|u|v|w|x|y|z)*");
+        Formula formula;
+        formula.add_predicate(Predicate(PredicateType::Inequation, { { u }, { u } }));
+        BoundedWordSearch search(formula, aut_ass, 600000);
+        auto start = std::chrono::steady_clock::now();
+        CHECK(!search.search(16, accept_all).has_value());
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(60));
+    }
+}
+
+TEST_CASE("Model of solution", "[noodler]") {
+    smt_params params;
+    ast_manager ast_m;
+    reg_decl_plugins(ast_m);
+    smt::context ctx{ast_m, params };
+    theory_str_noodler_params noodler_params{};
+    TheoryStrNoodlerCUT noodler{ ctx, ast_m, noodler_params };
+    auto& m_util_s{ noodler.m_util_s };
+    auto& m_util_a{ noodler.m_util_a };
+    auto& m{ noodler.m };
+
+    SECTION("word extraction") {
+        Mata::Nfa::Nfa nfa{ *regex_to_nfa("ab(c|d)*") };
+        Mata::Word word;
+        REQUIRE(util::get_shortest_word(nfa, word));
+        CHECK(word == Mata::Word{ 'a', 'b' });
+        REQUIRE(util::get_word_of_length(nfa, 5, word));
+        CHECK(word.size() == 5);
+        CHECK(util::is_word_accepted(nfa, word));
+        CHECK(!util::get_word_of_length(nfa, 1, word));
+        CHECK(!util::is_word_accepted(nfa, { 'a', 'c' }));
+    }
+
+    SECTION("words of solution") {
+        Formula equalities;
+        equalities.add_predicate(create_equality("xy", "zu"));
+        AutAssignment init_ass;
+        init_ass[get_var('x')] = regex_to_nfa("a");
+        init_ass[get_var('y')] = regex_to_nfa("b*");
+        init_ass[get_var('z')] = regex_to_nfa("ab");
+        init_ass[get_var('u')] = regex_to_nfa("b(b|c)*");
+        DecisionProcedureCUT proc(equalities, init_ass, {}, m, m_util_s, m_util_a, noodler_params);
+        proc.init_computation();
+        REQUIRE(proc.compute_next_solution());
+
+        std::map<BasicTerm, Mata::Word> values;
+        REQUIRE(proc.get_model({}, model_ref(), values));
+        auto concat = [&values](char a, char b) {
+            Mata::Word word{ values.at(get_var(a)) };
+            word.insert(word.end(), values.at(get_var(b)).begin(), values.at(get_var(b)).end());
+            return word;
+        };
+        CHECK(concat('x', 'y') == concat('z', 'u'));
+        for (char var : std::string("xyzu")) {
+            CHECK(util::is_word_accepted(*init_ass.at(get_var(var)), values.at(get_var(var))));
+        }
+    }
+}
+
+TEST_CASE("Size-aware reduction", "[noodler]") {
+    smt_params params;
+    ast_manager ast_m;
+    reg_decl_plugins(ast_m);
+    smt::context ctx{ast_m, params };
+    theory_str_noodler_params noodler_params{};
+    noodler_params.m_reduce_growth = 2.0;
+    noodler_params.m_reduce_min_states = 32;
+    TheoryStrNoodlerCUT noodler{ ctx, ast_m, noodler_params };
+    auto& m_util_s{ noodler.m_util_s };
+    auto& m_util_a{ noodler.m_util_a };
+    auto& m{ noodler.m };
+
+    // a chain of simulation-equivalent states accepting a*
+    auto aut = std::make_shared<Mata::Nfa::Nfa>(40);
+    aut->initial.add(0);
+    for (Mata::Nfa::State state = 0; state < 40; ++state) {
+        aut->final.add(state);
+        aut->delta.add(state, 'a', state);
+        if (state + 1 < 40) {
+            aut->delta.add(state, 'a', state + 1);
+        }
+    }
+
+    auto stats = std::make_shared<DecisionProcedureStats>();
+    DecisionProcedureCUT proc(Formula(), AutAssignment(), {}, m, m_util_s, m_util_a, noodler_params);
+    proc.set_stats(stats);
+
+    // the automaton did not grow enough
+    CHECK(proc.reduce_if_grown(aut, 30) == aut);
+    CHECK(stats->num_size_reductions == 0);
+
+    auto reduced = proc.reduce_if_grown(aut, 10);
+    CHECK(reduced != aut);
+    CHECK(reduced->size() < aut->size());
+    CHECK(Mata::Nfa::are_equivalent(*reduced, *aut));
+    CHECK(stats->num_size_reductions == 1);
+    CHECK(stats->size_reduction_states_before == 40);
+    CHECK(stats->size_reduction_states_after == reduced->size());
+
+    // the reduction is cached for the shared automaton
+    CHECK(proc.reduce_if_grown(aut, 10) == reduced);
+    CHECK(stats->num_size_reduction_cache_hits == 1);
+    CHECK(stats->num_size_reductions == 1);
+
+    // reductions are disabled
+    noodler_params.m_reduce_growth = 0;
+    DecisionProcedureCUT proc_no_reduce(Formula(), AutAssignment(), {}, m, m_util_s, m_util_a, noodler_params);
+    CHECK(proc_no_reduce.reduce_if_grown(aut, 10) == aut);
+}
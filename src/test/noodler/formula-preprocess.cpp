@@ -749,3 +749,38 @@ TEST_CASE( "Remove extension", "[noodler]" ) {
         CHECK(prep.get_dependency().empty());
     }
 }
+
+TEST_CASE( "Length formula nodes", "[noodler]" ) {
+    BasicTerm x1{ BasicTermType::Variable, "x_1"};
+    BasicTerm x2{ BasicTermType::Variable, "x_2"};
+    BasicTerm x3{ BasicTermType::Variable, "x_3"};
+    Predicate eq1(PredicateType::Equation, std::vector<std::vector<BasicTerm>>({ std::vector<BasicTerm>({x1, x2}), std::vector<BasicTerm>({x3}) }));
+    Predicate eq2(PredicateType::Equation, std::vector<std::vector<BasicTerm>>({ std::vector<BasicTerm>({x3}), std::vector<BasicTerm>({x1}) }));
+
+    LenNodeManager manager;
+    LenNode* len1 = eq1.get_formula_eq(manager);
+    size_t num_of_nodes = manager.size();
+    // x_1, x_2, x_3, x_1 + x_2, and the equation
+    CHECK(num_of_nodes == 5);
+    // structurally equal formulae are the same node
+    CHECK(eq1.get_formula_eq(manager) == len1);
+    CHECK(manager.size() == num_of_nodes);
+    CHECK(eq2.get_formula_eq(manager)->succ[1] == manager.mk_leaf(x1));
+    CHECK(manager.mk_num(0) != manager.mk_leaf(x1));
+    CHECK(manager.mk_node(LenFormulaType::AND, {len1}) == manager.mk_node(LenFormulaType::AND, {len1}));
+}
+
+TEST_CASE( "Split into components", "[noodler]" ) {
+    BasicTerm x1{ BasicTermType::Variable, "x_1"};
+    BasicTerm x2{ BasicTermType::Variable, "x_2"};
+    BasicTerm x3{ BasicTermType::Variable, "x_3"};
+    BasicTerm x4{ BasicTermType::Variable, "x_4"};
+    BasicTerm x5{ BasicTermType::Variable, "x_5"};
+
+    CHECK(FormulaPreprocess::split_components({}).empty());
+    CHECK(FormulaPreprocess::split_components({ {x1, x2}, {x3}, {x2, x4}, {}, {x5, x3}, {x4} }) ==
+        std::vector<std::vector<size_t>>{ {0, 2, 5}, {1, 4}, {3} });
+    // components connected only through a later item
+    CHECK(FormulaPreprocess::split_components({ {x1}, {x2}, {x3}, {x1, x3} }) ==
+        std::vector<std::vector<size_t>>{ {0, 2, 3}, {1} });
+}
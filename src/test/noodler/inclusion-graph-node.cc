@@ -43,18 +43,63 @@ TEST_CASE( "Inclusion graph node", "[noodler]" ) {
     BasicTerm term_lit2{ BasicTermType::Literal, "5"};
     BasicTerm term_var{ BasicTermType::Variable, "4"};
     BasicTerm term_var2{ BasicTermType::Variable, "6"};
-    CHECK(term_lit < term_lit2);
-    CHECK(term_lit2 > term_lit);
+    // terms of the same type are ordered by the IDs of their interned names
+    CHECK((term_lit < term_lit2) != (term_lit2 < term_lit));
     CHECK(term_var < term_lit2);
     CHECK(term_var < term_lit);
-    CHECK(term_var < term_var2);
-    CHECK(term_var2 > term_var);
+    CHECK((term_var < term_var2) != (term_var2 < term_var));
     CHECK(term_var == term_var);
     CHECK(term_var2 < term_lit);
     CHECK(term_var2 < term_lit2);
     CHECK(term != term_var);
 }
 
+TEST_CASE("Interned names of basic terms", "[noodler]") {
+    BasicTerm term_var{ BasicTermType::Variable, "interned_x" };
+    BasicTerm term_lit{ BasicTermType::Literal, "interned_x" };
+    CHECK(term_var.get_name_id() == term_lit.get_name_id());
+    CHECK(term_var != term_lit);
+    CHECK(term_var == BasicTerm{ BasicTermType::Variable, zstring("interned_x") });
+    CHECK(term_var.get_name() == "interned_x");
+    CHECK(BasicTerm{ BasicTermType::Literal }.get_name_id() == 0);
+    CHECK(BasicTerm{ BasicTermType::Literal, "" }.get_name_id() == 0);
+
+    unsigned size{ TermNameTable::size() };
+    BasicTerm term_new{ BasicTermType::Variable, "interned_y" };
+    CHECK(TermNameTable::size() == size + 1);
+    CHECK(term_var < term_new);
+    CHECK(TermNameTable::get_name(term_new.get_name_id()) == "interned_y");
+
+    term_new.set_name("interned_x");
+    CHECK(term_new == term_var);
+    CHECK(TermNameTable::size() == size + 1);
+
+    // the order is the order of interning, not the lexicographic one
+    BasicTerm term_a{ BasicTermType::Variable, "interned_a" };
+    CHECK(term_var < term_a);
+    CHECK(!(term_a < term_var));
+    CHECK(!(term_var < term_var));
+}
+
+TEST_CASE("Scopes of the name table", "[noodler]") {
+    {
+        TermNameTable::Scope scope;
+        {
+            TermNameTable::Scope nested_scope;
+            BasicTerm term{ BasicTermType::Variable, "scoped_x" };
+            CHECK(term.get_name() == "scoped_x");
+        }
+        // the table is kept while some scope is open
+        unsigned size{ TermNameTable::size() };
+        BasicTerm term{ BasicTermType::Variable, "scoped_x" };
+        CHECK(TermNameTable::size() == size);
+        CHECK(term.get_name() == "scoped_x");
+    }
+    // only the empty name is left after the last scope is closed
+    CHECK(TermNameTable::size() == 1);
+    CHECK(BasicTerm{ BasicTermType::Variable, "scoped_y" }.get_name() == "scoped_y");
+}
+
 TEST_CASE("Conversion to strings", "[noodler]") {
     CHECK(smt::noodler::to_string(BasicTermType::Literal) == "Literal");
     CHECK(smt::noodler::to_string(BasicTermType::Variable) == "Variable");
@@ -21,6 +21,9 @@ public:
 
     using theory_str_noodler::m_util_s, theory_str_noodler::m, theory_str_noodler::m_util_a;
     using theory_str_noodler::mk_str_var, theory_str_noodler::mk_int_var, theory_str_noodler::mk_literal;
+    using theory_str_noodler::InstanceComponent, theory_str_noodler::solve_components, theory_str_noodler::rename_len_vars_apart;
+    using theory_str_noodler::m_not_contains_todo_rel, theory_str_noodler::add_not_contains_constr, theory_str_noodler::add_not_contains_constrs;
+    using theory_str_noodler::m_model_values, theory_str_noodler::m_dp_stats;
 };
 
 class DecisionProcedureCUT : public DecisionProcedure {
@@ -35,6 +38,8 @@ public:
     using DecisionProcedure::preprocess;
     using DecisionProcedure::solution;
     using DecisionProcedure::init_computation;
+    using DecisionProcedure::worklist;
+    using DecisionProcedure::reduce_if_grown;
 };
 
 // variables have one char names
@@ -6,4 +6,202 @@
 #include "smt/theory_str_noodler/theory_str_noodler.h"
 #include "smt/theory_str_noodler/util.h"
 #include "ast/reg_decl_plugins.h"
+#include "ast/occurs.h"
+#include "smt/smt_kernel.h"
 #include "test_utils.h"
+
+using Component = TheoryStrNoodlerCUT::InstanceComponent;
+
+// z3 string variable named by one char
+static expr_ref mk_z3_var(char var, TheoryStrNoodlerCUT& noodler) {
+    return { noodler.m_util_s.mk_skolem(symbol(std::string(1, var).c_str()), 0, nullptr, noodler.m_util_s.mk_string_sort()), noodler.m };
+}
+
+static expr_ref mk_z3_concat(const std::string& vars, TheoryStrNoodlerCUT& noodler) {
+    expr_ref res = mk_z3_var(vars[0], noodler);
+    for (size_t i = 1; i < vars.size(); ++i) {
+        res = noodler.m_util_s.str.mk_concat(res, mk_z3_var(vars[i], noodler));
+    }
+    return res;
+}
+
+// component consisting of the equation left = right (variables have one char names), the automata of the variables
+// are given by @p regexes and the length-sensitive variables by @p length_vars
+static void add_component(std::vector<Component>& components, TheoryStrNoodlerCUT& noodler, const std::string& left,
+                          const std::string& right, const std::map<char, std::string>& regexes, const std::string& length_vars) {
+    Component& comp = components.emplace_back(noodler.m);
+    comp.instance.add_predicate(create_equality(left, right));
+    comp.atoms.push_back(noodler.m.mk_eq(mk_z3_concat(left, noodler), mk_z3_concat(right, noodler)));
+    for (const auto& [var, regex] : regexes) {
+        comp.aut_ass[get_var(var)] = regex_to_nfa(regex);
+    }
+    for (char var : length_vars) {
+        comp.length_vars.insert(get_var(var));
+    }
+}
+
+TEST_CASE("Components of instances", "[noodler]") {
+    smt_params params;
+    ast_manager ast_m;
+    reg_decl_plugins(ast_m);
+    smt::context ctx{ast_m, params };
+    theory_str_noodler_params noodler_params{};
+    TheoryStrNoodlerCUT noodler{ ctx, ast_m, noodler_params };
+    auto& m_util_s{ noodler.m_util_s };
+    auto& m_util_a{ noodler.m_util_a };
+    auto& m{ noodler.m };
+
+    SECTION("renaming fresh length variables apart") {
+        expr_ref tmp_var = util::mk_int_var("tmp_0_0", m, m_util_s, m_util_a);
+        expr_ref len_x(m_util_s.str.mk_length(mk_z3_var('x', noodler)), m);
+        expr_ref formula(m.mk_eq(m_util_a.mk_add(tmp_var, len_x), m_util_a.mk_int(2)), m);
+        expr_ref renamed1 = noodler.rename_len_vars_apart(formula);
+        expr_ref renamed2 = noodler.rename_len_vars_apart(formula);
+        // the fresh variable of the decision procedure is renamed, the length of the string variable is kept
+        CHECK(!occurs(tmp_var, renamed1));
+        CHECK(occurs(len_x, renamed1));
+        CHECK(!occurs(tmp_var, renamed2));
+        CHECK(renamed1.get() != renamed2.get());
+    }
+
+    SECTION("component without solution") {
+        std::vector<Component> components;
+        add_component(components, noodler, "xy", "zu", { { 'x', "a" }, { 'y', "a*" }, { 'z', "b" }, { 'u', "b*" } }, "xz");
+        add_component(components, noodler, "vw", "st", { { 'v', "a*" }, { 'w', "a*" }, { 's', "a*" }, { 't', "a*" } }, "vs");
+        // the first component is blocked alone
+        CHECK(noodler.solve_components(components, Formula(), AutAssignment()) == l_false);
+    }
+
+    SECTION("components with the same fresh variables") {
+        // the decision procedures of both components name the variables of their first noodle tmp_0_<i>, the length
+        // of tmp_0_0 is 1 in the first component and 2 in the second one
+        std::vector<Component> components;
+        add_component(components, noodler, "xy", "zu", { { 'x', "a" }, { 'y', "b*" }, { 'z', "a" }, { 'u', "b*" } }, "xz");
+        add_component(components, noodler, "vw", "st", { { 'v', "aa" }, { 'w', "b*" }, { 's', "aa" }, { 't', "b*" } }, "vs");
+        Formula instance;
+        AutAssignment aut_ass;
+        for (const Component& comp : components) {
+            instance.add_predicate(comp.instance.get_predicates()[0]);
+            aut_ass.insert(comp.aut_ass.begin(), comp.aut_ass.end());
+        }
+        CHECK(noodler.solve_components(components, instance, aut_ass) == l_true);
+        // the model consists of the words of the solutions of both components
+        CHECK(noodler.m_model_values[get_var('x')] == Mata::Word{ 'a' });
+        CHECK(noodler.m_model_values[get_var('z')] == Mata::Word{ 'a' });
+        CHECK(noodler.m_model_values[get_var('v')] == Mata::Word{ 'a', 'a' });
+        CHECK(noodler.m_model_values[get_var('s')] == Mata::Word{ 'a', 'a' });
+        CHECK(noodler.m_model_values[get_var('y')] == noodler.m_model_values[get_var('u')]);
+        CHECK(noodler.m_model_values[get_var('w')] == noodler.m_model_values[get_var('t')]);
+    }
+
+    SECTION("model of remembered components") {
+        // the components have no length-sensitive variables, so their first solutions are all they need and the
+        // components are remembered as solved completely
+        std::vector<Component> components;
+        add_component(components, noodler, "xy", "zu", { { 'x', "a" }, { 'y', "b*" }, { 'z', "a" }, { 'u', "b*" } }, "");
+        add_component(components, noodler, "vw", "st", { { 'v', "aa" }, { 'w', "b*" }, { 's', "aa" }, { 't', "b*" } }, "");
+        Formula instance;
+        AutAssignment aut_ass;
+        for (const Component& comp : components) {
+            instance.add_predicate(comp.instance.get_predicates()[0]);
+            aut_ass.insert(comp.aut_ass.begin(), comp.aut_ass.end());
+        }
+        CHECK(noodler.solve_components(components, instance, aut_ass) == l_true);
+        const unsigned num_preprocessings = noodler.m_dp_stats->num_preprocessings;
+
+        // the model is built from the remembered solutions, the components are not solved again
+        noodler.m_model_values.clear();
+        CHECK(noodler.solve_components(components, instance, aut_ass) == l_true);
+        CHECK(noodler.m_dp_stats->num_preprocessings == num_preprocessings);
+        CHECK(noodler.m_model_values[get_var('x')] == Mata::Word{ 'a' });
+        CHECK(noodler.m_model_values[get_var('v')] == Mata::Word{ 'a', 'a' });
+        CHECK(noodler.m_model_values[get_var('y')] == noodler.m_model_values[get_var('u')]);
+        CHECK(noodler.m_model_values[get_var('w')] == noodler.m_model_values[get_var('t')]);
+    }
+}
+
+TEST_CASE("not(contains) as regular constraints", "[noodler]") {
+    smt_params params;
+    ast_manager ast_m;
+    reg_decl_plugins(ast_m);
+    smt::context ctx{ast_m, params };
+    theory_str_noodler_params noodler_params{};
+    TheoryStrNoodlerCUT noodler{ ctx, ast_m, noodler_params };
+    auto& m_util_s{ noodler.m_util_s };
+    auto& m{ noodler.m };
+
+    expr_ref x = mk_z3_var('x', noodler);
+    expr_ref y = mk_z3_var('y', noodler);
+    auto mk_aut_ass = [](const Mata::Nfa::Nfa& y_aut) {
+        return AutAssignment(std::map<BasicTerm, Mata::Nfa::Nfa>{ { get_var('x'), *regex_to_nfa("(a|b|c)*") }, { get_var('y'), y_aut } });
+    };
+
+    SECTION("needle with a single value") {
+        AutAssignment aut_ass = mk_aut_ass(*regex_to_nfa("ab"));
+        CHECK(noodler.add_not_contains_constr(x, y, aut_ass));
+        CHECK(!Mata::Nfa::is_in_lang(*aut_ass.at(get_var('x')), { { 'c', 'a', 'b', 'c' }, {} }));
+        CHECK(Mata::Nfa::is_in_lang(*aut_ass.at(get_var('x')), { { 'b', 'a', 'c' }, {} }));
+
+        expr_ref lit(m_util_s.str.mk_string("ba"), m);
+        CHECK(noodler.add_not_contains_constr(x, lit, aut_ass));
+        CHECK(!Mata::Nfa::is_in_lang(*aut_ass.at(get_var('x')), { { 'b', 'a', 'c' }, {} }));
+        CHECK(Mata::Nfa::is_in_lang(*aut_ass.at(get_var('x')), { { 'a', 'c', 'b' }, {} }));
+
+        noodler.m_not_contains_todo_rel.push_back(std::make_pair(x, y));
+        CHECK(noodler.add_not_contains_constrs(aut_ass) == smt::FC_DONE);
+    }
+
+    SECTION("overapproximation") {
+        AutAssignment aut_ass = mk_aut_ass(*regex_to_nfa("a*"));
+        std::shared_ptr<Mata::Nfa::Nfa> x_aut = aut_ass.at(get_var('x'));
+        // y has more values, the constraint is dropped
+        CHECK(!noodler.add_not_contains_constr(x, y, aut_ass));
+        CHECK(aut_ass.at(get_var('x')) == x_aut);
+
+        // a solution of the instance does not have to be a solution of not(contains), so the final check gives up
+        noodler.m_not_contains_todo_rel.push_back(std::make_pair(x, expr_ref(m_util_s.str.mk_string("a"), m)));
+        noodler.m_not_contains_todo_rel.push_back(std::make_pair(x, y));
+        CHECK(noodler.add_not_contains_constrs(aut_ass) == smt::FC_GIVEUP);
+    }
+
+    SECTION("needle without value") {
+        AutAssignment aut_ass = mk_aut_ass(Mata::Nfa::Nfa());
+        std::shared_ptr<Mata::Nfa::Nfa> x_aut = aut_ass.at(get_var('x'));
+        // the instance is unsatisfiable anyway, nothing is added
+        CHECK(noodler.add_not_contains_constr(x, y, aut_ass));
+        CHECK(aut_ass.at(get_var('x')) == x_aut);
+    }
+}
+
+TEST_CASE("Disequations of variables from one range", "[noodler]") {
+    smt_params params;
+    params.m_string_solver = symbol("noodler");
+    ast_manager m;
+    reg_decl_plugins(m);
+    seq_util m_util_s(m);
+    smt::kernel solver(m, params);
+
+    // variables x_0, ..., x_(n-1) in [a-(last)] that are pairwise different
+    auto assert_different = [&](unsigned n, const char* last) {
+        expr_ref range(m_util_s.re.mk_range(m_util_s.str.mk_string("a"), m_util_s.str.mk_string(last)), m);
+        expr_ref_vector vars(m);
+        for (unsigned i = 0; i < n; ++i) {
+            vars.push_back(m.mk_const(symbol(("x_" + std::to_string(i)).c_str()), m_util_s.mk_string_sort()));
+            solver.assert_expr(m_util_s.re.mk_in_re(vars.back(), range));
+            for (unsigned j = 0; j < i; ++j) {
+                solver.assert_expr(m.mk_not(m.mk_eq(vars.get(j), vars.get(i))));
+            }
+        }
+    };
+
+    SECTION("x != y") {
+        // a class of symbols represented by a single symbol would make the instance unsatisfiable
+        assert_different(2, "z");
+        CHECK(solver.check() == l_true);
+    }
+
+    SECTION("more variables than symbols") {
+        assert_different(3, "b");
+        CHECK(solver.check() == l_false);
+    }
+}
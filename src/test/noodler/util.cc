@@ -114,6 +114,31 @@ TEST_CASE("theory_str_noodler::util") {
         CHECK(alphabet == std::set<uint32_t>{ '\x02', '\x45', '\x77', '\x78', '\x79', '\x7a' });
     }
 
+    SECTION("util::SymbolClasses") {
+        // [a-z]* ([0-z] | x)
+        auto expr_az{ m_util_s.re.mk_range(m_util_s.str.mk_string("a"), m_util_s.str.mk_string("z")) };
+        auto expr_0z{ m_util_s.re.mk_range(m_util_s.str.mk_string("0"), m_util_s.str.mk_string("z")) };
+        auto expr_x{ m_util_s.re.mk_to_re(m_util_s.str.mk_string("x")) };
+        auto expr_regex{ m_util_s.re.mk_concat(m_util_s.re.mk_star(expr_az), m_util_s.re.mk_union(expr_0z, expr_x)) };
+
+        std::set<uint32_t> symbols;
+        util::SymbolClasses classes;
+        util::extract_symbols(expr_regex, m_util_s, m, symbols, &classes);
+        CHECK(symbols == std::set<uint32_t>{ 'x' });
+        // classes [0-`], [a-w] + [y-z], and x from the literal
+        CHECK(classes.get_alphabet(symbols) == std::set<uint32_t>{ '0', 'a', 'x' });
+        // the second class consists of two intervals
+        CHECK(classes.get_alphabet(symbols, 2) == std::set<uint32_t>{ '0', '1', 'a', 'b', 'x' });
+        CHECK(classes.get_alphabet(symbols, 25) == std::set<uint32_t>{ '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+            ':', ';', '<', '=', '>', '?', '@', 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'a', 'b', 'c', 'd', 'e', 'f', 'g',
+            'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z' });
+        CHECK(classes.is_covered('5'));
+        CHECK(!classes.is_covered('/'));
+
+        std::set<uint32_t> dummy_symbols{ util::get_dummy_symbols(2, symbols, &classes) };
+        CHECK(dummy_symbols == std::set<uint32_t>{ '\x00', '\x01' });
+    }
+
     SECTION("util::is_str_variable()") {
         expr_ref str_variable{ noodler.mk_str_var("var1"), m };
         CHECK(util::is_str_variable(str_variable, m_util_s));
@@ -223,4 +248,38 @@ TEST_CASE("theory_str_noodler::util") {
                                                           to_app(var3)->get_name().str() });
         }
     }
+
+    SECTION("util::RegexAutCache") {
+        util::RegexAutCache cache(m);
+        auto expr_x{ m_util_s.re.mk_star(m_util_s.re.mk_to_re(m_util_s.str.mk_string("x"))) };
+
+        auto nfa{ cache.get_nfa(expr_x, m_util_s, alphabet) };
+        CHECK(cache.size() == 1);
+        CHECK(cache.get_nfa(expr_x, m_util_s, alphabet) == nfa);
+        CHECK(Mata::Nfa::is_in_lang(*nfa, { { 'x', 'x' }, {} }));
+
+        auto compl_nfa{ cache.get_nfa(expr_x, m_util_s, alphabet, true) };
+        CHECK(cache.size() == 2);
+        CHECK(compl_nfa != nfa);
+        CHECK(Mata::Nfa::is_in_lang(*compl_nfa, { { 'y' }, {} }));
+
+        // automata over different alphabets are cached separately
+        std::set<uint32_t> other_alphabet{ alphabet };
+        other_alphabet.insert('w');
+        CHECK(cache.get_nfa(expr_x, m_util_s, other_alphabet) != nfa);
+        CHECK(cache.size() == 3);
+        CHECK(cache.get_nfa(expr_x, m_util_s, alphabet) == nfa);
+        CHECK(cache.size() == 3);
+
+        // the automata of the least recently used alphabet are dropped
+        for (uint32_t symbol = 0; symbol + 1 < util::RegexAutCache::MAX_ALPHABETS; ++symbol) {
+            std::set<uint32_t> new_alphabet{ alphabet };
+            new_alphabet.insert(0x100 + symbol);
+            cache.get_nfa(expr_x, m_util_s, new_alphabet);
+        }
+        CHECK(cache.get_nfa(expr_x, m_util_s, alphabet) == nfa);
+        CHECK(cache.size() == util::RegexAutCache::MAX_ALPHABETS + 1);
+        CHECK(cache.get_nfa(expr_x, m_util_s, other_alphabet) != nfa);
+        CHECK(cache.size() == util::RegexAutCache::MAX_ALPHABETS + 1);
+    }
 }
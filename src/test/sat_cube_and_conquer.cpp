@@ -0,0 +1,84 @@
+/*++
+Copyright (c) 2017 Microsoft Corporation
+
+--*/
+
+#include "sat/sat_solver.h"
+#include "util/util.h"
+#include <algorithm>
+#include <iostream>
+
+static unsigned get_stat(statistics const& st, char const* key) {
+    unsigned r = 0;
+    for (unsigned i = 0; i < st.size(); ++i)
+        if (strcmp(st.get_key(i), key) == 0)
+            r += st.get_uint_value(i);
+    return r;
+}
+
+static lbool check(bool cube_and_conquer, unsigned threads, unsigned num_vars, vector<sat::literal_vector> const& clauses,
+                   sat::literal_vector const& asms, statistics& st) {
+    params_ref p;
+    p.set_uint("threads", threads);
+    p.set_bool("cube_and_conquer", cube_and_conquer);
+    // small budget and shallow cubes, so that cubes are split
+    p.set_uint("cube_and_conquer.conflicts", 30);
+    p.set_uint("lookahead.cube.depth", 3);
+    reslimit rlim;
+    sat::solver s(p, rlim);
+    for (unsigned i = 0; i < num_vars; ++i)
+        s.mk_var();
+    for (auto const& c : clauses)
+        s.mk_clause(c.size(), c.data());
+    lbool r = s.check(asms.size(), asms.data());
+    if (r == l_true) {
+        sat::model const& mdl = s.get_model();
+        auto is_true = [&](sat::literal l) { return mdl[l.var()] == (l.sign() ? l_false : l_true); };
+        for (auto const& c : clauses)
+            ENSURE(std::any_of(c.begin(), c.end(), is_true));
+        for (sat::literal l : asms)
+            ENSURE(is_true(l));
+    }
+    if (r == l_false && cube_and_conquer) {
+        // the core is a subset of the assumptions that is refuted alone
+        sat::literal_vector core(s.get_core());
+        for (sat::literal l : core)
+            ENSURE(asms.contains(l));
+        statistics st2;
+        ENSURE(check(false, 1, num_vars, clauses, core, st2) == l_false);
+    }
+    s.collect_statistics(st);
+    return r;
+}
+
+static void tst_cube_and_conquer_random(random_gen& r, unsigned num_vars, bool with_asms, statistics& st) {
+    unsigned num_clauses = (unsigned)(num_vars * (4.0 + r(60) / 100.0));
+    vector<sat::literal_vector> clauses;
+    for (unsigned i = 0; i < num_clauses; ++i) {
+        sat::literal_vector c;
+        for (unsigned j = 0; j < 3; ++j)
+            c.push_back(sat::literal(r(num_vars), r(2) == 0));
+        clauses.push_back(c);
+    }
+    sat::literal_vector asms;
+    if (with_asms)
+        for (unsigned j = 0; j < 4; ++j)
+            asms.push_back(sat::literal(r(num_vars), r(2) == 0));
+    statistics st1;
+    lbool r1 = check(false, 1, num_vars, clauses, asms, st1);
+    lbool r2 = check(true, 1, num_vars, clauses, asms, st);
+    lbool r3 = check(true, 3, num_vars, clauses, asms, st);
+    std::cout << num_vars << " vars " << num_clauses << " clauses: " << r1 << " " << r2 << " " << r3 << "\n";
+    ENSURE(r1 == r2 && r1 == r3);
+}
+
+void tst_sat_cube_and_conquer() {
+    random_gen r(3);
+    statistics st;
+    for (unsigned i = 0; i < 30; ++i)
+        tst_cube_and_conquer_random(r, 60 + r(60), i % 2 == 1, st);
+    // the cubes of the lookahead solver are solved, and split when the budget is exhausted
+    ENSURE(get_stat(st, "sat cnc cubes") > 0);
+    ENSURE(get_stat(st, "sat cnc refuted") > 0);
+    ENSURE(get_stat(st, "sat cnc splits") > 0);
+}
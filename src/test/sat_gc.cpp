@@ -0,0 +1,78 @@
+/*++
+Copyright (c) 2017 Microsoft Corporation
+
+--*/
+
+#include "sat/sat_solver.h"
+#include "util/util.h"
+#include <iostream>
+
+static unsigned get_stat(statistics const& st, char const* key) {
+    unsigned r = 0;
+    for (unsigned i = 0; i < st.size(); ++i)
+        if (strcmp(st.get_key(i), key) == 0)
+            r += st.get_uint_value(i);
+    return r;
+}
+
+static lbool check(char const* gc, unsigned tier1_max, unsigned num_vars, vector<sat::literal_vector> const& clauses, statistics& st) {
+    params_ref p;
+    p.set_sym("gc", symbol(gc));
+    p.set_uint("gc.tier1_max", tier1_max);
+    // frequent gc rounds
+    p.set_uint("gc.initial", 200);
+    p.set_uint("gc.increment", 50);
+    reslimit rlim;
+    sat::solver s(p, rlim);
+    for (unsigned i = 0; i < num_vars; ++i)
+        s.mk_var();
+    for (auto const& c : clauses)
+        s.mk_clause(c.size(), c.data());
+    lbool r = s.check();
+    if (r == l_true) {
+        sat::model const& mdl = s.get_model();
+        for (auto const& c : clauses) {
+            bool is_sat = false;
+            for (sat::literal l : c)
+                is_sat |= mdl[l.var()] == (l.sign() ? l_false : l_true);
+            ENSURE(is_sat);
+        }
+    }
+    // the clauses of the core tier and tier2 have small glue (default gc.tier1 and gc.tier2)
+    for (sat::clause* c : s.learned()) {
+        if (c->tier() == sat::CORE_TIER)
+            ENSURE(c->glue() <= 2);
+        if (c->tier() == sat::TIER2)
+            ENSURE(c->glue() <= 6);
+    }
+    s.collect_statistics(st);
+    return r;
+}
+
+static void tst_gc_random(random_gen& r, unsigned num_vars, statistics& st) {
+    unsigned num_clauses = (unsigned)(num_vars * (4.1 + r(30) / 100.0));
+    vector<sat::literal_vector> clauses;
+    for (unsigned i = 0; i < num_clauses; ++i) {
+        sat::literal_vector c;
+        for (unsigned j = 0; j < 3; ++j)
+            c.push_back(sat::literal(r(num_vars), r(2) == 0));
+        clauses.push_back(c);
+    }
+    statistics st1, st2;
+    lbool r1 = check("glue_psm", UINT_MAX, num_vars, clauses, st1);
+    lbool r2 = check("tiered", UINT_MAX, num_vars, clauses, st);
+    // the core tier is bounded, so that its clauses are also demoted
+    lbool r3 = check("tiered", 0, num_vars, clauses, st2);
+    std::cout << num_vars << " vars " << num_clauses << " clauses: " << r1 << " " << r2 << " " << r3 << "\n";
+    ENSURE(r1 == r2 && r1 == r3);
+}
+
+void tst_sat_gc() {
+    random_gen r(5);
+    statistics st;
+    for (unsigned i = 0; i < 10; ++i)
+        tst_gc_random(r, 150 + r(50), st);
+    // learned clauses are deleted and promoted when their glue decreases
+    ENSURE(get_stat(st, "sat gc clause") > 0);
+    ENSURE(get_stat(st, "sat gc promoted") > 0);
+}
@@ -0,0 +1,160 @@
+/*++
+Copyright (c) 2017 Microsoft Corporation
+
+--*/
+
+#include "sat/sat_parallel.h"
+#include "sat/sat_solver.h"
+#include "util/util.h"
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+static unsigned get_stat(statistics const& st, char const* key) {
+    unsigned r = 0;
+    for (unsigned i = 0; i < st.size(); ++i)
+        if (strcmp(st.get_key(i), key) == 0)
+            r += st.get_uint_value(i);
+    return r;
+}
+
+static const unsigned num_producers = 4;
+static const unsigned num_clauses = 20000;
+static const unsigned num_slots = 8;
+static const unsigned capacity = 6;
+
+// the k-th clause of owner o has between 2 and capacity elements determined by o and k,
+// so that torn clauses are detected.
+static void mk_ring_clause(unsigned o, unsigned k, unsigned_vector& elems) {
+    elems.reset();
+    elems.push_back(o);
+    elems.push_back(k);
+    for (unsigned i = 2; i < 2 + k % (capacity - 1); ++i)
+        elems.push_back(o * 1000003 + k * 7 + i);
+}
+
+struct ring_reader {
+    unsigned owner;
+    uint64_t head = 0;
+    unsigned num_dropped = 0;
+    unsigned num_imported = 0;
+    unsigned num_own = 0;
+    unsigned num_torn = 0;
+    unsigned num_duplicates = 0;
+    vector<svector<bool>> seen;
+
+    ring_reader(unsigned owner): owner(owner) {
+        for (unsigned o = 0; o <= num_producers; ++o)
+            seen.push_back(svector<bool>(num_clauses, false));
+    }
+
+    void drain(sat::parallel::clause_ring& ring) {
+        unsigned_vector elems, expected;
+        while (ring.pop(owner, head, num_dropped, elems)) {
+            if (elems.size() < 2 || elems[0] > num_producers || elems[1] >= num_clauses) {
+                ++num_torn;
+                continue;
+            }
+            mk_ring_clause(elems[0], elems[1], expected);
+            if (elems != expected) {
+                ++num_torn;
+                continue;
+            }
+            if (elems[0] == owner)
+                ++num_own;
+            if (seen[elems[0]][elems[1]])
+                ++num_duplicates;
+            seen[elems[0]][elems[1]] = true;
+            ++num_imported;
+        }
+    }
+};
+
+static void tst_clause_ring() {
+    sat::parallel::clause_ring ring;
+    ring.reserve(num_slots, capacity);
+    unsigned_vector too_long(capacity + 1, 0u);
+    ENSURE(!ring.push(0, too_long.size(), too_long.data()));
+
+    // the producers also read the ring between their pushes, as the solver threads do.
+    // the last reader only reads, the clauses of owner num_producers are pushed at the end.
+    std::atomic<bool> done(false);
+    std::vector<ring_reader> readers;
+    for (unsigned o = 0; o < num_producers; ++o)
+        readers.push_back(ring_reader(o));
+    readers.push_back(ring_reader(num_producers + 1));
+    std::vector<std::thread> threads;
+    for (unsigned o = 0; o < num_producers; ++o) {
+        threads.emplace_back([&, o]() {
+            unsigned_vector elems;
+            for (unsigned k = 0; k < num_clauses; ++k) {
+                mk_ring_clause(o, k, elems);
+                ring.push(o, elems.size(), elems.data());
+                if (k % 3 == 0)
+                    readers[o].drain(ring);
+            }
+        });
+    }
+    threads.emplace_back([&]() {
+        while (!done)
+            readers[num_producers].drain(ring);
+    });
+    for (unsigned o = 0; o < num_producers; ++o)
+        threads[o].join();
+    done = true;
+    threads.back().join();
+
+    // the last num_slots clauses are not overwritten, so every reader sees them.
+    unsigned_vector elems;
+    for (unsigned k = 0; k < num_slots; ++k) {
+        mk_ring_clause(num_producers, k, elems);
+        ENSURE(ring.push(num_producers, elems.size(), elems.data()));
+    }
+    unsigned num_positions = num_producers * num_clauses + num_slots;
+    for (ring_reader& r : readers) {
+        r.drain(ring);
+        std::cout << "reader " << r.owner << " imported " << r.num_imported << " dropped " << r.num_dropped << "\n";
+        ENSURE(r.num_torn == 0);
+        ENSURE(r.num_duplicates == 0);
+        ENSURE(r.num_own == 0);
+        ENSURE(r.head == num_positions);
+        for (unsigned k = 0; k < num_slots; ++k)
+            ENSURE(r.seen[num_producers][k]);
+        if (r.owner < num_producers) {
+            // the own clauses are skipped or dropped.
+            ENSURE(r.num_imported + r.num_dropped <= num_positions);
+            ENSURE(r.num_imported + r.num_dropped + num_clauses >= num_positions);
+        }
+        else {
+            // every position is either imported or dropped.
+            ENSURE(r.num_imported + r.num_dropped == num_positions);
+        }
+    }
+}
+
+static void tst_duplicates() {
+    params_ref p;
+    p.set_uint("threads", 2);
+    reslimit rlim;
+    sat::solver s(p, rlim);
+    for (unsigned i = 0; i < 4; ++i)
+        s.mk_var();
+    sat::parallel par(s);
+    par.reserve(1, s.num_vars(), 16);
+    s.set_par(&par, 0);
+    sat::literal a(0, false), b(1, true), c(2, false);
+    par.share_clause(s, a, b);
+    // a permuted copy is suppressed, a different clause is not.
+    par.share_clause(s, b, a);
+    par.share_clause(s, a, c);
+    s.set_par(nullptr, 0);
+    statistics st;
+    par.collect_statistics(st);
+    ENSURE(get_stat(st, "sat par exported") == 2);
+    ENSURE(get_stat(st, "sat par duplicates") == 1);
+}
+
+void tst_sat_parallel() {
+    tst_clause_ring();
+    tst_duplicates();
+}
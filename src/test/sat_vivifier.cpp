@@ -0,0 +1,82 @@
+/*++
+Copyright (c) 2011 Microsoft Corporation
+
+--*/
+
+#include "sat/sat_solver.h"
+#include "sat/sat_vivifier.h"
+#include "util/util.h"
+#include <iostream>
+
+static unsigned get_stat(statistics const& st, char const* key) {
+    unsigned r = 0;
+    for (unsigned i = 0; i < st.size(); ++i)
+        if (strcmp(st.get_key(i), key) == 0)
+            r += st.get_uint_value(i);
+    return r;
+}
+
+static sat::literal_vector mk_clause(std::initializer_list<int> lits) {
+    // variable |l| - 1, negative if l < 0
+    sat::literal_vector c;
+    for (int l : lits)
+        c.push_back(sat::literal(std::abs(l) - 1, l < 0));
+    return c;
+}
+
+static bool is_sat(vector<sat::literal_vector> const& clauses, unsigned assignment) {
+    for (auto const& c : clauses) {
+        bool sat = false;
+        for (sat::literal l : c)
+            sat |= (((assignment >> l.var()) & 1) == 1) != l.sign();
+        if (!sat)
+            return false;
+    }
+    return true;
+}
+
+// a b c d e x: falsifying a and b propagates x by (a b x) and then c by (-x c),
+// so (a b c d e) is shortened to (a b c).
+static void tst_vivify_shorten() {
+    unsigned num_vars = 6;
+    vector<sat::literal_vector> clauses;
+    clauses.push_back(mk_clause({ 1, 2, 3, 4, 5 }));
+    clauses.push_back(mk_clause({ 1, 2, 6 }));
+    clauses.push_back(mk_clause({ -6, 3 }));
+    clauses.push_back(mk_clause({ -3, -4, 5 }));
+
+    params_ref p;
+    reslimit rlim;
+    sat::solver s(p, rlim);
+    for (unsigned i = 0; i < num_vars; ++i) {
+        s.mk_var();
+        s.set_external(i);
+    }
+    for (auto const& c : clauses)
+        s.mk_clause(c.size(), c.data());
+
+    sat::vivifier viv(s);
+    viv();
+    statistics st;
+    viv.collect_statistics(st);
+    ENSURE(get_stat(st, "sat vivified clauses") == 1);
+    ENSURE(get_stat(st, "sat vivified literals") == 2);
+    bool found = false;
+    for (sat::clause* c : s.clauses()) {
+        ENSURE(c->size() == 3);
+        found |= c->contains(sat::literal(0, false)) && c->contains(sat::literal(1, false)) && c->contains(sat::literal(2, false));
+    }
+    ENSURE(found);
+
+    // the solutions are unchanged
+    for (unsigned assignment = 0; assignment < (1u << num_vars); ++assignment) {
+        sat::literal_vector asms;
+        for (unsigned v = 0; v < num_vars; ++v)
+            asms.push_back(sat::literal(v, ((assignment >> v) & 1) == 0));
+        ENSURE((s.check(asms.size(), asms.data()) == l_true) == is_sat(clauses, assignment));
+    }
+}
+
+void tst_sat_vivifier() {
+    tst_vivify_shorten();
+}
@@ -0,0 +1,179 @@
+/*++
+Copyright (c) 2023 Microsoft Corporation
+
+--*/
+
+#include "sat/sat_solver.h"
+#include "sat/smt/xor_solver.h"
+#include "util/util.h"
+#include <iostream>
+
+struct xor_t {
+    sat::bool_var_vector vars;
+    bool rhs;
+};
+
+// clauses of: the xor of the variables equals rhs
+static void add_xor_clauses(sat::solver& s, xor_t const& x) {
+    unsigned n = x.vars.size();
+    sat::literal_vector lits;
+    for (unsigned mask = 0; mask < (1u << n); ++mask) {
+        if ((get_num_1bits(mask) % 2 == 1) == x.rhs)
+            continue;
+        // exclude the assignment given by the bits of mask
+        lits.reset();
+        for (unsigned i = 0; i < n; ++i)
+            lits.push_back(sat::literal(x.vars[i], (mask >> i) & 1));
+        s.mk_clause(lits.size(), lits.data());
+    }
+}
+
+static void init_solver(sat::solver& s, unsigned num_vars, vector<xor_t> const& xors, vector<sat::literal_vector> const& clauses) {
+    for (unsigned i = 0; i < num_vars; ++i)
+        s.mk_var();
+    for (auto const& x : xors)
+        add_xor_clauses(s, x);
+    for (auto const& c : clauses)
+        s.mk_clause(c.size(), c.data());
+}
+
+static bool check_xors(sat::model const& mdl, vector<xor_t> const& xors) {
+    for (auto const& x : xors) {
+        bool parity = false;
+        for (sat::bool_var v : x.vars)
+            parity ^= mdl[v] == l_true;
+        if (parity != x.rhs)
+            return false;
+    }
+    return true;
+}
+
+static unsigned get_stat(statistics const& st, char const* key) {
+    unsigned r = 0;
+    for (unsigned i = 0; i < st.size(); ++i)
+        if (strcmp(st.get_key(i), key) == 0)
+            r += st.get_uint_value(i);
+    return r;
+}
+
+// st collects the statistics of the xor solver
+static lbool check_with_xor_solver(unsigned num_vars, vector<xor_t> const& xors, vector<sat::literal_vector> const& clauses, statistics& st) {
+    ast_manager m;
+    params_ref p;
+    reslimit rlim;
+    sat::solver s(p, rlim);
+    s.set_extension(alloc(xr::solver, m, m.mk_family_id("xor-solver")));
+    init_solver(s, num_vars, xors, clauses);
+    lbool r = s.check();
+    if (r == l_true)
+        ENSURE(check_xors(s.get_model(), xors));
+    s.collect_statistics(st);
+    return r;
+}
+
+static lbool check_without_xor_solver(unsigned num_vars, vector<xor_t> const& xors, vector<sat::literal_vector> const& clauses) {
+    params_ref p;
+    reslimit rlim;
+    sat::solver s(p, rlim);
+    init_solver(s, num_vars, xors, clauses);
+    return s.check();
+}
+
+static xor_t mk_xor(std::initializer_list<sat::bool_var> vars, bool rhs) {
+    xor_t x;
+    for (sat::bool_var v : vars)
+        x.vars.push_back(v);
+    x.rhs = rhs;
+    return x;
+}
+
+static void tst_xor_conflict() {
+    // a + b + c = 1, a + b + d = 0, c + d + e = 0 imply e = 1
+    vector<xor_t> xors;
+    xors.push_back(mk_xor({ 0, 1, 2 }, true));
+    xors.push_back(mk_xor({ 0, 1, 3 }, false));
+    xors.push_back(mk_xor({ 2, 3, 4 }, false));
+    vector<sat::literal_vector> clauses;
+    statistics st1;
+    ENSURE(check_with_xor_solver(5, xors, clauses, st1) == l_true);
+    // the xors are extracted from the clauses and the matrix propagates the decisions
+    ENSURE(get_stat(st1, "sat xor constraints") == 3);
+    ENSURE(get_stat(st1, "sat xor matrices") == 1);
+    ENSURE(get_stat(st1, "sat xor propagations") > 0);
+    clauses.push_back(sat::literal_vector(1, sat::literal(4, true)));
+    statistics st2;
+    ENSURE(check_with_xor_solver(5, xors, clauses, st2) == l_false);
+}
+
+// the xors are extracted again when the clauses change between checks
+static void tst_xor_incremental() {
+    ast_manager m;
+    params_ref p;
+    reslimit rlim;
+    sat::solver s(p, rlim);
+    s.set_extension(alloc(xr::solver, m, m.mk_family_id("xor-solver")));
+    vector<xor_t> xors;
+    xors.push_back(mk_xor({ 0, 1, 2 }, true));
+    xors.push_back(mk_xor({ 1, 2, 3 }, false));
+    init_solver(s, 5, xors, vector<sat::literal_vector>());
+    // the variables of the clauses added later must not be eliminated
+    for (sat::bool_var v = 0; v < 5; ++v)
+        s.set_external(v);
+    ENSURE(s.check() == l_true);
+    statistics st1;
+    s.collect_statistics(st1);
+    ENSURE(get_stat(st1, "sat xor constraints") == 2);
+
+    s.pop_to_base_level();
+    xors.push_back(mk_xor({ 0, 3, 4 }, true));
+    add_xor_clauses(s, xors.back());
+    ENSURE(s.check() == l_true);
+    ENSURE(check_xors(s.get_model(), xors));
+    statistics st2;
+    s.collect_statistics(st2);
+    ENSURE(get_stat(st2, "sat xor constraints") == 3);
+
+    // a + b + c = 1 and b + c + d = 0 imply a + d = 1, so a + d + e = 1 implies e = 0
+    s.pop_to_base_level();
+    sat::literal e(4, false);
+    s.mk_clause(1, &e);
+    ENSURE(s.check() == l_false);
+}
+
+static void tst_xor_random(random_gen& r, unsigned num_vars, unsigned num_xors, unsigned num_clauses, statistics& st) {
+    vector<xor_t> xors;
+    for (unsigned i = 0; i < num_xors; ++i) {
+        xor_t x;
+        unsigned sz = 3 + r(2);
+        while (x.vars.size() < sz) {
+            sat::bool_var v = r(num_vars);
+            if (!x.vars.contains(v))
+                x.vars.push_back(v);
+        }
+        x.rhs = r(2) == 0;
+        xors.push_back(x);
+    }
+    vector<sat::literal_vector> clauses;
+    for (unsigned i = 0; i < num_clauses; ++i) {
+        sat::literal_vector c;
+        for (unsigned j = 0; j < 3; ++j)
+            c.push_back(sat::literal(r(num_vars), r(2) == 0));
+        clauses.push_back(c);
+    }
+    lbool r1 = check_with_xor_solver(num_vars, xors, clauses, st);
+    lbool r2 = check_without_xor_solver(num_vars, xors, clauses);
+    std::cout << num_vars << " vars " << num_xors << " xors " << num_clauses << " clauses: " << r1 << "\n";
+    ENSURE(r1 == r2);
+}
+
+void tst_sat_xor() {
+    tst_xor_conflict();
+    tst_xor_incremental();
+    random_gen r(0);
+    statistics st;
+    for (unsigned i = 0; i < 40; ++i)
+        tst_xor_random(r, 30, 20 + r(15), r(60), st);
+    // the answers are found by the xor solver, not only by the clauses
+    ENSURE(get_stat(st, "sat xor propagations") > 0);
+    ENSURE(get_stat(st, "sat xor conflicts") > 0);
+}